@@ -0,0 +1,114 @@
+/** @file contraction_hierarchy.h
+ *
+ * Interface pública da classe `ContractionHierarchy`.
+ */
+#ifndef CONTRACTION_HIERARCHY_H
+#define CONTRACTION_HIERARCHY_H
+
+#include "csr_graph.h"
+#include "graph.h"
+
+#include <atomic>
+#include <cstddef>
+#include <limits>       // for numeric_limits<>::max()
+#include <memory>       // for shared_ptr, unique_ptr
+#include <vector>
+
+
+/** Hierarquia de contração (Contraction Hierarchies) de um grafo.
+ *
+ * Um pré-processamento que permite buscas de menor caminho milhares de vezes
+ * mais rápidas que o algoritmo de Dijkstra. Os vértices são "contraídos" um
+ * a um, do menos importante para o mais importante: ao remover um vértice
+ * `v`, cada caminho mais curto `u -> v -> w` que deixaria de existir é
+ * substituído por um atalho (shortcut) `u -> w` com o mesmo peso. A ordem
+ * de contração é o nível (rank) de cada vértice.
+ *
+ * A busca é bidirecional e só sobe na hierarquia: a partir da origem, segue
+ * apenas arestas para vértices de nível maior; a partir do destino, segue
+ * ao contrário apenas arestas vindas de vértices de nível maior. As duas se
+ * encontram no vértice mais alto do menor caminho, depois de fixar poucas
+ * centenas de vértices mesmo em grafos muito grandes. Os atalhos do caminho
+ * encontrado são então desfeitos nos vértices originais.
+ *
+ * A hierarquia corresponde ao `CsrGraph` a partir do qual foi montada e não
+ * acompanha alterações no grafo. Veja `Graph::set_hierarchy()`.
+ */
+class ContractionHierarchy
+{
+public:
+    using Index = CsrGraph::Index;
+
+    /** Marca arestas que não são atalhos. */
+    static constexpr Index NO_MIDDLE = std::numeric_limits<Index>::max();
+
+    /** Monta a hierarquia de `graph`.
+     *
+     * A montagem leva de alguns segundos a alguns minutos, conforme o tamanho
+     * do grafo, e pode ser feita em outra thread, já que `CsrGraph` não muda.
+     *
+     * @param graph O grafo.
+     * @param cancel Sinal de cancelamento, ou nulo. Pode ser alterado por
+     *        outra thread; quando for `true`, a montagem é interrompida.
+     * @return A hierarquia, ou nulo se a montagem foi cancelada.
+     */
+    static std::unique_ptr<ContractionHierarchy> build(
+        std::shared_ptr<const CsrGraph> graph,
+        const std::atomic<bool>* cancel = nullptr);
+
+    /** Retorna o grafo a partir do qual a hierarquia foi montada. */
+    const std::shared_ptr<const CsrGraph>& graph() const { return m_graph; }
+
+    /** Retorna o número de atalhos adicionados pela contração. */
+    std::size_t num_shortcuts() const { return m_num_shortcuts; }
+
+    /** Encontra o menor caminho entre `src` e `tgt`.
+     *
+     * Segue o contrato de `Graph::plot_path()`: `path` recebe os vértices
+     * originais do destino até a origem, e a distância retornada é o maior
+     * `double` se não houver caminho.
+     *
+     * @param src O vértice de origem.
+     * @param tgt O vértice de destino.
+     * @param path Vetor vazio, que recebe o caminho.
+     * @param stats Se não for nulo, recebe as estatísticas da busca.
+     * @return A distância entre a origem e o destino.
+     */
+    double find_path(Index src, Index tgt, std::vector<Graph::VertexT>& path,
+                     Graph::PathStats* stats = nullptr) const;
+
+private:
+    /** Aresta da hierarquia: original ou atalho. */
+    struct Arc
+    {
+        Index node;     /**< O outro vértice da aresta. */
+        double weight;  /**< O peso. */
+        Index middle;   /**< O vértice contraído que o atalho pula, ou `NO_MIDDLE`. */
+    };
+
+    ContractionHierarchy() = default;
+
+    /** Retorna a aresta de `from` para `to`, onde `from` tem nível menor. */
+    const Arc& find_up(Index from, Index to) const;
+
+    /** Retorna a aresta de `from` para `to`, onde `to` tem nível menor. */
+    const Arc& find_down(Index from, Index to) const;
+
+    /** Acrescenta a `out` os vértices originais da aresta `from -> to`,
+     * sem `from` e com `to`. */
+    void unpack(Index from, Index to, Index middle, std::vector<Index>& out) const;
+
+    std::shared_ptr<const CsrGraph> m_graph;    /**< O grafo de origem. */
+    std::size_t m_num_shortcuts{ 0 };           /**< Ver `num_shortcuts()`. */
+
+    /** Arestas que partem de cada vértice para vértices de nível maior. */
+    std::vector<Index> m_up_offsets;
+    std::vector<Arc> m_up;
+
+    /** Arestas que chegam em cada vértice vindas de vértices de nível
+     * maior, guardadas com o vértice de origem em `Arc::node`. */
+    std::vector<Index> m_down_offsets;
+    std::vector<Arc> m_down;
+};
+
+#endif // CONTRACTION_HIERARCHY_H
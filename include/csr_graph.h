@@ -0,0 +1,109 @@
+/** @file csr_graph.h
+ *
+ * Interface pública da classe `CsrGraph`.
+ */
+#ifndef CSR_GRAPH_H
+#define CSR_GRAPH_H
+
+#include "graph.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+/** Cópia imutável de um `Graph`, organizada para consultas rápidas.
+ *
+ * Na lista de adjacências de `Graph`, cada aresta é um nó de lista alocado
+ * separadamente, com todas as suas propriedades. Percorrer as arestas de um
+ * vértice, como faz o algoritmo de Dijkstra, significa seguir um ponteiro
+ * por aresta.
+ *
+ * Aqui, o grafo é guardado no formato CSR (compressed sparse row): as
+ * arestas que partem de cada vértice ficam lado a lado em vetores contíguos,
+ * e `offsets[v]` indica onde começam as de `v`. Os dados usados a cada
+ * aresta relaxada (destino e peso) ficam em vetores próprios, separados dos
+ * que só são lidos de vez em quando (nome e sentido).
+ *
+ * As arestas também são guardadas no sentido inverso, agrupadas pelo vértice
+ * de destino, para buscas que partem do destino (veja `CsrGraph::in_begin()`).
+ *
+ * Os vértices têm os mesmos identificadores que em `Graph`, e as arestas de
+ * cada vértice estão na mesma ordem. A instância não acompanha alterações no
+ * grafo de origem; veja `Graph::frozen()`.
+ */
+class CsrGraph
+{
+public:
+    /** Índice de um vértice ou aresta. */
+    using Index = std::uint32_t;
+
+    /** Monta a forma CSR de `graph`.
+     *
+     * Pode jogar (throw) `std::length_error` se o grafo tiver mais vértices
+     * ou arestas do que `CsrGraph::Index` consegue representar.
+     */
+    explicit CsrGraph(const Graph& graph);
+
+    /** Retorna o número de vértices. */
+    std::size_t num_vertices() const { return m_offsets.size() - 1; }
+
+    /** Retorna o número de arestas. */
+    std::size_t num_edges() const { return m_targets.size(); }
+
+    /** Retorna o índice da primeira aresta que parte de `vertex`.
+     *
+     * As arestas de `vertex` vão de `edges_begin(vertex)` até
+     * `edges_end(vertex)`, exclusive.
+     */
+    Index edges_begin(Index vertex) const { return m_offsets[vertex]; }
+
+    /** Retorna o índice seguinte à última aresta que parte de `vertex`. */
+    Index edges_end(Index vertex) const { return m_offsets[vertex + 1]; }
+
+    /** Retorna o vértice de destino da aresta `edge`. */
+    Index target(Index edge) const { return m_targets[edge]; }
+
+    /** Retorna o peso da aresta `edge`. */
+    double weight(Index edge) const { return m_weights[edge]; }
+
+    /** Retorna o ID do nome da aresta `edge`, na tabela de nomes do grafo. */
+    Graph::NameID name(Index edge) const { return m_names[edge]; }
+
+    /** Retorna `true` se a aresta `edge` só tiver um sentido. */
+    bool oneway(Index edge) const { return m_oneway[edge] != 0; }
+
+    /** Retorna o índice da primeira aresta que chega em `vertex`, na
+     * visão inversa do grafo.
+     *
+     * As arestas que chegam em `vertex` vão de `in_begin(vertex)` até
+     * `in_end(vertex)`, exclusive. Esses índices valem apenas para
+     * `CsrGraph::in_source()` e `CsrGraph::in_weight()`.
+     */
+    Index in_begin(Index vertex) const { return m_in_offsets[vertex]; }
+
+    /** Retorna o índice seguinte à última aresta que chega em `vertex`. */
+    Index in_end(Index vertex) const { return m_in_offsets[vertex + 1]; }
+
+    /** Retorna o vértice de origem da aresta inversa `edge`. */
+    Index in_source(Index edge) const { return m_in_sources[edge]; }
+
+    /** Retorna o peso da aresta inversa `edge`. */
+    double in_weight(Index edge) const { return m_in_weights[edge]; }
+
+    /** Retorna as coordenadas do vértice `vertex`. */
+    const Graph::VertexCoords& coords(Index vertex) const { return m_coords[vertex]; }
+
+private:
+    std::vector<Index> m_offsets;               /**< Início das arestas de cada vértice, mais o total. */
+    std::vector<Index> m_targets;               /**< Destino de cada aresta. */
+    std::vector<double> m_weights;              /**< Peso de cada aresta. */
+    std::vector<Graph::NameID> m_names;         /**< Nome de cada aresta. */
+    std::vector<std::uint8_t> m_oneway;         /**< Sentido de cada aresta. */
+    std::vector<Index> m_in_offsets;            /**< Início das arestas que chegam em cada vértice. */
+    std::vector<Index> m_in_sources;            /**< Origem de cada aresta inversa. */
+    std::vector<double> m_in_weights;           /**< Peso de cada aresta inversa. */
+    std::vector<Graph::VertexCoords> m_coords;  /**< Coordenadas de cada vértice. */
+};
+
+#endif // CSR_GRAPH_H
@@ -6,11 +6,18 @@
 #ifndef GRAPH_H
 #define GRAPH_H
 
+#include "id_index.h"
+#include "string_pool.h"
+
 #include <boost/graph/adjacency_list.hpp>
 
-#include <memory>       // for unique_ptr
+#include <cstdint>
+#include <limits>       // for numeric_limits<>::max()
+#include <memory>       // for unique_ptr, shared_ptr
+#include <mutex>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <utility>      // for pair
 #include <vector>
 
@@ -18,6 +25,12 @@
 template<typename Iter, typename T>
 class GraphIterator;
 
+class ContractionHierarchy;
+class Landmarks;
+class NameIndex;
+class SpatialGrid;
+class CsrGraph;
+
 
 /** Classe encapsulando a estrutura de dados de um grafo e operações sobre ela.
  *
@@ -58,12 +71,55 @@ public:
         VertexCoords coord;     /**< As coordenadas do vértice no plano. */
     };
 
+    /** Identificador de um nome na tabela de nomes do grafo.
+     *
+     * Os nomes das arestas se repetem muito (todos os trechos de uma via têm
+     * o mesmo nome), então cada grafo guarda cada nome uma única vez e as
+     * arestas guardam apenas seu ID. Veja `Graph::intern_name()` e
+     * `Graph::get_name()`. O ID só vale no grafo que o criou.
+     */
+    using NameID = StringPool::ID;
+
+    /** ID do nome vazio, válido em qualquer grafo. */
+    static constexpr NameID NO_NAME = StringPool::EMPTY;
+
     /** Propriedades das arestas no grafo. */
     struct EdgeProperties
     {
-        std::string name;       /**< O nome da aresta. Não precisa ser único. */
-        double weight;          /**< O peso da aresta. Corresponde à sua distância em metros. */
-        bool oneway;            /**< Verdadeiro se a aresta só tiver um sentido. */
+        double weight{ 0.0 };   /**< O peso da aresta. Corresponde à sua distância em metros. */
+        NameID name{ NO_NAME }; /**< O ID do nome da aresta. Não precisa ser único. */
+        bool oneway{ false };   /**< Verdadeiro se a aresta só tiver um sentido. */
+
+        /** Pontos intermediários da aresta, da origem para o destino.
+         *
+         * Vazio em arestas retas. Arestas resultantes da simplificação do
+         * grafo guardam aqui os vértices removidos, para que sejam desenhadas
+         * com a forma original da via.
+         */
+        std::vector<VertexCoords> geometry;
+    };
+
+    /** Algoritmos de busca de menor caminho, usados por `Graph::plot_path()`.
+     *
+     * Todos retornam a mesma distância. Quando há mais de um caminho com a
+     * menor distância, podem escolher caminhos diferentes.
+     */
+    enum class PathAlgorithm
+    {
+        dijkstra,   /**< Dijkstra, expandindo em todas as direções. */
+        astar,      /**< A*, guiado pela distância em linha reta até o destino. */
+        bidirectional,  /**< Dijkstra a partir da origem e do destino ao mesmo tempo. */
+        hierarchy,  /**< Busca na hierarquia de contração (veja `Graph::set_hierarchy()`). */
+        landmarks,  /**< A* com as estimativas dos landmarks (veja `Graph::set_landmarks()`). */
+    };
+
+    /** Número de valores de `Graph::PathAlgorithm`. */
+    static constexpr std::size_t NUM_PATH_ALGORITHMS = 5;
+
+    /** Estatísticas de uma busca feita por `Graph::plot_path()`. */
+    struct PathStats
+    {
+        std::size_t settled{ 0 };   /**< Vértices cuja distância final a busca fixou. */
     };
 
     /* Os tipos abaixo são tipos concretos dos templates fornecidos pela BGL. */
@@ -75,6 +131,96 @@ public:
     using EdgeT = boost::graph_traits<AdjList>::edge_descriptor;
     using VertexIter = boost::graph_traits<AdjList>::vertex_iterator;
     using EdgeIter = boost::graph_traits<AdjList>::edge_iterator;
+    using OutEdgeIter = boost::graph_traits<AdjList>::out_edge_iterator;
+
+    /** Marca, na renumeração de `Graph::compact()`, os vértices removidos. */
+    static constexpr VertexT REMOVED_VERTEX = std::numeric_limits<VertexT>::max();
+
+    /** Fração de posições de vértices removidos a partir da qual o grafo é
+     * considerado fragmentado (veja `Graph::fragmented()`). */
+    static constexpr double MAX_FRAGMENTATION = 0.25;
+
+    /** Geração de uma posição da lista de vértices.
+     *
+     * Cada vértice adicionado recebe uma geração nova, tirada de um contador
+     * do grafo, e `Graph::compact()` dá gerações novas a todos. Nunca dois
+     * vértices ocupam a mesma posição com a mesma geração.
+     */
+    using Generation = std::uint64_t;
+
+    /** Referência a um vértice que detecta quando ele deixa de existir.
+     *
+     * Um `Graph::VertexT` é só a posição do vértice na lista: depois que o
+     * vértice é removido, a posição pode ser ocupada pelo próximo vértice
+     * adicionado, e `Graph::compact()` muda as posições de todos. Um
+     * identificador guardado passa, então, a indicar outro vértice sem que
+     * nada o denuncie. O `VertexHandle` guarda também a geração da posição,
+     * e `Graph::is_valid()` diz se ele ainda indica o mesmo vértice.
+     */
+    struct VertexHandle
+    {
+        VertexT vertex;         /**< A posição do vértice. */
+        Generation generation;  /**< A geração da posição quando o handle foi criado. */
+
+        bool operator==(const VertexHandle&) const = default;
+    };
+
+    /** Tabela de distâncias calculada por `Graph::distance_matrix()`. */
+    struct DistanceMatrix
+    {
+        std::size_t num_sources{ 0 };   /**< Número de linhas. */
+        std::size_t num_targets{ 0 };   /**< Número de colunas. */
+
+        /** As distâncias, linha por linha: a distância da origem `i` ao
+         * destino `j` fica na posição `i * num_targets + j`. É o maior
+         * `double` quando não há caminho. */
+        std::vector<double> distances;
+
+        /** Os caminhos, na mesma disposição de `distances` e na ordem de
+         * `Graph::plot_path()`. Vazio se não foram pedidos. */
+        std::vector<std::vector<VertexT>> paths;
+
+        /** Retorna a distância da origem `source` ao destino `target`. */
+        double distance(std::size_t source, std::size_t target) const
+        {
+            return distances[source * num_targets + target];
+        }
+
+        /** Retorna o caminho da origem `source` ao destino `target`. */
+        const std::vector<VertexT>& path(std::size_t source, std::size_t target) const
+        {
+            return paths[source * num_targets + target];
+        }
+    };
+
+    /** Vértices e arestas ao alcance de uma origem, calculados por
+     * `Graph::reachable()`.
+     *
+     * Cada vértice e aresta pertence a uma faixa: o índice, em `budgets`, do
+     * menor limite de distância que o alcança.
+     */
+    struct Reachable
+    {
+        std::vector<double> budgets;        /**< Os limites de distância, em ordem crescente. */
+        std::vector<VertexT> vertices;      /**< Os vértices, em ordem de distância. */
+        std::vector<double> distances;      /**< As distâncias de `vertices`. */
+        std::vector<std::size_t> vertex_bands;  /**< As faixas de `vertices`. */
+
+        /** As arestas percorridas por inteiro dentro do maior limite. */
+        std::vector<EdgeT> edges;
+        std::vector<std::size_t> edge_bands;    /**< As faixas de `edges`. */
+
+        /** Esvazia os vetores, mantendo a memória alocada. */
+        void clear()
+        {
+            budgets.clear();
+            vertices.clear();
+            distances.clear();
+            vertex_bands.clear();
+            edges.clear();
+            edge_bands.clear();
+        }
+    };
 
     /** Cria uma nova instância de `Graph`.
      *
@@ -96,6 +242,11 @@ public:
      * dois vértices com as mesmas propriedades. Serão tratados como dois
      * vértices distintos.
      *
+     * Se houver posições de vértices removidos, o novo vértice ocupa uma
+     * delas, em vez de aumentar a lista. Identificadores guardados do
+     * vértice removido passam a indicar o novo; só um `Graph::VertexHandle`
+     * percebe a troca.
+     *
      * @warning Adicionar ou remover vértices do grafo invalida quaisquer
      *          iterators em uso.
      * @param vertex Referência a uma estrutura do tipo `Graph::VertexProperties`.
@@ -108,12 +259,80 @@ public:
      * Quaisquer arestas partindo ou chegando no vértice removido também
      * serão removidas.
      *
+     * O vértice deixa apenas uma posição vaga, sem arestas, na lista de
+     * vértices (veja `Graph::is_removed()`), e os identificadores dos demais
+     * não mudam até `Graph::compact()`. O identificador do vértice removido
+     * só vale para `Graph::is_removed()`, até que `Graph::add_vertex()`
+     * reaproveite a posição. O custo é proporcional ao número de
+     * vizinhos do vértice; a primeira remoção também monta, uma única vez, a
+     * lista das arestas que chegam em cada vértice.
+     *
      * @warning Adicionar ou remover vértices do grafo invalida quaisquer
      *          iterators em uso.
      * @param vertex O identificador único que referencia o vértice a ser removido.
      */
     void remove_vertex(const VertexT& vertex);
 
+    /** Remove vários vértices do grafo de uma só vez.
+     *
+     * Cada vértice é removido como em `Graph::remove_vertex()`, e o grafo só
+     * é compactado (veja `Graph::compact()`) se ficar fragmentado.
+     *
+     * @warning Invalida quaisquer iterators em uso, e os identificadores se
+     *          o grafo for compactado.
+     * @param vertices Os vértices a remover, em qualquer ordem e
+     *        possivelmente repetidos.
+     * @return A renumeração de `Graph::compact()`, ou vazio se o grafo não
+     *         foi compactado.
+     */
+    std::vector<VertexT> remove_vertices(const std::vector<VertexT>& vertices);
+
+    /** Retorna o número de posições vagas, deixadas por vértices removidos,
+     * na lista de vértices. */
+    std::size_t num_removed() const;
+
+    /** Se a posição `vertex` é de um vértice removido. */
+    bool is_removed(const VertexT& vertex) const;
+
+    /** Retorna um handle para o vértice `vertex`, que deve existir. */
+    VertexHandle get_handle(const VertexT& vertex) const;
+
+    /** Se `handle` ainda indica o vértice para o qual foi criado.
+     *
+     * Deixa de indicar quando o vértice é removido, mesmo que sua posição
+     * seja reaproveitada depois, e quando o grafo é compactado.
+     */
+    bool is_valid(const VertexHandle& handle) const;
+
+    /** Se mais de `Graph::MAX_FRAGMENTATION` das posições da lista de
+     * vértices estão vagas, e vale a pena chamar `Graph::compact()`. */
+    bool fragmented() const;
+
+    /** Retira as posições vagas da lista de vértices.
+     *
+     * Os vértices restantes mantêm a ordem relativa, com os identificadores
+     * renumerados a partir de 0. Percorre todo o grafo.
+     *
+     * @warning Invalida quaisquer iterators e identificadores em uso.
+     * @return O novo identificador de cada posição anterior, ou
+     *         `Graph::REMOVED_VERTEX` para as vagas. Vazio se não havia
+     *         posições vagas, e nada mudou.
+     */
+    std::vector<VertexT> compact();
+
+    /** Move um vértice para as coordenadas `coord`.
+     *
+     * Os pesos das arestas que saem ou chegam no vértice mudam tanto quanto
+     * o comprimento dos seus trechos que tocam o vértice, de forma que
+     * continuam sendo a distância percorrida, e a heurística euclidiana de
+     * `Graph::plot_path()` continua válida. Se alguma aresta ficar mais
+     * curta, os landmarks são descartados.
+     *
+     * @param vertex O identificador único do vértice.
+     * @param coord As novas coordenadas.
+     */
+    void set_vertex_coords(const VertexT& vertex, const VertexCoords& coord);
+
     /** Adiciona uma aresta ao grafo.
      *
      * A aresta ligará, direcionalmente, `src` a `tgt`. As propriedades da
@@ -133,7 +352,19 @@ public:
     std::optional<EdgeT> add_edge(const VertexT& src, const VertexT& tgt,
                                   const EdgeProperties& edge);
 
+    /** Remove uma aresta do grafo.
+     *
+     * @warning Remover arestas invalida iterators para a aresta removida.
+     * @param edge O identificador único da aresta.
+     */
+    void remove_edge(const EdgeT& edge);
+
     /** Retorna o número de vértices no grafo.
+     *
+     * Conta também as posições vagas de vértices removidos (veja
+     * `Graph::num_removed()`), de forma que todo identificador é menor que
+     * este número.
+     *
      * @return O número de vértices no grafo.
      */
     std::size_t num_vertices() const;
@@ -160,6 +391,34 @@ public:
      */
     const EdgeProperties& get_edge_properties(const EdgeT& edge) const;
 
+    /** Retorna o ID de `name` na tabela de nomes, adicionando-o se preciso.
+     *
+     * É assim que se obtém o valor de `EdgeProperties::name` para uma nova
+     * aresta.
+     *
+     * @param name O nome.
+     * @return O ID do nome neste grafo.
+     */
+    NameID intern_name(std::string_view name);
+
+    /** Retorna o nome de ID `name`, que deve ter sido criado por este grafo. */
+    const std::string& get_name(NameID name) const;
+
+    /** Retorna o número de nomes na tabela de nomes, contando o vazio.
+     *
+     * Os IDs dos nomes vão de 0 até este valor, exclusive.
+     */
+    std::size_t num_names() const;
+
+    /** Retorna o nome da aresta.
+     *
+     * É um atalho para `get_name(get_edge_properties(edge).name)`.
+     *
+     * @param edge O identificador único da aresta.
+     * @return O nome da aresta, vazio se ela não tiver nome.
+     */
+    const std::string& get_edge_name(const EdgeT& edge) const;
+
     /** Acessa as coordenadas de um vértice.
      *
      * As coordenadas são retornadas como referência constante. Esta função não
@@ -190,13 +449,64 @@ public:
      */
     std::vector<std::size_t> get_vertex_id_list() const;
 
+    /** Retorna a forma CSR do grafo, para consultas que não o alteram.
+     *
+     * A forma CSR é montada na primeira chamada e guardada até a próxima
+     * alteração do grafo; chamadas seguintes a retornam pronta. Pode ser
+     * chamado de várias threads ao mesmo tempo, desde que nenhuma altere o
+     * grafo. A instância retornada continua válida mesmo depois de o grafo
+     * ser alterado, mas deixa de corresponder a ele.
+     *
+     * @return A forma CSR do grafo no estado atual.
+     */
+    std::shared_ptr<const CsrGraph> frozen() const;
+
+    /** Passa a usar `hierarchy` nas buscas com `PathAlgorithm::hierarchy`.
+     *
+     * A hierarquia só é aceita se foi montada a partir da forma CSR atual do
+     * grafo (veja `Graph::frozen()`); se o grafo foi alterado durante a
+     * montagem, ela é descartada. Assim como a forma CSR, é descartada na
+     * próxima alteração do grafo.
+     *
+     * @param hierarchy A hierarquia, montada por `ContractionHierarchy::build()`.
+     * @return `true` se a hierarquia foi aceita.
+     */
+    bool set_hierarchy(std::shared_ptr<const ContractionHierarchy> hierarchy);
+
+    /** Retorna a hierarquia de contração do grafo, ou nulo se não houver. */
+    std::shared_ptr<const ContractionHierarchy> hierarchy() const;
+
+    /** Passa a usar `landmarks` nas buscas com `PathAlgorithm::landmarks`.
+     *
+     * Assim como em `Graph::set_hierarchy()`, as tabelas só são aceitas se
+     * foram calculadas a partir da forma CSR atual do grafo. Ao contrário da
+     * hierarquia, continuam sendo usadas depois de alterações que não
+     * encurtam caminhos nem mudam os índices dos vértices: acrescentar
+     * vértices, remover arestas e mover vértices. Os limites continuam
+     * valendo, só ficam menos justos; vértices novos não têm limite. Remover
+     * vértices ou acrescentar arestas descarta as tabelas.
+     *
+     * @param landmarks As tabelas, calculadas por `Landmarks::build()`.
+     * @return `true` se as tabelas foram aceitas.
+     */
+    bool set_landmarks(std::shared_ptr<const Landmarks> landmarks);
+
+    /** Retorna as tabelas de landmarks do grafo, ou nulo se não houver. */
+    std::shared_ptr<const Landmarks> landmarks() const;
+
     /** Encontra o menor caminho entre `src` e `tgt`.
      *
-     * O algoritmo utiliza a implementação de dijkstra_shortest_paths()
-     * fornecida pela BGL. O vetor `path` é um argumento de entrada e saída. O
-     * vetor deve ser passado vazio. `plot_path()` irá adicionar `src`, `tgt` e
-     * os vértices entre eles ao vetor. A órdem dos vértices é invertida, ou
-     * seja de `tgt` até `src`.
+     * A busca, escolhida por `algorithm`, é executada sobre a forma CSR do
+     * grafo (veja `Graph::frozen()`) e para assim que `tgt` é alcançado. O
+     * A* supõe que nenhuma aresta pesa menos que a distância em linha reta
+     * entre seus vértices, o que vale para os grafos lidos de mapas e para
+     * as arestas desenhadas à mão. Sem hierarquia de contração, a busca com
+     * `PathAlgorithm::hierarchy` usa o Dijkstra bidirecional, e sem
+     * landmarks, a busca com `PathAlgorithm::landmarks` usa o A*. O vetor
+     * `path` é um argumento de entrada e saída. O vetor deve ser passado
+     * vazio. `plot_path()` irá adicionar `src`, `tgt` e os vértices entre
+     * eles ao vetor. A órdem dos vértices é invertida, ou seja de `tgt` até
+     * `src`.
      *
      * No caso de não existir um caminho entre os dois vértices, `path` não é
      * alterado e o valor retornado por `plot_path()` é igual ao máximo valor
@@ -206,9 +516,51 @@ public:
      * @param tgt O identificador único do vértice de destino.
      * @param path Vetor onde serão coletados os vértices entre a origem e o
      *        destino.
+     * @param algorithm O algoritmo de busca.
+     * @param stats Se não for nulo, recebe as estatísticas da busca.
      * @return A distância total percorrida entre a origem e o destino.
      */
-    double plot_path(const VertexT& src, const VertexT& tgt, std::vector<VertexT>& path) const;
+    double plot_path(const VertexT& src, const VertexT& tgt, std::vector<VertexT>& path,
+                     PathAlgorithm algorithm = PathAlgorithm::dijkstra,
+                     PathStats* stats = nullptr) const;
+
+    /** Calcula as distâncias de cada vértice de `sources` a cada vértice de
+     * `targets`.
+     *
+     * Uma só busca de Dijkstra por origem responde por todos os destinos:
+     * os destinos são agrupados por vértice, e a busca para quando todos
+     * foram fixados. As buscas são divididas entre `threads` threads, cada
+     * uma com a sua memória de trabalho (veja `SearchWorkspace`). Pode ser
+     * chamado de várias threads ao mesmo tempo, assim como
+     * `Graph::plot_path()`.
+     *
+     * @param sources As origens. Podem se repetir.
+     * @param targets Os destinos. Podem se repetir.
+     * @param with_paths Se `true`, também guarda os caminhos.
+     * @param threads Número de threads. O valor 0 utiliza o número de
+     *        núcleos da máquina.
+     * @return A tabela de distâncias.
+     */
+    DistanceMatrix distance_matrix(const std::vector<VertexT>& sources,
+                                   const std::vector<VertexT>& targets,
+                                   bool with_paths = false,
+                                   unsigned threads = 0) const;
+
+    /** Encontra os vértices e arestas ao alcance de `src` dentro de cada
+     * limite de distância de `budgets`.
+     *
+     * Uma só busca de Dijkstra atende a todos os limites, e para no maior
+     * deles. O custo depende só da região alcançada, e não do tamanho do
+     * grafo (veja `SearchWorkspace`). `result` é reaproveitado: passar a
+     * mesma instância a cada chamada evita novas alocações, como ao
+     * arrastar a origem pelo mapa.
+     *
+     * @param src O vértice de origem.
+     * @param budgets Os limites de distância, em qualquer ordem.
+     * @param result Recebe os vértices e arestas alcançados.
+     */
+    void reachable(const VertexT& src, const std::vector<double>& budgets,
+                   Reachable& result) const;
 
     /** Retorna o vértice de origem da aresta.
      *
@@ -246,7 +598,8 @@ public:
     /** Retorna um par de iteradores para os vértices do grafo.
      *
      * O primeiro iterador apontará para o primeiro descritor, enquanto o segundo
-     * apontará para o descritor após o último.
+     * apontará para o descritor após o último. As posições vagas de vértices
+     * removidos também são percorridas (veja `Graph::is_removed()`).
      *
      * @return Um par de iterators para os vértices do grafo.
      */
@@ -261,26 +614,64 @@ public:
      */
     std::pair<EdgeIter, EdgeIter> iter_edges() const;
 
+    /** Retorna um par de iteradores para as arestas que partem de `vertex`.
+     *
+     * @param vertex O identificador único do vértice.
+     * @return Um par de iterators para as arestas de saída do vértice.
+     */
+    std::pair<OutEdgeIter, OutEdgeIter> iter_out_edges(const VertexT& vertex) const;
+
+    /** Retorna o número de arestas que partem de `vertex`. */
+    std::size_t out_degree(const VertexT& vertex) const;
+
+    /** Retorna o número de arestas que chegam em `vertex`.
+     *
+     * Usa as mesmas listas de origens de `Graph::remove_vertex()`, que são
+     * montadas na primeira chamada, percorrendo todas as arestas, e depois
+     * acompanham as alterações do grafo.
+     */
+    std::size_t in_degree(const VertexT& vertex);
+
+    /** Retorna a aresta de menor peso entre `src` e `tgt`.
+     *
+     * Pode haver mais de uma aresta ligando os mesmos dois vértices. A de menor
+     * peso é a utilizada por `Graph::plot_path()`, então este método permite
+     * saber por onde passa um caminho calculado.
+     *
+     * @param src O identificador único do vértice de origem.
+     * @param tgt O identificador único do vértice de destino.
+     * @return O descritor da aresta ou nulo, se não houver aresta de `src`
+     *         para `tgt`.
+     */
+    std::optional<EdgeT> find_edge(const VertexT& src, const VertexT& tgt) const;
+
     /** Retorna o descritor do vértice que se encontra nas coordenadas indicadas.
      *
      * Como os vértices são representados no plano com uma área, ao invés de um
      * ponto único, encontrar o vértice nas coordenadas indicadas envolve uma
-     * margem de tolerância. Assim, este método retorna um vértice, se as
-     * coordenadas do mesmo estiverem dentro do círculo com centro em `x` e `y`
-     * e raio `margin`. Pode retornar nulo caso não haja nenhum vértice nesta
-     * área.
+     * margem de tolerância. Assim, este método retorna o vértice mais
+     * próximo de `x` e `y`, se estiver dentro do círculo com centro em `x` e
+     * `y` e raio `margin`. Pode retornar nulo caso não haja nenhum vértice
+     * nesta área.
      *
-     * Se mais de um vértice estiver na área indicada, o primeiro encontrado
-     * será retornado. Este método tem complexidade O(n).
+     * A busca usa um índice espacial (`SpatialGrid`), montado na primeira
+     * chamada e mantido a cada vértice acrescentado, movido ou removido, e
+     * só examina os vértices próximos do ponto.
      *
      * @param x A posição no eixo X do centro da área buscada.
      * @param y A posição no eixo Y do centro da área buscada.
      * @param margin O raio do círculo com centro em `x` e `y` onde pode existir
-     *        um vértice.
+     *        um vértice. Sem limite, se for o maior `double`.
      * @return O descritor do vértice na área ou nulo caso não exista nenhum.
      */
     std::optional<VertexT> find_vertex_with_coords(double x, double y, double margin) const;
 
+    /** Retorna os vértices dentro do círculo com centro em `x` e `y` e raio
+     * `radius`, em ordem arbitrária. Usa o mesmo índice espacial que
+     * `Graph::find_vertex_with_coords()`.
+     */
+    std::vector<VertexT> find_vertices_within(double x, double y, double radius) const;
+
     /** Retorna o vértice com ID `id`.
      *
      * Este método retorna um par de iterators. Caso exista com vértice com
@@ -288,6 +679,10 @@ public:
      * Caso não exista, o primeiro iterator será igual ao último, que apontada
      * para o elemento após o fim do vetor de vértices no grafo.
      *
+     * O grafo mantém um índice dos IDs, atualizado a cada alteração, e a
+     * busca não percorre os vértices. Se vários vértices têm o mesmo ID
+     * (os criados no modo de edição têm ID 0), retorna um deles.
+     *
      * @param id O ID do vértice buscado.
      * @return Um par de iterators para os vértices. O primeiro apontará para
      *         o vértice com ID = `id`, se houver, ou para o fim se não houver.
@@ -301,13 +696,102 @@ public:
      * aresta. Caso não exista, o primeiro iterator será igual ao segundo, que
      * aponta para o elemento após o último da lista de arestas no grafo.
      *
+     * O nome é procurado uma única vez na tabela de nomes; as arestas são
+     * então comparadas pelo ID do nome. Para todas as arestas de um nome,
+     * ou buscas por prefixo, veja `Graph::name_index()`.
+     *
      * @param name O nome da aresta buscada.
      * @return Um par de iterators para as arestas.
      */
     std::pair<EdgeIter, EdgeIter> find_edge_name(const std::string& name) const;
 
+    /** Retorna o índice das arestas pelos nomes das vias.
+     *
+     * Assim como a forma CSR (veja `Graph::frozen()`), o índice é montado na
+     * primeira chamada e guardado até a próxima alteração do grafo, e pode
+     * ser pedido de várias threads ao mesmo tempo. As arestas do índice só
+     * valem enquanto o grafo não for alterado.
+     *
+     * @return O índice do grafo no estado atual.
+     */
+    std::shared_ptr<const NameIndex> name_index() const;
+
 private:
+    /** Guarda a forma CSR, a hierarquia, os landmarks e o índice de nomes
+     * até a próxima alteração do grafo.
+     *
+     * Cópias do grafo começam sem ela, pois a mutex não pode ser copiada.
+     */
+    struct FrozenCache
+    {
+        FrozenCache() = default;
+        FrozenCache(const FrozenCache&) {}
+        FrozenCache& operator=(const FrozenCache&);
+
+        std::mutex mutex;                   /**< Protege os membros abaixo. */
+        std::shared_ptr<const CsrGraph> csr; /**< A forma CSR, ou nulo. */
+        std::shared_ptr<const ContractionHierarchy> hierarchy; /**< A hierarquia, ou nulo. */
+        std::shared_ptr<const Landmarks> landmarks; /**< Os landmarks, ou nulo. */
+        std::shared_ptr<const NameIndex> names; /**< O índice de nomes, ou nulo. */
+    };
+
+    /** Guarda o índice espacial dos vértices. Ao contrário de
+     * `Graph::FrozenCache`, é mantido nas alterações, e não descartado.
+     *
+     * Cópias do grafo começam sem ele, pois a mutex não pode ser copiada.
+     */
+    struct SpatialCache
+    {
+        SpatialCache() = default;
+        SpatialCache(const SpatialCache&) {}
+        SpatialCache& operator=(const SpatialCache&);
+
+        std::mutex mutex;                   /**< Protege `grid`. */
+        std::shared_ptr<SpatialGrid> grid;  /**< O índice, ou nulo se ainda não foi montado. */
+    };
+
+    /** Um ID no índice de `Graph::find_vertex_id()`. */
+    struct IdEntry
+    {
+        VertexT vertex;                 /**< Um dos vértices com o ID. */
+        std::vector<VertexT> others;    /**< Os demais vértices com o ID. */
+    };
+
+    /** Acrescenta o ID de `vertex` ao índice de `Graph::find_vertex_id()`. */
+    void index_id(const VertexT& vertex);
+
+    /** Retira o ID de `vertex` do índice de `Graph::find_vertex_id()`. */
+    void unindex_id(const VertexT& vertex);
+
+    /** Retorna, para cada vértice, as origens das arestas que chegam nele,
+     * montando a lista se preciso. */
+    std::vector<std::vector<VertexT>>& predecessors();
+
+    /** Retorna o índice espacial, montando-o se preciso. */
+    std::shared_ptr<const SpatialGrid> spatial_grid() const;
+
+    /** Descarta a forma CSR e a hierarquia. Chamado por todos os métodos que
+     * alteram o grafo.
+     *
+     * @param keep_landmarks Se `true`, os landmarks são mantidos (veja
+     *        `Graph::set_landmarks()`).
+     */
+    void thaw(bool keep_landmarks = false);
+
     AdjList m_adj_list; /**< Lista de adjacências do grafo. */
+    StringPool m_names; /**< Os nomes das arestas. */
+    mutable FrozenCache m_frozen;   /**< Ver `Graph::frozen()`. */
+    mutable SpatialCache m_spatial; /**< Ver `Graph::find_vertex_with_coords()`. */
+    IdIndex<IdEntry> m_ids;         /**< Ver `Graph::find_vertex_id()`. */
+
+    std::vector<bool> m_removed;    /**< Se cada posição é de um vértice removido. */
+    std::vector<Generation> m_generations; /**< A geração de cada posição. */
+    Generation m_next_generation{ 0 };     /**< A geração do próximo vértice adicionado. */
+    std::vector<VertexT> m_free;    /**< As posições vagas, reaproveitadas por `Graph::add_vertex()`. */
+
+    /** Ver `Graph::predecessors()`. Montada na primeira remoção de vértice
+     * ou por `Graph::in_degree()`, e mantida até `Graph::compact()`. */
+    std::optional<std::vector<std::vector<VertexT>>> m_predecessors;
 };
 
 
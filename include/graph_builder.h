@@ -0,0 +1,292 @@
+/** @file graph_builder.h
+ *
+ * Interface pública da classe `osm_parser::GraphBuilder`.
+ */
+#ifndef GRAPH_BUILDER_H
+#define GRAPH_BUILDER_H
+
+#include "graph.h"
+#include "id_index.h"
+#include "osm_parser.h"
+#include "projection.h"
+#include "way_table.h"
+
+#include <atomic>
+#include <functional>   // for function
+#include <limits>       // for numeric_limits<>::max()
+#include <memory>       // for unique_ptr
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+namespace osm_parser
+{
+    /** Monta um `Graph` a partir dos nós e vias de um mapa OSM.
+     *
+     * É a parte comum a todos os leitores de formatos OSM (XML e PBF). O
+     * leitor informa os limites do mapa, depois os nós e, por fim, as vias
+     * aceitas. Cada par de nós consecutivos de uma via se torna uma aresta
+     * (ou duas, em vias de mão dupla). Um nó só vira vértice do grafo quando
+     * alguma via o referencia.
+     *
+     * Os nós devem ser informados antes das vias que os referenciam, que é a
+     * ordem garantida pelos arquivos OSM.
+     */
+    class GraphBuilder
+    {
+    public:
+        /** Tabela de nós, na ordem em que foram lidos. */
+        using NodeTable = std::vector<Graph::VertexProperties>;
+
+        /** Uma via guardada por `GraphBuilder::keep_ways()`. */
+        struct Way
+        {
+            std::size_t id;                     /**< O ID da via. */
+            std::vector<std::size_t> waypoints; /**< Os IDs de seus nós. */
+            std::string name;                   /**< O nome da via. */
+            bool oneway;                        /**< Se a via tem um só sentido. */
+        };
+
+        GraphBuilder();
+
+        /** Define os limites do mapa, utilizados na projeção das coordenadas.
+         *
+         * Deve ser chamado antes de qualquer chamada a `GraphBuilder::project()`.
+         * É ignorado se uma projeção tiver sido definida com
+         * `GraphBuilder::set_projection()`.
+         *
+         * @param minlat A menor latitude do mapa, em graus.
+         * @param maxlat A maior latitude do mapa, em graus.
+         * @param minlon A menor longitude do mapa, em graus.
+         * @param maxlon A maior longitude do mapa, em graus.
+         */
+        void set_bounds(double minlat, double maxlat, double minlon, double maxlon);
+
+        /** Define a projeção, no lugar da derivada dos limites do mapa.
+         *
+         * Usado para que vários arquivos sejam projetados no mesmo plano.
+         */
+        void set_projection(const Projection& projection);
+
+        /** Retorna `true` se a projeção já é conhecida, seja por
+         * `GraphBuilder::set_bounds()` ou por `GraphBuilder::set_projection()`. */
+        bool has_projection() const;
+
+        /** Projeta uma coordenada geográfica no plano do grafo.
+         *
+         * Pode ser chamado de várias threads ao mesmo tempo.
+         *
+         * @param lat A latitude, em graus.
+         * @param lon A longitude, em graus.
+         * @return As coordenadas no plano, em metros.
+         */
+        Graph::VertexCoords project(double lat, double lon) const
+        {
+            return m_projection.project(lat, lon);
+        }
+
+        /** Define o perfil de rota utilizado pelos leitores ao filtrar as vias.
+         *
+         * Deve ser chamado antes da leitura das vias.
+         */
+        void set_profile(Profile profile);
+
+        /** Retorna o perfil de rota definido em `GraphBuilder::set_profile()`. */
+        Profile profile() const;
+
+        /** Configura o acompanhamento da leitura.
+         *
+         * @param options As opções de leitura, de onde vêm `Options::progress`
+         *        e `Options::cancel`. Devem existir até o fim da leitura.
+         * @param bytes_total O total de bytes que serão lidos.
+         */
+        void set_progress(const Options& options, std::size_t bytes_total);
+
+        /** Soma `bytes` às posições informadas a `GraphBuilder::report_progress()`.
+         *
+         * Usado na segunda passagem da leitura em duas passagens, que começa
+         * de novo do início do arquivo.
+         */
+        void set_progress_base(std::size_t bytes);
+
+        /** Informa que a leitura chegou à posição `bytes` do arquivo.
+         *
+         * Os leitores chamam esta função com frequência; só de tempos em tempos
+         * ela repassa o andamento a `Options::progress` e verifica
+         * `Options::cancel`. Só deve ser chamada na thread da leitura.
+         *
+         * Pode jogar (throw) `osm_parser::Cancelled`.
+         */
+        void report_progress(std::size_t bytes)
+        {
+            if (bytes + m_progress_base >= m_next_report)
+                do_report_progress(bytes + m_progress_base);
+        }
+
+        /** Verifica se a leitura foi cancelada.
+         *
+         * Pode ser chamado de várias threads ao mesmo tempo, para que tarefas
+         * longas terminem cedo. Não joga exceções.
+         */
+        bool is_cancelled() const
+        {
+            return m_cancel && m_cancel->load(std::memory_order_relaxed);
+        }
+
+        /** Restringe os nós guardados pelo construtor.
+         *
+         * Deve ser chamado antes de qualquer nó ser adicionado. Depois disso,
+         * `GraphBuilder::wants_node()` só aceita os IDs informados.
+         *
+         * @param ids Os IDs dos nós desejados, em qualquer ordem e
+         *            possivelmente repetidos. O vetor passado é consumido.
+         */
+        void set_wanted_nodes(std::vector<std::size_t>&& ids);
+
+        /** Verifica se um nó deve ser adicionado à tabela de nós.
+         *
+         * Os leitores consultam esta função antes de decodificar e projetar
+         * cada nó. Pode ser chamado de várias threads ao mesmo tempo.
+         *
+         * @param id O ID do nó.
+         * @return `true` se nenhum filtro foi definido ou se `id` é desejado.
+         */
+        bool wants_node(std::size_t id) const;
+
+        /** Adiciona um nó, já projetado, à tabela de nós. */
+        void add_node(const Graph::VertexProperties& node);
+
+        /** Adiciona vários nós, já projetados, à tabela de nós.
+         * @param nodes Os nós. A tabela passada é consumida.
+         */
+        void add_nodes(NodeTable&& nodes);
+
+        /** Adiciona uma via ao grafo.
+         *
+         * Pares de nós que não estiverem na tabela de nós são ignorados. O peso
+         * de cada aresta é a distância entre seus nós.
+         *
+         * Pode jogar (throw) `osm_parser::ParserError`.
+         *
+         * @param id O ID da via.
+         * @param waypoints Os IDs dos nós da via, na ordem de percurso.
+         * @param name O nome da via, compartilhado por todas as suas arestas.
+         * @param oneway Se a via só pode ser percorrida na ordem de `waypoints`.
+         */
+        void add_way(std::size_t id, const std::vector<std::size_t>& waypoints,
+                     std::string_view name, bool oneway);
+
+        /** Faz `GraphBuilder::add_way()` guardar as vias, no lugar de
+         * adicioná-las ao grafo.
+         *
+         * Na leitura de vários arquivos, cada arquivo é lido por um construtor
+         * próprio, e só depois os nós e vias de todos são passados a um único
+         * construtor, com `GraphBuilder::take_nodes()` e
+         * `GraphBuilder::take_ways()`.
+         */
+        void keep_ways();
+
+        /** Faz `GraphBuilder::add_way()` registrar as vias em `table`.
+         *
+         * `GraphBuilder::finish()` completa a tabela com a projeção, o perfil
+         * de rota e os nós de vias que não viraram vértices. Os nós das vias
+         * recusadas só entram com `GraphBuilder::keep_other_ways()`. Veja
+         * `Options::way_table`.
+         */
+        void set_way_table(WayTable* table);
+
+        /** Faz `GraphBuilder::add_other_way()` guardar os nós das vias
+         * recusadas pelo perfil de rota.
+         *
+         * Os leitores só informam essas vias quando
+         * `GraphBuilder::keeps_other_ways()` for verdadeiro. Veja
+         * `Options::keep_other_way_nodes`.
+         */
+        void keep_other_ways();
+
+        /** Retorna `true` se os nós das vias recusadas são guardados. */
+        bool keeps_other_ways() const;
+
+        /** Informa uma via visível recusada pelo perfil de rota.
+         *
+         * A via não entra no grafo, mas seus nós vão para a tabela de vias,
+         * para o caso de um arquivo de alterações passar a aceitá-la. Não
+         * faz nada se `GraphBuilder::keep_other_ways()` não foi chamado.
+         *
+         * @param waypoints Os IDs dos nós da via.
+         */
+        void add_other_way(const std::vector<std::size_t>& waypoints);
+
+        /** Entrega a tabela de nós. A instância não deve mais receber nós. */
+        NodeTable take_nodes();
+
+        /** Entrega as vias guardadas desde `GraphBuilder::keep_ways()`. */
+        std::vector<Way> take_ways();
+
+        /** Entrega os nós das vias informadas a `GraphBuilder::add_other_way()`,
+         * sem repetições. */
+        std::vector<std::size_t> take_other_nodes();
+
+        /** Entrega o grafo montado. A instância não deve mais ser utilizada. */
+        std::unique_ptr<Graph> finish();
+
+    private:
+        /** Repassa o andamento e verifica o cancelamento. */
+        void do_report_progress(std::size_t bytes);
+
+        /** Marca a ausência de vértice em `m_node_vd`. */
+        static constexpr Graph::VertexT NO_VERTEX = static_cast<Graph::VertexT>(-1);
+
+        /** Adiciona a `m_node_pos` os nós lidos desde a última chamada.
+         * Se um ID se repete, vale o primeiro nó lido.
+         */
+        void index_nodes();
+
+        /** Ordena `m_other_nodes` e retira as repetições. */
+        void dedup_other_nodes();
+
+        /** Preenche `WayTable::nodes` com os nós de vias que não viraram
+         * vértices. */
+        void fill_way_table_nodes();
+
+        /** Retorna o vértice do nó na posição `pos`, adicionando-o ao grafo
+         * se ele ainda não tiver sido adicionado. */
+        Graph::VertexT vertex_at(std::size_t pos);
+
+        Profile m_profile{ Profile::any_highway };  /**< Ver `Options::profile`. */
+
+        Projection m_projection;            /**< A projeção das coordenadas. */
+        bool m_has_projection{ false };     /**< Ver `GraphBuilder::has_projection()`. */
+        bool m_projection_fixed{ false };   /**< Se veio de `GraphBuilder::set_projection()`. */
+
+        bool m_keep_ways{ false };          /**< Ver `GraphBuilder::keep_ways()`. */
+        std::vector<Way> m_ways;            /**< As vias guardadas. */
+        WayTable* m_way_table{ nullptr };   /**< Ver `GraphBuilder::set_way_table()`. */
+        bool m_keep_other_ways{ false };    /**< Ver `GraphBuilder::keep_other_ways()`. */
+        std::vector<std::size_t> m_other_nodes; /**< Os nós das vias recusadas. */
+        std::size_t m_other_unique{ 0 };    /**< Tamanho de `m_other_nodes` depois da última retirada de repetições. */
+
+        std::function<void(const Progress&)> m_progress;   /**< Ver `Options::progress`. */
+        const std::atomic<bool>* m_cancel{ nullptr };     /**< Ver `Options::cancel`. */
+        std::size_t m_bytes_total{ 0 };     /**< Total de bytes da leitura. */
+        std::size_t m_progress_base{ 0 };   /**< Ver `GraphBuilder::set_progress_base()`. */
+        std::size_t m_next_report{ std::numeric_limits<std::size_t>::max() };
+        std::size_t m_num_ways{ 0 };        /**< Vias aceitas até agora. */
+
+        std::vector<std::size_t> m_wanted;  /**< IDs desejados, ordenados. */
+        bool m_filter_nodes{ false };       /**< Se `m_wanted` está em uso. */
+
+        NodeTable m_nodes;                  /**< Todos os nós lidos. */
+        IdIndex<std::size_t> m_node_pos;    /**< ID do nó para posição em `m_nodes`. */
+        std::size_t m_indexed{ 0 };         /**< Nós de `m_nodes` já em `m_node_pos`. */
+
+        /** Vértice de cada nó de `m_nodes`, ou `NO_VERTEX` se ainda não foi
+         * adicionado ao grafo. */
+        std::vector<Graph::VertexT> m_node_vd;
+
+        std::unique_ptr<Graph> m_graph;     /**< O grafo em construção. */
+    };
+}
+
+#endif // GRAPH_BUILDER_H
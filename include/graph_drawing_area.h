@@ -6,14 +6,19 @@
 #ifndef GRAPH_DRAWING_AREA_H
 #define GRAPH_DRAWING_AREA_H
 
+#include "contraction_hierarchy.h"
+#include "landmarks.h"
+#include "csr_graph.h"
 #include "graph.h"
 
 #include <gtkmm/builder.h>
 #include <gtkmm/drawingarea.h>
 #include <gtkmm/gestureclick.h>
 
+#include <functional> // for function
 #include <optional>
-#include <memory>    // for unique_ptr
+#include <memory>    // for unique_ptr, shared_ptr
+#include <string>
 #include <utility>   // for pair
 #include <vector>
 
@@ -68,6 +73,16 @@ public:
      */
     bool has_graph() const;
 
+    /** Altera o grafo associado.
+     *
+     * `edit` é chamada com o grafo, se houver. Como alterações podem mudar os
+     * identificadores dos vértices, a seleção e o caminho são descartados
+     * antes, e o grafo é redesenhado depois.
+     *
+     * @param edit A função que altera o grafo.
+     */
+    void modify_graph(const std::function<void(Graph&)>& edit);
+
     /** Seleciona um vértice do grafo pelo ID para ser o vértice de origem.
      *
      * O vértice é selecionado pelo ID. Caso o ID não exista, o método retorna
@@ -91,12 +106,70 @@ public:
     /** Torna o grafo editável.
      *
      * Ao tornar o grafo editável, o usuário poderá incluir novos vértices e
-     * arestas ao grafo.
+     * arestas ao grafo. Ao sair do modo editável, as posições deixadas por
+     * vértices removidos são retiradas (veja `Graph::compact()`).
      *
      * @param state `true` para entrar no modo editável.
      */
     void set_editable(bool state);
 
+    /** Escolhe o algoritmo de busca de menor caminho.
+     *
+     * Se houver um caminho selecionado, ele é calculado de novo com o novo
+     * algoritmo.
+     *
+     * @param algorithm O algoritmo utilizado nas próximas buscas.
+     */
+    void set_path_algorithm(Graph::PathAlgorithm algorithm);
+
+    /** Retorna a forma CSR do grafo associado, ou nulo se não houver grafo.
+     * Veja `Graph::frozen()`.
+     */
+    std::shared_ptr<const CsrGraph> get_frozen_graph() const;
+
+    /** Se o grafo associado tem uma hierarquia de contração atual. */
+    bool has_hierarchy() const;
+
+    /** Passa a hierarquia de contração `hierarchy` ao grafo associado.
+     *
+     * É descartada se o grafo foi alterado desde que a hierarquia começou a
+     * ser montada (veja `Graph::set_hierarchy()`). Se a busca com hierarquia
+     * estiver escolhida e houver um caminho selecionado, ele é calculado de
+     * novo.
+     *
+     * @param hierarchy A hierarquia.
+     */
+    void set_hierarchy(std::shared_ptr<const ContractionHierarchy> hierarchy);
+
+    /** Passa os landmarks `landmarks` ao grafo associado.
+     *
+     * Assim como em `GraphDrawingArea::set_hierarchy()`, são descartados se
+     * o grafo foi alterado desde o início do cálculo, e o caminho
+     * selecionado é calculado de novo se a busca com landmarks estiver
+     * escolhida.
+     *
+     * @param landmarks Os landmarks.
+     */
+    void set_landmarks(std::shared_ptr<const Landmarks> landmarks);
+
+    /** Colore a região ao alcance da origem selecionada, por faixas de
+     * distância (veja `Graph::reachable()`).
+     *
+     * A região é calculada de novo a cada nova origem. Com a região
+     * exibida, arrastar a origem a leva ao vértice sob o cursor.
+     *
+     * @param budgets Os limites de distância de cada faixa. Vazio para
+     *        deixar de exibir a região.
+     */
+    void set_reachable_budgets(std::vector<double> budgets);
+
+    /** Destaca as arestas das vias cujo nome começa com `prefix`, sem
+     * distinguir maiúsculas de minúsculas (veja `Graph::name_index()`).
+     *
+     * @param prefix O início dos nomes. Vazio para deixar de destacar.
+     */
+    void set_street_prefix(std::string prefix);
+
     /** Causa a exibição das setas de direção das arestas.
      *
      * Ao habilitar a exibição, pequenas setas serão desenhadas sobre as arestas
@@ -177,6 +250,16 @@ public:
      */
     std::optional<double> get_elapsed_time() const;
 
+    /** Retorna o número de vértices fixados pela última busca de caminho.
+     *
+     * Indica o trabalho feito pelo algoritmo de busca: quanto menor, menos
+     * do grafo a busca precisou explorar. Pode retornar nulo, caso não
+     * exista um caminho selecionado.
+     *
+     * @return O número de vértices fixados, ou nulo.
+     */
+    std::optional<std::size_t> get_num_settled() const;
+
     /** Sinal emitido sempre que a seleção de vértices mudar.
      *
      * Um cliente que intercepte este sinal, pode solicitar informações sobre
@@ -208,6 +291,12 @@ private:
      */
     void on_drag_update(double offset_x, double offset_y);
 
+    /** Captura o fim da ação de "arrasto" do usuário.
+     * @param offset_x O quanto a ação se distanciou do ponto de origem.
+     * @param offset_y O quanto a ação se distanciou do ponto de origem.
+     */
+    void on_drag_end(double offset_x, double offset_y);
+
     /** Captura a ação de clique do mouse do usuário.
      * @param n_press Quantas vezes o botão de mouse foi pressionado.
      * @param x A coordenada onde ocorreu o clique.
@@ -249,22 +338,39 @@ private:
      */
     void set_tgt_vertex(const Graph::VertexT& vertex);
 
+    /** Calcula de novo a região ao alcance da origem, se estiver exibida. */
+    void update_reachable();
+
+    /** Compacta o grafo (veja `Graph::compact()`), renumerando os vértices
+     * selecionados e o caminho. */
+    void compact_graph();
+
     bool m_editable{ false };       /**< Flag de modo edição. */
     bool m_view_arrows{ false };    /**< Flag de exibição de setas. */
     bool m_view_weights{ false };   /**< Flag de exibição de pesos. */
 
+    /** Algoritmo de busca de menor caminho. */
+    Graph::PathAlgorithm m_path_algorithm{ Graph::PathAlgorithm::dijkstra };
+
     double m_scale_factor{ 1.0 };   /**< Armazena o fator de escala (zoom). */
     double m_offset_x{ 0.0 };       /**< Armazena o offset da visualização, com relação ao centro. */
     double m_offset_y{ 0.0 };       /**< Armazena o offset da visualização, com relação ao centro. */
     double m_drag_start_x{ 0.0 };   /**< Armazena o ponto de origem da ação de pan. */
     double m_drag_start_y{ 0.0 };   /**< Armazena o ponto de origem da ação de pan. */
+    double m_drag_press_x{ 0.0 };   /**< Onde o arrasto começou, em pixels. */
+    double m_drag_press_y{ 0.0 };   /**< Onde o arrasto começou, em pixels. */
+    bool m_dragging_src{ false };   /**< Se o arrasto move a origem, em vez da visualização. */
 
     std::unique_ptr<Graph> m_graph{ nullptr };      /**< Grafo. */
     std::optional<Graph::VertexT> m_src_vertex{};   /**< Vértice de origem. */
     std::optional<Graph::VertexT> m_tgt_vertex{};   /**< Vértice de destino. */
     std::optional<double> m_path_distance;          /**< Distância. */
     std::optional<double> m_path_processing_time;   /**< Tempo de processamento do menor caminho. */
+    std::optional<std::size_t> m_path_settled;      /**< Vértices fixados pela busca. */
     std::vector<Graph::VertexT> m_path;             /**< Vetor com os vértices entre origem e destino. */
+    std::vector<double> m_reachable_budgets;        /**< Ver `GraphDrawingArea::set_reachable_budgets()`. */
+    Graph::Reachable m_reachable;                   /**< A região ao alcance da origem. */
+    std::string m_street_prefix;                    /**< Ver `GraphDrawingArea::set_street_prefix()`. */
 
     SignalChangedSelection m_signal_changed_selection; /**< Sinal emitido. */
 };
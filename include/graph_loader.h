@@ -0,0 +1,127 @@
+/** @file graph_loader.h
+ *
+ * Interface pública da classe `GraphLoader`.
+ */
+#ifndef GRAPH_LOADER_H
+#define GRAPH_LOADER_H
+
+#include "graph.h"
+#include "osm_parser.h"
+
+#include <glibmm/dispatcher.h>
+#include <sigc++/signal.h>
+
+#include <atomic>
+#include <exception>    // for exception_ptr
+#include <memory>       // for unique_ptr
+#include <mutex>
+#include <string>
+#include <thread>
+
+
+/** Carrega grafos em segundo plano.
+ *
+ * A leitura de um arquivo grande pode levar vários segundos. `GraphLoader`
+ * faz a leitura em uma thread própria, para que a interface continue
+ * respondendo, e informa o andamento e o fim da leitura por sinais emitidos
+ * no laço principal do GTK. Os sinais podem, então, atualizar widgets
+ * diretamente.
+ *
+ * Primeiro é procurado um snapshot atualizado do arquivo no cache do usuário
+ * (veja `graph_snapshot.h`). Se não houver, o arquivo é lido com
+ * `osm_parser::parse()` e um snapshot é gravado para a próxima vez.
+ *
+ * A instância deve ser criada e utilizada na thread do laço principal.
+ */
+class GraphLoader
+{
+public:
+    using SignalProgress = sigc::signal<void(const osm_parser::Progress&)>;
+    using SignalFinished = sigc::signal<void()>;
+
+    GraphLoader();
+
+    /** Cancela a leitura em andamento, se houver, e aguarda seu fim. */
+    ~GraphLoader();
+
+    GraphLoader(const GraphLoader&) = delete;
+    GraphLoader& operator=(const GraphLoader&) = delete;
+
+    /** Começa a carregar o grafo de `filename`.
+     *
+     * Não deve ser chamado enquanto outra leitura estiver em andamento.
+     *
+     * @param filename O caminho do arquivo OSM.
+     * @param simplify Se o grafo deve ser simplificado (veja `graph_simplify.h`).
+     * @param profile O perfil de rota (veja `routing_profile.h`).
+     */
+    void start(const std::string& filename, bool simplify,
+               osm_parser::Profile profile);
+
+    /** Pede o cancelamento da leitura em andamento.
+     *
+     * A leitura termina assim que possível e `GraphLoader::signal_finished()`
+     * é emitido normalmente.
+     */
+    void cancel();
+
+    /** Retorna `true` entre `GraphLoader::start()` e o fim da leitura. */
+    bool is_running() const;
+
+    /** Retorna o grafo carregado.
+     *
+     * Deve ser chamado depois de `GraphLoader::signal_finished()`. Se a
+     * leitura falhou, a exceção correspondente é jogada: `osm_parser::ParserError`
+     * se o arquivo não pôde ser lido, ou `osm_parser::Cancelled` se a leitura
+     * foi cancelada.
+     *
+     * @return O grafo.
+     */
+    std::unique_ptr<Graph> take_result();
+
+    /** Retorna as vias do grafo carregado, para `osm_parser::apply_changes()`.
+     *
+     * Deve ser chamado depois de `GraphLoader::take_result()`. Grafos
+     * simplificados não têm vias, e a tabela retornada é inválida.
+     */
+    osm_parser::WayTable take_way_table();
+
+    /** Sinal emitido com o andamento da leitura.
+     *
+     * Se a leitura avançar mais rápido do que o laço principal consegue
+     * atender, apenas o andamento mais recente é emitido.
+     */
+    SignalProgress signal_progress();
+
+    /** Sinal emitido quando a leitura termina, com sucesso ou não. */
+    SignalFinished signal_finished();
+
+private:
+    /** Executada na thread de leitura. */
+    void run(std::string filename, bool simplify, osm_parser::Profile profile);
+
+    /** Repassa o andamento mais recente, no laço principal. */
+    void on_progress();
+
+    /** Encerra a thread de leitura, no laço principal. */
+    void on_finished();
+
+    std::thread m_thread;                   /**< A thread de leitura. */
+    std::atomic<bool> m_cancel{ false };    /**< Ver `osm_parser::Options::cancel`. */
+    bool m_running{ false };                /**< Ver `GraphLoader::is_running()`. */
+
+    std::mutex m_mutex;                     /**< Protege os membros abaixo. */
+    osm_parser::Progress m_progress{};      /**< O andamento mais recente. */
+    bool m_progress_pending{ false };       /**< Se `m_progress` ainda não foi emitido. */
+    std::unique_ptr<Graph> m_result;        /**< O grafo carregado. */
+    osm_parser::WayTable m_way_table;       /**< As vias do grafo carregado. */
+    std::exception_ptr m_error;             /**< O erro da leitura, se houve. */
+
+    Glib::Dispatcher m_progress_dispatcher;
+    Glib::Dispatcher m_finished_dispatcher;
+
+    SignalProgress m_signal_progress;
+    SignalFinished m_signal_finished;
+};
+
+#endif // GRAPH_LOADER_H
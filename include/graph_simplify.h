@@ -0,0 +1,48 @@
+/** @file graph_simplify.h
+ *
+ * Simplificação da topologia de grafos de vias.
+ *
+ * Em um mapa OSM, cada ponto que desenha a forma de uma via é um nó. Uma rua
+ * curva com 40 nós vira 39 vértices intermediários, que não são cruzamentos
+ * e só servem para desenhar a curva. A simplificação remove esses vértices
+ * de passagem, juntando as arestas de cada trecho entre dois cruzamentos em
+ * uma só, que guarda os pontos removidos em `Graph::EdgeProperties::geometry`.
+ *
+ * O grafo simplificado tem muito menos vértices para o cálculo de caminhos,
+ * e as distâncias entre os vértices que restam não mudam. Como as arestas
+ * guardam sua forma, o mapa desenhado continua o mesmo.
+ */
+#ifndef GRAPH_SIMPLIFY_H
+#define GRAPH_SIMPLIFY_H
+
+#include "graph.h"
+
+#include <memory>       // for unique_ptr
+
+
+namespace graph_simplify
+{
+    /** Cria uma versão simplificada de `graph`.
+     *
+     * Um vértice é de passagem quando está no meio de um trecho de via:
+     *
+     * - em vias de mão única, tem exatamente uma aresta de entrada e uma de
+     *   saída, ligadas a vizinhos diferentes;
+     * - em vias de mão dupla, tem exatamente duas arestas de entrada e duas de
+     *   saída, indo e vindo dos mesmos dois vizinhos.
+     *
+     * Além disso, todas as suas arestas devem ter o mesmo nome e sentido, de
+     * forma que vias diferentes não são unidas. Os demais vértices são
+     * mantidos, na mesma ordem relativa. Um ciclo formado só por vértices de
+     * passagem mantém um de seus vértices.
+     *
+     * O peso de cada nova aresta é a soma dos pesos das arestas que ela
+     * substitui.
+     *
+     * @param graph O grafo original, que não é alterado.
+     * @return O grafo simplificado.
+     */
+    std::unique_ptr<Graph> contract_chains(const Graph& graph);
+}
+
+#endif // GRAPH_SIMPLIFY_H
@@ -0,0 +1,94 @@
+/** @file graph_snapshot.h
+ *
+ * Cache binário de grafos já carregados.
+ *
+ * Ler um arquivo OSM grande e montar o grafo leva tempo. Depois que um
+ * arquivo é lido pela primeira vez, o grafo resultante pode ser gravado em
+ * um arquivo binário compacto (um "snapshot"), que é carregado quase
+ * instantaneamente da próxima vez que o mesmo arquivo for aberto.
+ *
+ * Cada snapshot guarda uma chave identificando o arquivo de origem (tamanho,
+ * data de modificação e um hash do conteúdo). Um snapshot cuja chave não
+ * corresponda ao arquivo atual é ignorado.
+ */
+#ifndef GRAPH_SNAPSHOT_H
+#define GRAPH_SNAPSHOT_H
+
+#include "graph.h"
+#include "way_table.h"
+
+#include <cstdint>
+#include <memory>       // for unique_ptr
+#include <string>
+
+
+namespace graph_snapshot
+{
+    /** Identifica o conteúdo de um arquivo de origem. */
+    struct SourceKey
+    {
+        std::uint64_t size;     /**< Tamanho do arquivo, em bytes. */
+        std::int64_t mtime;     /**< Data de modificação, na unidade do sistema de arquivos. */
+        std::uint64_t hash;     /**< Hash de todo o conteúdo do arquivo. */
+
+        bool operator==(const SourceKey&) const = default;
+    };
+
+    /** Calcula a chave do arquivo `filename`.
+     *
+     * O arquivo inteiro é lido para calcular o hash, mas isso é muito mais
+     * rápido que interpretá-lo. Pode jogar (throw) `MappedFile::Error`.
+     *
+     * @param filename O caminho do arquivo de origem.
+     * @return A chave do arquivo.
+     */
+    SourceKey make_key(const std::string& filename);
+
+    /** Retorna o caminho do snapshot de `filename` em `cache_dir`.
+     *
+     * O nome do snapshot é derivado do caminho absoluto do arquivo de origem,
+     * de forma que arquivos diferentes não compartilham o mesmo snapshot.
+     * Grafos diferentes lidos do mesmo arquivo (por exemplo, simplificado ou
+     * não) são distinguidos por `variant`.
+     *
+     * @param cache_dir O diretório de cache da aplicação.
+     * @param filename O caminho do arquivo de origem.
+     * @param variant Identifica o tipo de grafo gerado a partir do arquivo.
+     * @return O caminho do snapshot.
+     */
+    std::string cache_path(const std::string& cache_dir,
+                           const std::string& filename,
+                           const std::string& variant = {});
+
+    /** Grava o grafo em um snapshot.
+     *
+     * O arquivo é escrito em um nome temporário e renomeado no fim, para que
+     * um snapshot incompleto nunca seja lido. Diretórios que não existirem
+     * são criados.
+     *
+     * @param graph O grafo a ser gravado.
+     * @param path O caminho do snapshot.
+     * @param key A chave do arquivo de origem do grafo.
+     * @param ways As vias do grafo, gravadas junto com ele, ou nulo.
+     * @return `true` se o snapshot foi gravado.
+     */
+    bool save(const Graph& graph, const std::string& path, const SourceKey& key,
+              const osm_parser::WayTable* ways = nullptr);
+
+    /** Carrega o grafo de um snapshot.
+     *
+     * O snapshot é mapeado em memória e o grafo é montado diretamente a
+     * partir dele.
+     *
+     * @param path O caminho do snapshot.
+     * @param key A chave esperada do arquivo de origem.
+     * @param ways Tabela a preencher com as vias do grafo, ou nulo. Se não
+     *        for nula, um snapshot gravado sem as vias não é carregado.
+     * @return O grafo, ou nulo se o snapshot não existir, for de outra versão,
+     *         estiver corrompido ou tiver sido gerado de outro conteúdo.
+     */
+    std::unique_ptr<Graph> load(const std::string& path, const SourceKey& key,
+                                osm_parser::WayTable* ways = nullptr);
+}
+
+#endif // GRAPH_SNAPSHOT_H
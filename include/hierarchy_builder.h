@@ -0,0 +1,112 @@
+/** @file hierarchy_builder.h
+ *
+ * Interface pública da classe `HierarchyBuilder`.
+ */
+#ifndef HIERARCHY_BUILDER_H
+#define HIERARCHY_BUILDER_H
+
+#include "contraction_hierarchy.h"
+#include "csr_graph.h"
+#include "landmarks.h"
+
+#include <glibmm/dispatcher.h>
+#include <sigc++/signal.h>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>       // for shared_ptr
+#include <mutex>
+#include <thread>
+
+
+/** Monta hierarquias de contração e landmarks em segundo plano.
+ *
+ * Montar a hierarquia de um grafo grande leva bem mais tempo que lê-lo.
+ * `HierarchyBuilder` faz a montagem em uma thread própria, a partir da forma
+ * CSR do grafo (veja `Graph::frozen()`), que não muda e pode ser lida ao
+ * mesmo tempo pela interface. Os landmarks, bem mais rápidos, são calculados
+ * primeiro, e ficam disponíveis enquanto a hierarquia é montada. O fim de
+ * cada etapa é informado por um sinal emitido no laço principal do GTK.
+ *
+ * A instância deve ser criada e utilizada na thread do laço principal.
+ */
+class HierarchyBuilder
+{
+public:
+    using SignalFinished = sigc::signal<void()>;
+
+    HierarchyBuilder();
+
+    /** Cancela a montagem em andamento, se houver, e aguarda seu fim. */
+    ~HierarchyBuilder();
+
+    HierarchyBuilder(const HierarchyBuilder&) = delete;
+    HierarchyBuilder& operator=(const HierarchyBuilder&) = delete;
+
+    /** Começa a calcular os landmarks e montar a hierarquia de `graph`.
+     *
+     * Uma montagem em andamento é cancelada antes, sem emitir os sinais.
+     *
+     * @param graph A forma CSR do grafo.
+     */
+    void start(std::shared_ptr<const CsrGraph> graph);
+
+    /** Cancela a montagem em andamento, se houver, e aguarda seu fim.
+     * Os sinais não são emitidos. */
+    void cancel();
+
+    /** Retorna `true` entre `HierarchyBuilder::start()` e o fim da montagem. */
+    bool is_running() const;
+
+    /** Retorna o grafo da montagem em andamento, ou nulo se não houver. */
+    const std::shared_ptr<const CsrGraph>& graph() const { return m_graph; }
+
+    /** Retorna a hierarquia montada, ou nulo se a montagem falhou.
+     *
+     * Deve ser chamado depois de `HierarchyBuilder::signal_finished()`.
+     */
+    std::shared_ptr<const ContractionHierarchy> take_result();
+
+    /** Retorna os landmarks calculados, ou nulo se o cálculo falhou.
+     *
+     * Deve ser chamado depois de `HierarchyBuilder::signal_landmarks_ready()`.
+     */
+    std::shared_ptr<const Landmarks> take_landmarks();
+
+    /** Sinal emitido quando os landmarks estão prontos, antes da hierarquia. */
+    SignalFinished signal_landmarks_ready();
+
+    /** Sinal emitido quando a montagem termina. */
+    SignalFinished signal_finished();
+
+private:
+    /** Executada na thread de montagem. */
+    void run(std::shared_ptr<const CsrGraph> graph, std::size_t generation);
+
+    /** Avisa que os landmarks estão prontos, no laço principal. */
+    void on_landmarks_ready();
+
+    /** Encerra a thread de montagem, no laço principal. */
+    void on_finished();
+
+    std::thread m_thread;                   /**< A thread de montagem. */
+    std::atomic<bool> m_cancel{ false };    /**< Ver `ContractionHierarchy::build()`. */
+    bool m_running{ false };                /**< Ver `HierarchyBuilder::is_running()`. */
+    std::shared_ptr<const CsrGraph> m_graph; /**< Ver `HierarchyBuilder::graph()`. */
+
+    /** Conta as montagens canceladas, para descartar seus resultados. */
+    std::size_t m_generation{ 0 };
+
+    std::mutex m_mutex;                     /**< Protege os membros abaixo. */
+    std::shared_ptr<const ContractionHierarchy> m_result; /**< A hierarquia montada. */
+    std::size_t m_result_generation{ 0 };   /**< A geração de `m_result`. */
+    std::shared_ptr<const Landmarks> m_landmarks; /**< Os landmarks calculados. */
+    std::size_t m_landmarks_generation{ 0 }; /**< A geração de `m_landmarks`. */
+
+    Glib::Dispatcher m_landmarks_dispatcher;
+    Glib::Dispatcher m_finished_dispatcher;
+    SignalFinished m_signal_landmarks_ready;
+    SignalFinished m_signal_finished;
+};
+
+#endif // HIERARCHY_BUILDER_H
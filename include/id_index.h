@@ -0,0 +1,262 @@
+/** @file id_index.h
+ *
+ * Interface pública da classe `IdIndex`.
+ */
+#ifndef ID_INDEX_H
+#define ID_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>       // for numeric_limits<>::max()
+#include <stdexcept>
+#include <utility>      // for move(), pair
+#include <vector>
+
+
+/** Índice de IDs numéricos para valores do tipo `T`.
+ *
+ * Tabela hash com endereçamento aberto e sondagem linear, guardada em um
+ * único vetor. Cada busca costuma tocar uma só linha de cache, enquanto uma
+ * `std::map` percorre uma árvore de ponteiros, o que faz diferença em
+ * arquivos OSM com milhões de nós.
+ *
+ * O ID `IdIndex::RESERVED_ID` (o maior `std::size_t`) marca posições vazias
+ * e não pode ser utilizado. Ponteiros retornados deixam de ser válidos
+ * depois de qualquer inserção ou remoção.
+ */
+template<typename T>
+class IdIndex
+{
+public:
+    /** ID que não pode ser inserido no índice. */
+    static constexpr std::size_t RESERVED_ID = std::numeric_limits<std::size_t>::max();
+
+    IdIndex() = default;
+
+    /** Cria um índice com espaço para `count` IDs sem realocação. */
+    explicit IdIndex(std::size_t count)
+    {
+        reserve(count);
+    }
+
+    /** Retorna o número de IDs no índice. */
+    std::size_t size() const { return m_size; }
+
+    /** Retorna `true` se o índice está vazio. */
+    bool empty() const { return m_size == 0; }
+
+    /** Remove todos os IDs, mantendo a memória alocada. */
+    void clear()
+    {
+        for (auto& slot: m_slots)
+            slot.id = RESERVED_ID;
+
+        m_size = 0;
+    }
+
+    /** Garante espaço para `count` IDs sem realocação. */
+    void reserve(std::size_t count)
+    {
+        std::size_t capacity = MIN_CAPACITY;
+
+        while (capacity * MAX_LOAD_NUM < count * MAX_LOAD_DEN)
+            capacity *= 2;
+
+        if (capacity > m_slots.size())
+            rehash(capacity);
+    }
+
+    /** Insere `id` com o valor `value`, se ele ainda não estiver no índice.
+     *
+     * Pode jogar (throw) `std::invalid_argument` se `id` for `RESERVED_ID`.
+     *
+     * @param id O ID.
+     * @param value O valor associado.
+     * @return Um ponteiro para o valor associado a `id` e `true` se a inserção
+     *         foi feita, ou `false` se `id` já existia (e o valor não mudou).
+     */
+    std::pair<T*, bool> try_emplace(std::size_t id, T value)
+    {
+        if (id == RESERVED_ID)
+            throw std::invalid_argument("IdIndex: reserved id");
+
+        if ((m_size + 1) * MAX_LOAD_DEN > m_slots.size() * MAX_LOAD_NUM)
+            rehash(m_slots.empty() ? MIN_CAPACITY : 2 * m_slots.size());
+
+        std::size_t i = home(id);
+
+        while (m_slots[i].id != RESERVED_ID)
+        {
+            if (m_slots[i].id == id)
+                return { &m_slots[i].value, false };
+
+            i = (i + 1) & m_mask;
+        }
+
+        m_slots[i].id = id;
+        m_slots[i].value = std::move(value);
+        ++m_size;
+
+        return { &m_slots[i].value, true };
+    }
+
+    /** Associa `value` a `id`, inserindo ou substituindo.
+     * Pode jogar (throw) `std::invalid_argument` se `id` for `RESERVED_ID`.
+     */
+    void insert_or_assign(std::size_t id, T value)
+    {
+        auto [ptr, inserted] = try_emplace(id, value);
+
+        if (!inserted)
+            *ptr = std::move(value);
+    }
+
+    /** Busca o valor associado a `id`.
+     * @return Um ponteiro para o valor, ou nulo se `id` não está no índice.
+     */
+    T* find(std::size_t id)
+    {
+        return const_cast<T*>(std::as_const(*this).find(id));
+    }
+
+    /** Busca o valor associado a `id`.
+     * @return Um ponteiro para o valor, ou nulo se `id` não está no índice.
+     */
+    const T* find(std::size_t id) const
+    {
+        if (m_size == 0 || id == RESERVED_ID)
+            return nullptr;
+
+        for (std::size_t i = home(id); m_slots[i].id != RESERVED_ID; i = (i + 1) & m_mask)
+        {
+            if (m_slots[i].id == id)
+                return &m_slots[i].value;
+        }
+
+        return nullptr;
+    }
+
+    /** Retorna `true` se `id` está no índice. */
+    bool contains(std::size_t id) const
+    {
+        return find(id) != nullptr;
+    }
+
+    /** Remove `id` do índice.
+     * @return `true` se `id` estava no índice.
+     */
+    bool erase(std::size_t id)
+    {
+        if (m_size == 0 || id == RESERVED_ID)
+            return false;
+
+        std::size_t i = home(id);
+
+        while (m_slots[i].id != id)
+        {
+            if (m_slots[i].id == RESERVED_ID)
+                return false;
+
+            i = (i + 1) & m_mask;
+        }
+
+        // Backward shift deletion: entries after the hole that would be
+        // unreachable from their home slot are moved into it, so no
+        // tombstones are needed.
+        for (std::size_t j = (i + 1) & m_mask; m_slots[j].id != RESERVED_ID; j = (j + 1) & m_mask)
+        {
+            std::size_t h = home(m_slots[j].id);
+
+            // Whether h lies cyclically in (i, j]; if so, the entry stays.
+            bool stays = i <= j ? (i < h && h <= j) : (i < h || h <= j);
+
+            if (!stays)
+            {
+                m_slots[i] = std::move(m_slots[j]);
+                i = j;
+            }
+        }
+
+        m_slots[i].id = RESERVED_ID;
+        --m_size;
+
+        return true;
+    }
+
+    /** Chama `fn(id, value)` para cada ID do índice, em ordem arbitrária. */
+    template<typename F>
+    void for_each(F fn) const
+    {
+        for (const auto& slot: m_slots)
+        {
+            if (slot.id != RESERVED_ID)
+                fn(slot.id, slot.value);
+        }
+    }
+
+    /** Chama `fn(id, value)` para cada ID do índice, em ordem arbitrária.
+     * `fn` pode alterar o valor, mas não inserir nem remover IDs. */
+    template<typename F>
+    void for_each(F fn)
+    {
+        for (auto& slot: m_slots)
+        {
+            if (slot.id != RESERVED_ID)
+                fn(slot.id, slot.value);
+        }
+    }
+
+private:
+    static constexpr std::size_t MIN_CAPACITY = 16;
+
+    // At most 7/8 of the slots are used. Linear probing stays short up to
+    // that point with well spread hashes.
+    static constexpr std::size_t MAX_LOAD_NUM = 7;
+    static constexpr std::size_t MAX_LOAD_DEN = 8;
+
+    struct Slot
+    {
+        std::size_t id{ RESERVED_ID };
+        T value{};
+    };
+
+    /* Fibonacci hashing: OSM ids are mostly sequential, and the
+     * multiplication spreads them over the whole table. */
+    std::size_t home(std::size_t id) const
+    {
+        return static_cast<std::size_t>(
+            (static_cast<std::uint64_t>(id) * 0x9E3779B97F4A7C15ULL) >> m_shift);
+    }
+
+    void rehash(std::size_t capacity)
+    {
+        std::vector<Slot> old{ std::move(m_slots) };
+
+        m_slots.assign(capacity, Slot{});
+        m_mask = capacity - 1;
+        m_shift = 64;
+
+        for (std::size_t c = capacity; c > 1; c /= 2)
+            --m_shift;
+
+        for (auto& slot: old)
+        {
+            if (slot.id == RESERVED_ID)
+                continue;
+
+            std::size_t i = home(slot.id);
+
+            while (m_slots[i].id != RESERVED_ID)
+                i = (i + 1) & m_mask;
+
+            m_slots[i] = std::move(slot);
+        }
+    }
+
+    std::vector<Slot> m_slots;      /**< A tabela; o tamanho é uma potência de 2. */
+    std::size_t m_size{ 0 };        /**< Número de IDs na tabela. */
+    std::size_t m_mask{ 0 };        /**< `m_slots.size() - 1`. */
+    unsigned m_shift{ 64 };         /**< Bits descartados pelo hash. */
+};
+
+#endif // ID_INDEX_H
@@ -65,6 +65,11 @@ public:
      */
     void set_elapsed_time(std::optional<double> elapsed = {});
 
+    /** Exibe o número de vértices fixados pelo algoritmo de busca.
+     * @param settled O número de vértices fixados na última busca.
+     */
+    void set_settled(std::optional<std::size_t> settled = {});
+
 private:
     Gtk::Label* m_num;
     Gtk::Label* m_num_path;
@@ -72,6 +77,7 @@ private:
     Gtk::Label* m_tgt;
     Gtk::Label* m_distance;
     Gtk::Label* m_elapsed;
+    Gtk::Label* m_settled;
 };
 
 #endif // INFO_FIELD_H
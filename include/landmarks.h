@@ -0,0 +1,132 @@
+/** @file landmarks.h
+ *
+ * Interface pública da classe `Landmarks`.
+ */
+#ifndef LANDMARKS_H
+#define LANDMARKS_H
+
+#include "csr_graph.h"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>       // for shared_ptr, unique_ptr, weak_ptr
+#include <vector>
+
+
+/** Tabelas de distâncias até alguns vértices escolhidos (landmarks), para
+ * estimativas do A* (ALT: A*, landmarks e desigualdade triangular).
+ *
+ * A distância em linha reta pouco ajuda o A* quando a rede obriga a grandes
+ * desvios, como rios, mãos únicas e rodovias. Com a distância de cada
+ * vértice até um landmark `L` e de `L` até cada vértice, a desigualdade
+ * triangular dá limites inferiores para a distância entre dois vértices
+ * quaisquer:
+ *
+ *     d(v, t) >= d(L, t) - d(L, v)    e    d(v, t) >= d(v, L) - d(t, L)
+ *
+ * Landmarks "atrás" da origem ou "depois" do destino dão limites próximos
+ * da distância real. Em cada busca, só os landmarks com os melhores limites
+ * entre a origem e o destino são usados (veja `Landmarks::choose_active()`).
+ *
+ * O pré-processamento é bem mais rápido que o de `ContractionHierarchy`:
+ * duas buscas de Dijkstra completas por landmark, feitas em paralelo. As
+ * tabelas também continuam valendo depois de algumas alterações do grafo
+ * (veja `Graph::set_landmarks()`).
+ *
+ * As distâncias são guardadas como `float`, lado a lado por vértice, para
+ * que uma estimativa leia uma única linha de cache. Os limites descontam o
+ * erro de arredondamento, e continuam sendo limites inferiores.
+ */
+class Landmarks
+{
+public:
+    using Index = CsrGraph::Index;
+
+    /** Como os landmarks são escolhidos. */
+    enum class Selection
+    {
+        /** Cada landmark é o vértice mais distante dos já escolhidos. */
+        farthest,
+
+        /** "Avoid" (Goldberg e Werneck): cada landmark fica onde os já
+         * escolhidos dão os piores limites, a partir de uma árvore de
+         * caminhos mínimos com raiz aleatória. Mais lenta, mas dá limites
+         * melhores. */
+        avoid,
+    };
+
+    /** Número de landmarks, por padrão. */
+    static constexpr std::size_t DEFAULT_COUNT = 16;
+
+    /** Número de landmarks usados em cada busca. */
+    static constexpr std::size_t ACTIVE_COUNT = 4;
+
+    /** Escolhe os landmarks de `graph` e calcula suas tabelas.
+     *
+     * @param graph O grafo.
+     * @param count O número de landmarks. Pode ser menor em grafos com
+     *        poucos vértices.
+     * @param selection Como os landmarks são escolhidos.
+     * @param cancel Sinal de cancelamento, ou nulo. Pode ser alterado por
+     *        outra thread; quando for `true`, o processamento é interrompido.
+     * @return As tabelas, ou nulo se o processamento foi cancelado.
+     */
+    static std::unique_ptr<Landmarks> build(
+        std::shared_ptr<const CsrGraph> graph,
+        std::size_t count = DEFAULT_COUNT,
+        Selection selection = Selection::avoid,
+        const std::atomic<bool>* cancel = nullptr);
+
+    /** Retorna o grafo a partir do qual as tabelas foram calculadas, se
+     * ele ainda existir. */
+    const std::weak_ptr<const CsrGraph>& graph() const { return m_graph; }
+
+    /** Retorna o número de landmarks. */
+    std::size_t num_landmarks() const { return m_landmarks.size(); }
+
+    /** Retorna os vértices escolhidos como landmarks. */
+    const std::vector<Index>& vertices() const { return m_landmarks; }
+
+    /** Escolhe os landmarks usados na busca entre `src` e `tgt`: os
+     * `ACTIVE_COUNT` que dão os maiores limites para essa distância.
+     *
+     * @return Os índices dos landmarks escolhidos.
+     */
+    std::vector<std::size_t> choose_active(Index src, Index tgt) const;
+
+    /** Retorna um limite inferior para a distância de `vertex` até `tgt`.
+     *
+     * Vértices acrescentados ao grafo depois do cálculo das tabelas não têm
+     * limite, e o retorno é zero.
+     *
+     * @param vertex O vértice.
+     * @param tgt O destino.
+     * @param active Os landmarks usados, de `Landmarks::choose_active()`.
+     * @return O limite, que pode ser zero.
+     */
+    double bound(Index vertex, Index tgt, const std::vector<std::size_t>& active) const;
+
+private:
+    Landmarks() = default;
+
+    /** Limite dado pelo landmark `landmark` para a distância de `vertex`
+     * até `tgt`, ambos com tabelas. */
+    double bound_by(std::size_t landmark, Index vertex, Index tgt) const;
+
+    std::weak_ptr<const CsrGraph> m_graph;  /**< O grafo de origem. */
+    std::size_t m_num_vertices{ 0 };        /**< Os vértices com tabelas. */
+    std::vector<Index> m_landmarks;         /**< Os landmarks. */
+
+    /** Colunas por vértice nas tabelas. Durante o cálculo, o número de
+     * landmarks pedido; depois, `num_landmarks()`. */
+    std::size_t m_stride{ 0 };
+
+    /** Distância de cada landmark até cada vértice, na posição
+     * `vertex * m_stride + landmark`. Infinita se não houver caminho. */
+    std::vector<float> m_from;
+
+    /** Distância de cada vértice até cada landmark, na mesma disposição. */
+    std::vector<float> m_to;
+};
+
+#endif // LANDMARKS_H
@@ -2,14 +2,21 @@
 #define MAIN_WINDOW_H
 
 #include "graph_drawing_area.h"
+#include "graph_loader.h"
+#include "hierarchy_builder.h"
 #include "infofield.h"
 #include "searchfield.h"
 
 #include <gtkmm/applicationwindow.h>
+#include <gtkmm/box.h>
 #include <gtkmm/builder.h>
 #include <gtkmm/button.h>
 #include <gtkmm/checkbutton.h>
+#include <gtkmm/dropdown.h>
 #include <gtkmm/filedialog.h>
+#include <gtkmm/progressbar.h>
+#include <gtkmm/searchentry2.h>
+#include <gtkmm/spinbutton.h>
 
 
 class GraphDrawingArea;
@@ -26,6 +33,14 @@ private:
     void on_file_selection(const Glib::RefPtr<Gio::AsyncResult>&,
                            const Glib::RefPtr<Gtk::FileDialog>&);
 
+    void on_load_progress(const osm_parser::Progress&);
+    void on_load_finished();
+
+    void apply_changes_dialog();
+
+    void on_changes_selection(const Glib::RefPtr<Gio::AsyncResult>&,
+                              const Glib::RefPtr<Gtk::FileDialog>&);
+
     void save_file_dialog();
 
     void on_save_selection(
@@ -34,19 +49,43 @@ private:
 
     void on_selection_changed();
 
+    void update_reachable();
+
+    void build_hierarchy();
+    void on_landmarks_ready();
+    void on_hierarchy_finished();
+
     void with_graph_opened(bool);
+    void with_loading(bool);
 
     GraphDrawingArea* m_graph_area;
     SearchField* m_src_field;
     SearchField* m_tgt_field;
     InfoField* m_info_field;
 
+    Gtk::Button* m_button_new;
+    Gtk::Button* m_button_open;
+    Gtk::Button* m_button_apply_changes;
     Gtk::Button* m_button_save;
     Gtk::Button* m_button_close;
 
     Gtk::CheckButton* m_toggle_edit;
     Gtk::CheckButton* m_toggle_show_arrows;
     Gtk::CheckButton* m_toggle_show_weights;
+    Gtk::CheckButton* m_toggle_simplify;
+    Gtk::CheckButton* m_toggle_reachable;
+    Gtk::SpinButton* m_reachable_budget;
+    Gtk::SearchEntry2* m_street_search;
+    Gtk::DropDown* m_profile_select;
+    Gtk::DropDown* m_algorithm_select;
+
+    Gtk::Box* m_load_box;
+    Gtk::ProgressBar* m_load_progress;
+    GraphLoader m_loader;
+    HierarchyBuilder m_hierarchy_builder;
+
+    /** As vias do grafo aberto, para os arquivos de alterações. */
+    osm_parser::WayTable m_way_table;
 };
 
 #endif // MAIN_WINDOW_H
@@ -0,0 +1,66 @@
+/** @file mapped_file.h
+ *
+ * Interface pública da classe `MappedFile`.
+ */
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+
+/** Arquivo mapeado em memória, somente para leitura.
+ *
+ * O conteúdo do arquivo fica acessível como um bloco contíguo de memória,
+ * sem que ele precise ser lido para um buffer. O sistema operacional carrega
+ * as páginas do arquivo conforme elas são acessadas.
+ *
+ * Utiliza `boost::interprocess`, de forma que funciona tanto em sistemas
+ * POSIX quanto no Windows. O mapeamento é desfeito quando a instância é
+ * destruída.
+ */
+class MappedFile
+{
+public:
+    /** Erro indicando que o arquivo não pôde ser aberto ou mapeado. */
+    class Error: public std::runtime_error
+    {
+    public:
+        explicit Error(const std::string& what)
+            : std::runtime_error(what) {}
+    };
+
+    /** Constrói uma instância vazia, sem nenhum arquivo mapeado. */
+    MappedFile() = default;
+
+    /** Mapeia o arquivo `filename` em memória.
+     *
+     * Pode jogar (throw) `MappedFile::Error` se o arquivo não existir ou não
+     * puder ser mapeado. Arquivos vazios são aceitos e resultam em um bloco
+     * de tamanho zero.
+     *
+     * @param filename O caminho para o arquivo.
+     */
+    explicit MappedFile(const std::string& filename);
+
+    MappedFile(MappedFile&&) = default;
+    MappedFile& operator=(MappedFile&&) = default;
+
+    /** Retorna o conteúdo do arquivo.
+     * @return Uma view para o bloco mapeado. Válida enquanto a instância existir.
+     */
+    std::string_view data() const;
+
+    /** Retorna o tamanho do arquivo, em bytes. */
+    std::size_t size() const;
+
+private:
+    boost::interprocess::file_mapping m_file;     /**< O arquivo aberto. */
+    boost::interprocess::mapped_region m_region;  /**< A região mapeada. */
+};
+
+#endif // MAPPED_FILE_H
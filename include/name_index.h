@@ -0,0 +1,90 @@
+/** @file name_index.h
+ *
+ * Interface pública da classe `NameIndex`.
+ */
+#ifndef NAME_INDEX_H
+#define NAME_INDEX_H
+
+#include "graph.h"
+
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>      // for pair
+#include <vector>
+
+
+/** Índice das arestas de um grafo pelos nomes das vias.
+ *
+ * Os nomes são comparados na forma de `NameIndex::normalize()`, sem
+ * distinguir maiúsculas de minúsculas. Cada nome normalizado distinto
+ * recebe uma posição, em ordem alfabética, e as arestas ficam agrupadas na
+ * mesma ordem, em um único vetor. Assim, as arestas de um nome, ou de todos
+ * os nomes que começam com um prefixo, formam um intervalo contínuo, que é
+ * retornado como um `std::span` sem copiar nada.
+ *
+ * O índice não acompanha alterações do grafo; veja `Graph::name_index()`.
+ * Arestas sem nome não entram no índice.
+ */
+class NameIndex
+{
+public:
+    using EdgeT = Graph::EdgeT;
+
+    /** Monta o índice com todas as arestas com nome de `graph`. */
+    explicit NameIndex(const Graph& graph);
+
+    /** Retorna `name` na forma usada nas comparações: as letras maiúsculas
+     * (ASCII e acentuadas do Latin-1) passam a minúsculas, e o restante do
+     * texto UTF-8 fica como está. */
+    static std::string normalize(std::string_view name);
+
+    /** Retorna o número de nomes normalizados distintos. */
+    std::size_t size() const { return m_keys.size(); }
+
+    /** Retorna o nome na posição `i`, como aparece no grafo. Se várias
+     * formas do nome diferem apenas nas maiúsculas, retorna a primeira
+     * que entrou no grafo. */
+    const std::string& name(std::size_t i) const { return m_names[i]; }
+
+    /** Busca a posição de `name`, sem distinguir maiúsculas de minúsculas.
+     * @return A posição, ou nulo se nenhuma aresta tiver esse nome.
+     */
+    std::optional<std::size_t> find(std::string_view name) const;
+
+    /** Busca as posições dos nomes que começam com `prefix`, sem distinguir
+     * maiúsculas de minúsculas.
+     * @return O intervalo `[first, last)` das posições; vazio se não houver.
+     */
+    std::pair<std::size_t, std::size_t> find_prefix(std::string_view prefix) const;
+
+    /** Retorna as arestas do nome na posição `i`. */
+    std::span<const EdgeT> edges(std::size_t i) const
+    {
+        return edges(i, i + 1);
+    }
+
+    /** Retorna as arestas dos nomes nas posições `[first, last)`. */
+    std::span<const EdgeT> edges(std::size_t first, std::size_t last) const
+    {
+        return { m_edges.data() + m_offsets[first], m_edges.data() + m_offsets[last] };
+    }
+
+    /** Retorna as arestas com nome `name`, sem distinguir maiúsculas de
+     * minúsculas, ou um intervalo vazio. */
+    std::span<const EdgeT> edges_named(std::string_view name) const;
+
+    /** Retorna as arestas cujo nome começa com `prefix`, sem distinguir
+     * maiúsculas de minúsculas, ou um intervalo vazio. */
+    std::span<const EdgeT> edges_with_prefix(std::string_view prefix) const;
+
+private:
+    std::vector<std::string> m_keys;            /**< Os nomes normalizados, em ordem. */
+    std::vector<std::string> m_names;           /**< O nome no grafo de cada posição. */
+    std::vector<std::size_t> m_offsets;         /**< Início das arestas de cada posição, e o fim. */
+    std::vector<EdgeT> m_edges;                 /**< As arestas, agrupadas por posição. */
+};
+
+#endif // NAME_INDEX_H
@@ -1,7 +1,8 @@
 /** @file osm_parser.h
  *
  * `osm_parser` é o módulo de carregamento de dados no programa.
- * Destina-se a leitura de dados no formato nativo do OpenStreetMaps.
+ * Destina-se a leitura de dados nos formatos nativos do OpenStreetMaps
+ * (OSM XML e OSM PBF).
  * Caso uma extensão seja implementada para carregar dados em outros formatos,
  * deve-se escrever outro módulo que retorne um ponteiro para uma instância
  * de `Graph`.
@@ -10,9 +11,16 @@
 #define OSM_PARSER_H
 
 #include "graph.h"
+#include "id_index.h"
+#include "routing_profile.h"
+#include "way_table.h"
 
+#include <atomic>
+#include <cstddef>
+#include <functional>   // for function
 #include <string>
 #include <stdexcept>
+#include <vector>
 
 /** Namespace osm_parser
  *
@@ -20,17 +28,203 @@
  */
 namespace osm_parser
 {
+    /** Andamento da leitura de um arquivo. */
+    struct Progress
+    {
+        std::size_t bytes_done;     /**< Bytes já lidos. */
+        std::size_t bytes_total;    /**< Total de bytes a ler, somando as duas passagens, se houver. */
+        std::size_t nodes;          /**< Nós guardados até agora. */
+        std::size_t ways;           /**< Vias aceitas até agora. */
+    };
+
+    /** Opções de leitura do arquivo. */
+    struct Options
+    {
+        /** Número de threads utilizadas na leitura.
+         *
+         * Com mais de uma thread, a seção de `<node>` de arquivos XML é
+         * dividida em pedaços, lidos e projetados em paralelo, e os blocos de
+         * arquivos PBF são decodificados em paralelo. O valor 0 utiliza o
+         * número de núcleos da máquina e 1 desliga a leitura paralela.
+         */
+        unsigned threads{ 0 };
+
+        /** Lê o arquivo em duas passagens.
+         *
+         * A primeira passagem lê apenas as vias, coletando os IDs dos nós
+         * referenciados por vias que farão parte do grafo. A segunda lê o
+         * arquivo normalmente, mas guarda apenas esses nós. Em extratos
+         * grandes, a maior parte dos nós não pertence a nenhuma via, então
+         * isso reduz bastante o pico de memória, ao custo de ler as vias duas
+         * vezes. Com `Options::keep_other_way_nodes`, são guardados também
+         * os nós das vias recusadas.
+         */
+        bool two_pass{ false };
+
+        /** Simplifica o grafo lido com `graph_simplify::contract_chains()`.
+         *
+         * Apenas cruzamentos e extremidades de vias viram vértices; os pontos
+         * intermediários ficam guardados na forma das arestas.
+         */
+        bool simplify{ false };
+
+        /** Perfil de rota, que decide quais vias entram no grafo e em que
+         * sentido (veja `routing_profile.h`).
+         */
+        Profile profile{ Profile::any_highway };
+
+        /** Chamada periodicamente com o andamento da leitura.
+         *
+         * É chamada na thread que chamou `osm_parser::parse()`, algumas
+         * centenas de vezes ao longo da leitura, e deve retornar rápido.
+         */
+        std::function<void(const Progress&)> progress;
+
+        /** Sinal de cancelamento, ou nulo.
+         *
+         * Pode ser alterado por outra thread durante a leitura. Quando for
+         * `true`, a leitura é interrompida assim que possível e
+         * `osm_parser::parse()` joga `osm_parser::Cancelled`.
+         */
+        const std::atomic<bool>* cancel{ nullptr };
+
+        /** Tabela a preencher com as vias do grafo, ou nulo.
+         *
+         * Quando não for nula, a tabela é esvaziada e recebe as vias lidas,
+         * para que o grafo possa depois receber arquivos de alterações com
+         * `osm_parser::apply_changes()`. Com `Options::simplify`, a tabela
+         * fica vazia e inválida.
+         */
+        WayTable* way_table{ nullptr };
+
+        /** Guarda na tabela de vias os nós das vias recusadas pelo perfil.
+         *
+         * Só vale com `Options::way_table`. Sem esta opção, uma alteração que
+         * passe a aceitar uma via, ou que crie uma via sobre nós que já
+         * existiam, só pode ser aplicada se trouxer os nós que não são
+         * vértices; do contrário, `osm_parser::apply_changes()` pede que o
+         * mapa seja lido de novo. Com ela, as coordenadas dos nós de todas as
+         * vias visíveis (prédios, áreas, etc.) ficam na tabela e nos
+         * snapshots, o que pode ocupar mais memória que o próprio grafo e
+         * desfaz boa parte da economia de `Options::two_pass`.
+         */
+        bool keep_other_way_nodes{ false };
+    };
+
     /** Carrega um novo grafo a partir do arquivo.
      *
      * Esta função é responsável por carregar um novo grafo a partir do arquivo
-     * em formato OSM XML. Ela pode jogar (throw) `osm_parser::ParserError` e
-     * retornar nulo caso a leitura não seja bem suscedida.
+     * em formato OSM XML ou OSM PBF. O formato é identificado pelo conteúdo do
+     * arquivo, e não pela extensão. Ela pode jogar (throw) `osm_parser::ParserError` e
+     * retornar nulo caso a leitura não seja bem suscedida, ou jogar
+     * `osm_parser::Cancelled` se a leitura for cancelada.
      *
      * @param filename O caminho para o arquivo que se deseja abrir.
+     * @param options Opções de leitura.
      * @return Um ponteiro para uma instância da `Graph` contendo os dados
      *         do arquivo carregado.
      */
-    std::unique_ptr<Graph> parse(const std::string& filename);
+    std::unique_ptr<Graph> parse(const std::string& filename,
+                                 const Options& options = {});
+
+    /** Carrega um único grafo a partir de vários arquivos vizinhos.
+     *
+     * Destina-se a mapas divididos em ladrilhos (tiles): cada arquivo é lido
+     * em paralelo, com `Options::threads` threads ao todo, e todos são
+     * projetados no mesmo plano, centrado no retângulo que contém os limites
+     * declarados pelos arquivos. Nós e vias presentes em mais de um arquivo,
+     * como os que ficam nas bordas dos ladrilhos, entram no grafo uma só vez.
+     *
+     * Cada arquivo pode estar em OSM XML ou OSM PBF. Pelo menos um deles deve
+     * declarar seus limites. As demais opções valem como em
+     * `osm_parser::parse()`; `Options::two_pass` se aplica a cada arquivo.
+     *
+     * Pode jogar (throw) `osm_parser::ParserError`, com o nome do arquivo
+     * que falhou na mensagem, e `osm_parser::Cancelled`.
+     *
+     * @param filenames Os caminhos dos arquivos.
+     * @param options Opções de leitura.
+     * @return O grafo com o conteúdo de todos os arquivos.
+     */
+    std::unique_ptr<Graph> parse_tiles(const std::vector<std::string>& filenames,
+                                       const Options& options = {});
+
+    /** Conteúdo de um arquivo de alterações (osmChange).
+     *
+     * Guarda apenas o estado final de cada nó e via: se o arquivo altera o
+     * mesmo elemento mais de uma vez, vale a última.
+     */
+    struct ChangeSet
+    {
+        /** Um nó criado, alterado ou apagado. */
+        struct Node
+        {
+            bool deleted{ false };  /**< Se o nó foi apagado. */
+            double lat{ 0.0 };      /**< A latitude, em graus. */
+            double lon{ 0.0 };      /**< A longitude, em graus. */
+        };
+
+        /** Uma via criada, alterada ou apagada. */
+        struct Way
+        {
+            /** Se a via saiu do grafo: foi apagada ou deixou de ser aceita
+             * pelo perfil de rota. */
+            bool deleted{ false };
+            std::vector<std::size_t> nodes; /**< Os IDs dos nós, no sentido das arestas. */
+            std::string name;               /**< O nome da via. */
+            bool oneway{ false };           /**< Se a via tem um só sentido. */
+        };
+
+        IdIndex<Node> nodes;    /**< Os nós, pelo ID. */
+        IdIndex<Way> ways;      /**< As vias, pelo ID. */
+    };
+
+    /** Lê um arquivo de alterações do OSM (osmChange, `.osc`).
+     *
+     * As vias são filtradas pelo perfil de rota `profile`, como na leitura
+     * do mapa. Pode jogar (throw) `osm_parser::ParserError`.
+     *
+     * Só são aceitos IDs já enviados ao OSM. Os IDs negativos que editores
+     * como o JOSM dão aos objetos criados, antes do envio, geram
+     * `osm_parser::ParserError`.
+     *
+     * @param filename O caminho para o arquivo.
+     * @param profile O perfil de rota do grafo que receberá as alterações.
+     * @return As alterações lidas.
+     */
+    ChangeSet read_changes(const std::string& filename, Profile profile);
+
+    /** Aplica alterações a um grafo já carregado, sem ler o mapa de novo.
+     *
+     * Apenas os vértices e arestas das vias alteradas, ou que passam por nós
+     * alterados, são refeitos; o resto do grafo não muda. Nós que ainda não
+     * são vértices viram vértices quando alguma via os liga a outro nó do
+     * mapa, com as coordenadas das alterações ou de `WayTable::nodes`, e
+     * vértices que deixam de pertencer a
+     * qualquer via são removidos. Pares com nós que não estão no mapa, como
+     * os de fora dos limites de um extrato, são ignorados, como na leitura.
+     *
+     * `table` deve ser a tabela preenchida na leitura do grafo e é atualizada
+     * junto com ele. Pode jogar (throw) `osm_parser::ParserError` se a tabela
+     * não for válida, ou se uma via alterada usar um nó que não é vértice,
+     * não está na tabela e não está nas alterações: suas coordenadas só
+     * podem ser obtidas lendo o mapa de novo (veja
+     * `Options::keep_other_way_nodes`). Nesses casos, o grafo não é
+     * alterado.
+     *
+     * @warning Remover vértices renumera os identificadores dos vértices.
+     * @param graph O grafo a alterar.
+     * @param table As vias do grafo.
+     * @param changes As alterações.
+     */
+    void apply_changes(Graph& graph, WayTable& table, const ChangeSet& changes);
+
+    /** Lê um arquivo de alterações e o aplica ao grafo.
+     *
+     * Atalho para `read_changes()` seguido de `apply_changes()`, com o perfil
+     * de rota de `table`.
+     */
+    void apply_changes(Graph& graph, WayTable& table, const std::string& filename);
 
     /** Erro indicando falha na leitura ou parsing do arquivo. */
     class ParserError: public std::runtime_error
@@ -39,6 +233,14 @@ namespace osm_parser
         explicit ParserError(const std::string& what)
             : std::runtime_error(what) {}
     };
+
+    /** Indica que a leitura foi cancelada por `Options::cancel`. */
+    class Cancelled: public std::runtime_error
+    {
+    public:
+        Cancelled()
+            : std::runtime_error("parsing cancelled") {}
+    };
 }
 
 #endif // OSM_PARSER_H
@@ -0,0 +1,76 @@
+/** @file osm_pbf_reader.h
+ *
+ * Leitura de arquivos no formato OSM PBF (.osm.pbf).
+ */
+#ifndef OSM_PBF_READER_H
+#define OSM_PBF_READER_H
+
+#include "graph_builder.h"
+#include "thread_pool.h"
+
+#include <optional>
+#include <string_view>
+#include <vector>
+
+
+namespace osm_parser
+{
+    /** Verifica se o conteúdo de um arquivo está no formato OSM PBF.
+     *
+     * Todo arquivo PBF começa com o tamanho de um cabeçalho seguido de um
+     * bloco do tipo "OSMHeader". Arquivos XML começam com '<'.
+     *
+     * @param data O conteúdo do arquivo.
+     * @return `true` se o conteúdo parecer um arquivo PBF.
+     */
+    bool is_pbf(std::string_view data);
+
+    /** Lê um arquivo OSM PBF, passando seus nós e vias para `builder`.
+     *
+     * O formato PBF é uma sequência de blocos (blobs) independentes,
+     * geralmente comprimidos com zlib, contendo até 8000 elementos cada. Os
+     * blocos são decodificados em paralelo em `pool`, se houver, e entregues
+     * a `builder` na ordem em que aparecem no arquivo, de forma que o grafo
+     * resultante é o mesmo que seria obtido do arquivo XML equivalente.
+     *
+     * São suportados blocos sem compressão ou comprimidos com zlib, e nós
+     * nos formatos simples e denso (DenseNodes).
+     *
+     * Pode jogar (throw) `osm_parser::ParserError` e `osm_parser::Cancelled`.
+     *
+     * @param data O conteúdo do arquivo.
+     * @param builder O construtor do grafo.
+     * @param pool Threads utilizadas na decodificação, ou nulo.
+     */
+    void parse_pbf(std::string_view data, GraphBuilder& builder, ThreadPool* pool);
+
+    /** Coleta os IDs dos nós referenciados pelas vias aceitas de um arquivo PBF.
+     *
+     * É a primeira passagem da leitura em duas passagens: blocos de nós
+     * são ignorados sem serem decodificados. Se `builder` guarda as vias
+     * recusadas (`GraphBuilder::keeps_other_ways()`), os nós delas também
+     * são coletados. O resultado pode ter IDs
+     * repetidos e deve ser passado a `GraphBuilder::set_wanted_nodes()`.
+     *
+     * Pode jogar (throw) `osm_parser::ParserError` e `osm_parser::Cancelled`.
+     *
+     * @param data O conteúdo do arquivo.
+     * @param builder O construtor do grafo, que só recebe o andamento da leitura.
+     * @param pool Threads utilizadas na decodificação, ou nulo.
+     * @return Os IDs dos nós referenciados.
+     */
+    std::vector<std::size_t> collect_pbf_way_nodes(std::string_view data,
+                                                   GraphBuilder& builder,
+                                                   ThreadPool* pool);
+
+    /** Lê os limites do mapa declarados no cabeçalho de um arquivo PBF.
+     *
+     * Apenas o cabeçalho é lido. Pode jogar (throw) `osm_parser::ParserError`.
+     *
+     * @param data O conteúdo do arquivo.
+     * @return Os limites, ou nulo se o cabeçalho não os declarar.
+     */
+    std::optional<Bounds> read_pbf_bounds(std::string_view data);
+}
+
+#endif // OSM_PBF_READER_H
@@ -0,0 +1,139 @@
+/** @file osm_xml_reader.h
+ *
+ * Leitor XML em fluxo (streaming), sem cópias, utilizado por `osm_parser`.
+ */
+#ifndef OSM_XML_READER_H
+#define OSM_XML_READER_H
+
+#include <charconv>     // for from_chars()
+#include <cstddef>      // for size_t
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+namespace osm_parser
+{
+    /** Leitor XML orientado a eventos.
+     *
+     * Ao contrário de `boost::property_tree`, `XmlReader` nunca constrói uma
+     * árvore com o documento. Cada chamada a `XmlReader::next()` retorna o
+     * próximo elemento (tag de abertura, de fechamento ou vazia) encontrado na
+     * entrada, e o chamador decide o que fazer com ele. Além do próprio
+     * documento, o leitor só guarda os atributos do elemento atual.
+     *
+     * O leitor entende apenas o subconjunto de XML utilizado pelo formato
+     * OSM: elementos, atributos, comentários e instruções de processamento.
+     * Textos entre elementos são ignorados.
+     *
+     * O documento é um bloco de memória já carregado, geralmente um arquivo
+     * mapeado em memória (`MappedFile`). Nenhuma cópia é feita: nomes e
+     * valores apontam diretamente para o documento, e os `std::string_view`
+     * retornados em `XmlReader::Element` valem enquanto ele existir.
+     */
+    class XmlReader
+    {
+    public:
+        /** Atributo de um elemento, no formato `name="value"`.
+         *
+         * O valor não tem as entidades XML (`&amp;`, `&#39;`, ...) decodificadas.
+         * Utilize `XmlReader::decode()` quando o texto original for necessário.
+         */
+        struct Attribute
+        {
+            std::string_view name;
+            std::string_view value;
+        };
+
+        /** Um elemento lido da entrada. */
+        struct Element
+        {
+            std::string_view name;              /**< O nome do elemento. */
+            std::vector<Attribute> attributes;  /**< Os atributos, na ordem em que aparecem. */
+            bool closing;                       /**< Verdadeiro para `</name>`. */
+            bool self_closing;                  /**< Verdadeiro para `<name ... />`. */
+
+            /** Busca o valor de um atributo pelo nome.
+             * @param name O nome do atributo.
+             * @return O valor do atributo, ou nulo se ele não existir.
+             */
+            std::optional<std::string_view> attribute(std::string_view name) const;
+        };
+
+        /** Construtor.
+         *
+         * @param document O documento inteiro, já em memória. Deve permanecer
+         *        vivo enquanto o leitor e os elementos lidos forem utilizados.
+         */
+        explicit XmlReader(std::string_view document);
+
+        /** Lê o próximo elemento da entrada.
+         *
+         * A estrutura `el` é reaproveitada entre chamadas, de forma que,
+         * depois das primeiras leituras, nenhuma alocação é feita por elemento.
+         * Pode jogar (throw) `osm_parser::ParserError` se o documento estiver
+         * malformado.
+         *
+         * @param el Estrutura onde o elemento lido será armazenado.
+         * @return `false` quando não houver mais elementos na entrada.
+         */
+        bool next(Element& el);
+
+        /** Retorna a posição do próximo byte ainda não lido.
+         *
+         * @return A posição do próximo byte, a partir do início do documento.
+         */
+        std::size_t offset() const;
+
+        /** Continua a leitura a partir da posição `offset` do documento.
+         *
+         * Útil para saltar trechos do documento que já foram processados de
+         * outra forma.
+         *
+         * @param offset A posição absoluta no documento.
+         */
+        void seek(std::size_t offset);
+
+        /** Decodifica as entidades XML de um valor de atributo.
+         * @param value O valor, como retornado em `XmlReader::Attribute`.
+         * @return Uma cópia do valor com as entidades substituídas.
+         */
+        static std::string decode(std::string_view value);
+
+        /** Converte o valor de um atributo em número, sem cópias.
+         *
+         * O valor inteiro precisa ser um número válido para o tipo `T`.
+         *
+         * @param value O valor, como retornado em `XmlReader::Attribute`.
+         * @return O número ou nulo, caso o valor não seja um número válido.
+         */
+        template<typename T>
+        static std::optional<T> to_number(std::string_view value)
+        {
+            T number;
+            auto [ptr, ec] = std::from_chars(
+                value.data(), value.data() + value.size(), number);
+
+            if (ec != std::errc() || ptr != value.data() + value.size())
+                return {};
+
+            return number;
+        }
+
+    private:
+        /** Encontra o '>' que fecha a tag iniciada em `m_pos`, ignorando os
+         * que estiverem entre aspas.
+         * @return A posição do '>' no documento, ou `std::string_view::npos`.
+         */
+        std::size_t find_tag_end() const;
+
+        /** Separa nome e atributos da tag entre `begin` e `end`. */
+        void split_tag(std::size_t begin, std::size_t end, Element& el);
+
+        std::string_view m_document;        /**< O documento. */
+        std::size_t m_pos{ 0 };             /**< Posição do próximo byte não consumido. */
+    };
+}
+
+#endif // OSM_XML_READER_H
@@ -0,0 +1,158 @@
+/** @file path_search.h
+ *
+ * Buscas de menor caminho sobre a forma CSR de um grafo.
+ */
+#ifndef PATH_SEARCH_H
+#define PATH_SEARCH_H
+
+#include "csr_graph.h"
+#include "graph.h"
+#include "id_index.h"
+#include "landmarks.h"
+#include "search_workspace.h"
+
+#include <cstddef>
+#include <utility>      // for pair
+#include <vector>
+
+
+/** Namespace path_search
+ *
+ * Implementa os algoritmos de `Graph::PathAlgorithm`. Todas as buscas
+ * seguem o contrato de `Graph::plot_path()`: `path` recebe os vértices do
+ * destino até a origem, e a distância retornada é o maior `double` se não
+ * houver caminho.
+ *
+ * As buscas usam a memória de `workspace` (veja `SearchWorkspace`) e não
+ * alocam nada do tamanho do grafo depois da primeira busca. Sem
+ * `workspace`, cada thread usa uma instância própria.
+ */
+namespace path_search
+{
+    /** Algoritmo de Dijkstra, parando quando o destino é fixado.
+     *
+     * @param graph O grafo.
+     * @param src O vértice de origem.
+     * @param tgt O vértice de destino.
+     * @param path Vetor vazio, que recebe o caminho.
+     * @param stats Se não for nulo, recebe as estatísticas da busca.
+     * @param workspace A memória de trabalho da busca, ou nulo.
+     * @return A distância entre a origem e o destino.
+     */
+    double dijkstra(const CsrGraph& graph, CsrGraph::Index src, CsrGraph::Index tgt,
+                    std::vector<Graph::VertexT>& path, Graph::PathStats* stats = nullptr,
+                    SearchWorkspace* workspace = nullptr);
+
+    /** Algoritmo A*, com a distância em linha reta até o destino como
+     * estimativa do que falta percorrer.
+     *
+     * Como a distância em linha reta nunca é maior que a distância pelas
+     * arestas, o resultado é o mesmo de `path_search::dijkstra()`, mas a
+     * busca avança na direção do destino e fixa muito menos vértices.
+     *
+     * Os parâmetros e o retorno são os de `path_search::dijkstra()`.
+     */
+    double astar(const CsrGraph& graph, CsrGraph::Index src, CsrGraph::Index tgt,
+                 std::vector<Graph::VertexT>& path, Graph::PathStats* stats = nullptr,
+                 SearchWorkspace* workspace = nullptr);
+
+    /** Algoritmo A* com landmarks (ALT).
+     *
+     * A estimativa é o maior entre a distância em linha reta e os limites
+     * dos landmarks ativos (veja `Landmarks::choose_active()`), escolhidos
+     * uma vez por busca. Os limites dos landmarks podem cair um pouco mais
+     * que o peso de uma aresta, pelo desconto do arredondamento; a busca
+     * então reabre o vértice, e o resultado continua sendo o menor caminho.
+     *
+     * @param landmarks As tabelas de landmarks de `graph`, ou de uma forma
+     *        anterior do grafo (veja `Graph::set_landmarks()`).
+     *
+     * Os demais parâmetros e o retorno são os de `path_search::dijkstra()`.
+     */
+    double alt(const CsrGraph& graph, const Landmarks& landmarks,
+               CsrGraph::Index src, CsrGraph::Index tgt,
+               std::vector<Graph::VertexT>& path, Graph::PathStats* stats = nullptr,
+               SearchWorkspace* workspace = nullptr);
+
+    /** Algoritmo de Dijkstra bidirecional.
+     *
+     * Uma busca parte da origem, seguindo as arestas, e outra parte do
+     * destino, seguindo as arestas no sentido inverso (veja
+     * `CsrGraph::in_begin()`), de forma que vias de mão única são respeitadas.
+     * A cada passo avança a busca com a menor distância pendente. As buscas
+     * param quando a soma das menores distâncias pendentes das duas alcança o
+     * melhor caminho já encontrado entre elas, que então é o menor.
+     *
+     * Os parâmetros e o retorno são os de `path_search::dijkstra()`. As
+     * estatísticas somam os vértices fixados pelas duas buscas.
+     */
+    double bidirectional(const CsrGraph& graph, CsrGraph::Index src, CsrGraph::Index tgt,
+                         std::vector<Graph::VertexT>& path, Graph::PathStats* stats = nullptr,
+                         SearchWorkspace* workspace = nullptr);
+
+    /** Algoritmo de Dijkstra da origem até a distância `budget`.
+     *
+     * A busca para no primeiro vértice além de `budget`, em vez de
+     * percorrer todo o grafo.
+     *
+     * @param graph O grafo.
+     * @param src O vértice de origem.
+     * @param budget A maior distância.
+     * @param vertices Recebe os vértices alcançados, em ordem de distância.
+     * @param distances Recebe as distâncias dos vértices de `vertices`.
+     * @param workspace A memória de trabalho da busca, ou nulo.
+     */
+    void within(const CsrGraph& graph, CsrGraph::Index src, double budget,
+                std::vector<Graph::VertexT>& vertices, std::vector<double>& distances,
+                SearchWorkspace* workspace = nullptr);
+
+    /** Destinos de `path_search::one_to_many()`, agrupados por vértice.
+     *
+     * Cada vértice aparece uma só vez no índice, com as colunas (posições
+     * em `targets`) em que aparece. Só leitura depois de criado, pode ser
+     * compartilhado por várias buscas ao mesmo tempo.
+     */
+    class Targets
+    {
+    public:
+        /** Agrupa `targets`. */
+        explicit Targets(const std::vector<CsrGraph::Index>& targets);
+
+        /** Retorna o número de colunas. */
+        std::size_t num_columns() const { return m_columns.size(); }
+
+        /** Retorna o número de vértices distintos. */
+        std::size_t num_vertices() const { return m_buckets.size(); }
+
+        /** Retorna as colunas de `vertex`, como um intervalo de ponteiros,
+         * ou um intervalo vazio se não for um destino. */
+        std::pair<const std::size_t*, const std::size_t*> columns(CsrGraph::Index vertex) const;
+
+    private:
+        /** As colunas, agrupadas por vértice. */
+        std::vector<std::size_t> m_columns;
+
+        /** Para cada vértice, o início e o fim de suas colunas. */
+        IdIndex<std::pair<std::size_t, std::size_t>> m_buckets;
+    };
+
+    /** Algoritmo de Dijkstra da origem a vários destinos de uma vez.
+     *
+     * A busca para quando todos os destinos são fixados.
+     *
+     * @param graph O grafo.
+     * @param src O vértice de origem.
+     * @param targets Os destinos.
+     * @param distances Recebe a distância de cada coluna de `targets`; tem
+     *        pelo menos `targets.num_columns()` posições.
+     * @param paths Se não for nulo, recebe os caminhos de cada coluna, na
+     *        ordem de `Graph::plot_path()`; tem pelo menos
+     *        `targets.num_columns()` vetores vazios.
+     * @param workspace A memória de trabalho da busca, ou nulo.
+     */
+    void one_to_many(const CsrGraph& graph, CsrGraph::Index src, const Targets& targets,
+                     double* distances, std::vector<Graph::VertexT>* paths = nullptr,
+                     SearchWorkspace* workspace = nullptr);
+}
+
+#endif // PATH_SEARCH_H
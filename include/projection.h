@@ -0,0 +1,106 @@
+/** @file projection.h
+ *
+ * Projeção das coordenadas geográficas dos mapas OSM no plano do grafo.
+ */
+#ifndef PROJECTION_H
+#define PROJECTION_H
+
+#include "graph.h"
+
+#include <algorithm>    // for min(), max()
+#include <cmath>        // for cos()
+#include <limits>       // for numeric_limits<>::max()
+
+
+namespace osm_parser
+{
+    /** Retângulo de coordenadas geográficas, em graus. */
+    struct Bounds
+    {
+        double minlat, maxlat, minlon, maxlon;
+
+        /** Retorna um retângulo vazio, a ser aumentado por `Bounds::extend()`. */
+        static Bounds empty()
+        {
+            return {
+                std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest(),
+                std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest()
+            };
+        }
+
+        /** Retorna `true` se o retângulo não contém nenhum ponto. */
+        bool is_empty() const { return minlat > maxlat; }
+
+        /** Aumenta o retângulo até conter o ponto (`lat`, `lon`). */
+        void extend(double lat, double lon)
+        {
+            minlat = std::min(minlat, lat);
+            maxlat = std::max(maxlat, lat);
+            minlon = std::min(minlon, lon);
+            maxlon = std::max(maxlon, lon);
+        }
+
+        /** Aumenta o retângulo até conter `other`. */
+        void extend(const Bounds& other)
+        {
+            minlat = std::min(minlat, other.minlat);
+            maxlat = std::max(maxlat, other.maxlat);
+            minlon = std::min(minlon, other.minlon);
+            maxlon = std::max(maxlon, other.maxlon);
+        }
+    };
+
+    /** Projeção equirretangular centrada em um retângulo do mapa.
+     *
+     * Os pontos do OSM são coordenadas geográficas. Para medir distâncias
+     * entre eles em metros, são projetados em um plano, mantendo as
+     * distâncias relativas. A projeção equirretangular é suficiente para as
+     * áreas pequenas, não muito longe do equador, que o programa trata.
+     *
+     * Cada leitura tem a sua projeção. Grafos lidos com projeções diferentes
+     * têm coordenadas em referenciais diferentes.
+     */
+    class Projection
+    {
+    public:
+        /** Cria uma projeção centrada na latitude e longitude 0. */
+        Projection()
+            : Projection({ 0.0, 0.0, 0.0, 0.0 }) {}
+
+        /** Cria uma projeção centrada em `bounds`. */
+        explicit Projection(const Bounds& bounds)
+            : m_bounds(bounds)
+            , m_center_lat((bounds.minlat + bounds.maxlat) / 2.0)
+            , m_center_lon((bounds.minlon + bounds.maxlon) / 2.0)
+            , m_meters_per_degree_lon(
+                std::cos(m_center_lat * M_PI / 180.0) * METERS_PER_DEGREE_LAT)
+        {}
+
+        /** Projeta uma coordenada geográfica no plano.
+         *
+         * @param lat A latitude, em graus.
+         * @param lon A longitude, em graus.
+         * @return As coordenadas no plano, em metros.
+         */
+        Graph::VertexCoords project(double lat, double lon) const
+        {
+            return {
+                (lon - m_center_lon) * m_meters_per_degree_lon,
+                (m_center_lat - lat) * METERS_PER_DEGREE_LAT
+            };
+        }
+
+        /** Retorna o retângulo em que a projeção está centrada. */
+        const Bounds& bounds() const { return m_bounds; }
+
+    private:
+        static constexpr double METERS_PER_DEGREE_LAT = 111320.0;
+
+        Bounds m_bounds;
+        double m_center_lat;
+        double m_center_lon;
+        double m_meters_per_degree_lon;
+    };
+}
+
+#endif // PROJECTION_H
@@ -0,0 +1,124 @@
+/** @file routing_profile.h
+ *
+ * Perfis de rota: quais vias de um mapa OSM entram no grafo e em que sentido.
+ *
+ * Toda via com a tag `highway` é uma candidata, mas nem todas servem a todo
+ * meio de transporte. Calçadas e escadas não servem a carros, e rodovias não
+ * servem a pedestres. Cada perfil define quais classes de via aceita, quais
+ * tags de acesso respeita e como interpreta a tag `oneway`.
+ *
+ * As tags são reconhecidas por uma tabela hash perfeita, montada em tempo de
+ * compilação: cada chave ou valor custa um hash e uma comparação, no lugar de
+ * uma sequência de comparações de strings.
+ */
+#ifndef ROUTING_PROFILE_H
+#define ROUTING_PROFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+
+namespace osm_parser
+{
+    /** Perfis de rota disponíveis. */
+    enum class Profile
+    {
+        any_highway,    /**< Qualquer via com a tag `highway`, sem restrições de acesso. */
+        car,            /**< Vias para veículos motorizados. */
+        bike,           /**< Vias para bicicletas. */
+        foot,           /**< Vias para pedestres; `oneway` é ignorado. */
+        trunk_only,     /**< Apenas autoestradas e vias expressas (`motorway` e `trunk`). */
+    };
+
+    /** Número de perfis em `Profile`. */
+    constexpr std::size_t NUM_PROFILES = 5;
+
+    /** Retorna um nome curto, em inglês, para o perfil. */
+    std::string_view profile_name(Profile profile);
+
+    /** Palavras reconhecidas em chaves e valores de tags.
+     *
+     * Apenas as palavras que influenciam algum perfil estão aqui. As demais
+     * são `Word::unknown`.
+     */
+    enum class Word: std::uint8_t
+    {
+        unknown,
+
+        // Keys
+        name, highway, oneway, oneway_bicycle, junction,
+        access, vehicle, motor_vehicle, motorcar, bicycle, foot,
+
+        // Values of oneway and junction
+        yes, no, true_, one, minus_one, reversible, alternating,
+        roundabout, circular,
+
+        // Values of access tags
+        private_, agricultural, forestry, delivery, customers, destination,
+        permissive, designated, use_sidepath, dismount,
+
+        // Values of highway
+        motorway, motorway_link, trunk, trunk_link, primary, primary_link,
+        secondary, secondary_link, tertiary, tertiary_link, unclassified,
+        residential, living_street, service, road, track, pedestrian,
+        footway, path, cycleway, bridleway, steps, corridor, busway,
+        construction, proposed, abandoned, platform, raceway,
+
+        count
+    };
+
+    /** Reconhece uma palavra de uma tag.
+     * @param text A chave ou o valor da tag.
+     * @return A palavra, ou `Word::unknown` se `text` não for reconhecido.
+     */
+    Word match_word(std::string_view text);
+
+    /** Acumula as tags de uma via e decide, segundo um perfil, se ela entra
+     * no grafo e em que sentido.
+     *
+     * Uso: `WayFilter::clear()` antes de cada via, `WayFilter::add_tag()` para
+     * cada tag, e por fim `WayFilter::accepted()`, `WayFilter::oneway()` e
+     * `WayFilter::reversed()`. A ordem das tags não importa.
+     */
+    class WayFilter
+    {
+    public:
+        explicit WayFilter(Profile profile = Profile::any_highway);
+
+        /** Esquece as tags da via anterior. */
+        void clear();
+
+        /** Considera a tag `key`=`value`.
+         *
+         * O valor só é examinado se a chave interessar ao perfil.
+         *
+         * @return A palavra correspondente à chave, para que o leitor trate
+         *         por conta própria chaves como `Word::name`.
+         */
+        Word add_tag(std::string_view key, std::string_view value);
+
+        /** Retorna `true` se a via deve entrar no grafo. */
+        bool accepted() const;
+
+        /** Retorna `true` se a via só pode ser percorrida em um sentido. */
+        bool oneway() const;
+
+        /** Retorna `true` se o sentido da via é o inverso da ordem de seus nós
+         * (`oneway=-1`). */
+        bool reversed() const;
+
+    private:
+        /** Chaves de acesso, da mais geral para a mais específica. */
+        static constexpr int NUM_ACCESS_KEYS = 6;
+
+        Profile m_profile;
+        Word m_highway;
+        Word m_oneway;
+        Word m_oneway_bicycle;
+        Word m_junction;
+        Word m_access[NUM_ACCESS_KEYS];     /**< Valor de cada chave de acesso. */
+    };
+}
+
+#endif // ROUTING_PROFILE_H
@@ -0,0 +1,115 @@
+/** @file search_workspace.h
+ *
+ * Interface pública da classe `SearchWorkspace`.
+ */
+#ifndef SEARCH_WORKSPACE_H
+#define SEARCH_WORKSPACE_H
+
+#include "csr_graph.h"
+
+#include <algorithm>    // for push_heap(), pop_heap()
+#include <cstddef>
+#include <cstdint>
+#include <functional>   // for greater<>
+#include <limits>       // for numeric_limits<>::max()
+#include <vector>
+
+
+/** Memória de trabalho das buscas de `path_search`, reaproveitada entre
+ * buscas.
+ *
+ * Uma busca precisa da distância e do antecessor de cada vértice alcançado.
+ * Alocar e preencher vetores do tamanho do grafo a cada busca custa O(V),
+ * mesmo quando origem e destino são vizinhos. Aqui, cada vértice guarda
+ * também a geração em que foi alcançado: começar uma nova busca só
+ * incrementa a geração, e vértices de gerações anteriores valem como não
+ * alcançados. O custo de uma busca passa a depender só dos vértices que
+ * ela visita.
+ *
+ * Há dois lados, para as buscas bidirecionais; as demais usam só o lado 0.
+ * Uma instância não pode ser usada por duas buscas ao mesmo tempo.
+ */
+class SearchWorkspace
+{
+public:
+    using Index = CsrGraph::Index;
+
+    /** Distância de vértices não alcançados. */
+    static constexpr double INFINITE = std::numeric_limits<double>::max();
+
+    /** Entrada da fila de prioridade de uma busca. */
+    struct Entry
+    {
+        double key;         /**< Distância mais a estimativa até o destino. */
+        double distance;    /**< Distância ao entrar na fila, para descartar entradas velhas. */
+        Index vertex;       /**< O vértice. */
+
+        bool operator>(const Entry& other) const { return key > other.key; }
+    };
+
+    /** Prepara a instância para uma nova busca em um grafo com
+     * `num_vertices` vértices. Só aloca memória se o número de vértices
+     * mudou desde a busca anterior.
+     */
+    void reset(std::size_t num_vertices);
+
+    /** Retorna a distância de `vertex` no lado `side`, ou
+     * `SearchWorkspace::INFINITE` se não foi alcançado nesta busca. */
+    double distance(int side, Index vertex) const
+    {
+        const Label& label = m_labels[side][vertex];
+        return label.generation == m_generation ? label.distance : INFINITE;
+    }
+
+    /** Retorna o antecessor de `vertex` no lado `side`. Só vale para
+     * vértices alcançados nesta busca. */
+    Index parent(int side, Index vertex) const
+    {
+        return m_labels[side][vertex].parent;
+    }
+
+    /** Registra que `vertex` foi alcançado no lado `side`, com a distância
+     * `distance`, a partir de `parent`. */
+    void set(int side, Index vertex, double distance, Index parent)
+    {
+        m_labels[side][vertex] = { distance, parent, m_generation };
+    }
+
+    /** Acrescenta `entry` à fila do lado `side`. */
+    void push(int side, const Entry& entry)
+    {
+        m_queues[side].push_back(entry);
+        std::push_heap(m_queues[side].begin(), m_queues[side].end(), std::greater<Entry>());
+    }
+
+    /** Retira e retorna a entrada com a menor chave da fila do lado `side`. */
+    Entry pop(int side)
+    {
+        std::pop_heap(m_queues[side].begin(), m_queues[side].end(), std::greater<Entry>());
+
+        Entry entry = m_queues[side].back();
+        m_queues[side].pop_back();
+
+        return entry;
+    }
+
+    /** Retorna a entrada com a menor chave da fila do lado `side`. */
+    const Entry& top(int side) const { return m_queues[side].front(); }
+
+    /** Retorna `true` se a fila do lado `side` está vazia. */
+    bool empty(int side) const { return m_queues[side].empty(); }
+
+private:
+    struct Label
+    {
+        double distance;
+        Index parent;
+        std::uint32_t generation;
+    };
+
+    std::vector<Label> m_labels[2];         /**< Os vértices, por lado. */
+    std::vector<Entry> m_queues[2];         /**< Heaps binários, por lado. */
+    std::uint32_t m_generation{ 0 };        /**< A geração da busca atual. */
+};
+
+#endif // SEARCH_WORKSPACE_H
@@ -0,0 +1,111 @@
+/** @file spatial_grid.h
+ *
+ * Interface pública da classe `SpatialGrid`.
+ */
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include "graph.h"
+#include "id_index.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>       // for numeric_limits<>::max()
+#include <optional>
+#include <vector>
+
+
+/** Índice espacial dos vértices de um grafo, em uma grade uniforme.
+ *
+ * O plano é dividido em células quadradas de lado `cell_size()`, e cada
+ * vértice fica na célula que contém suas coordenadas. Uma consulta só
+ * examina as células próximas do ponto buscado, em vez de todos os
+ * vértices. Apenas as células ocupadas são guardadas, em um `IdIndex`, de
+ * forma que vértices podem ser acrescentados em qualquer lugar do plano.
+ *
+ * A grade guarda cópias das coordenadas, e deve ser avisada de cada
+ * alteração dos vértices (veja `Graph::find_vertex_with_coords()`).
+ */
+class SpatialGrid
+{
+public:
+    using VertexT = Graph::VertexT;
+    using VertexCoords = Graph::VertexCoords;
+
+    /** Cria uma grade vazia com células de lado `cell_size`. */
+    explicit SpatialGrid(double cell_size);
+
+    /** Cria a grade com todos os vértices de `graph`, com células do
+     * tamanho de algumas vezes o espaço médio entre eles. */
+    explicit SpatialGrid(const Graph& graph);
+
+    /** Retorna o lado das células. */
+    double cell_size() const { return m_cell_size; }
+
+    /** Retorna o número de vértices na grade. */
+    std::size_t size() const { return m_size; }
+
+    /** Acrescenta `vertex`, nas coordenadas `coord`. */
+    void insert(VertexT vertex, const VertexCoords& coord);
+
+    /** Remove `vertex`, que foi acrescentado nas coordenadas `coord`.
+     * @return `true` se o vértice foi encontrado.
+     */
+    bool erase(VertexT vertex, const VertexCoords& coord);
+
+    /** Move `vertex` das coordenadas `from` para `to`. */
+    void move(VertexT vertex, const VertexCoords& from, const VertexCoords& to);
+
+    /** Encontra o vértice mais próximo de `coord`.
+     *
+     * As células são examinadas em anéis em volta da célula de `coord`, até
+     * que nenhuma célula ainda não examinada possa ter um vértice mais
+     * próximo que o melhor encontrado.
+     *
+     * @param coord O ponto buscado.
+     * @param max_distance A maior distância aceita.
+     * @return O vértice mais próximo, ou nulo se não houver nenhum a até
+     *         `max_distance` de `coord`.
+     */
+    std::optional<VertexT> nearest(
+        const VertexCoords& coord,
+        double max_distance = std::numeric_limits<double>::max()) const;
+
+    /** Encontra os vértices a até `radius` de `coord`.
+     *
+     * @param coord O centro do círculo.
+     * @param radius O raio do círculo.
+     * @param vertices Recebe os vértices encontrados, em ordem arbitrária.
+     */
+    void within(const VertexCoords& coord, double radius,
+                std::vector<VertexT>& vertices) const;
+
+private:
+    struct Entry
+    {
+        VertexT vertex;
+        VertexCoords coord;
+    };
+
+    /** Coordenada de célula, limitada para que a chave nunca seja
+     * `IdIndex::RESERVED_ID`. */
+    std::int64_t cell_of(double value) const;
+
+    /** A chave da célula `(cx, cy)` em `m_cell_index`. */
+    static std::size_t key(std::int64_t cx, std::int64_t cy);
+
+    /** Retorna os vértices da célula `(cx, cy)`, ou nulo se estiver vazia. */
+    const std::vector<Entry>* cell(std::int64_t cx, std::int64_t cy) const;
+
+    double m_cell_size;                     /**< O lado das células. */
+    std::size_t m_size{ 0 };                /**< Número de vértices. */
+
+    IdIndex<std::size_t> m_cell_index;      /**< Posição de cada célula ocupada em `m_cells`. */
+    std::vector<std::vector<Entry>> m_cells; /**< Os vértices de cada célula. */
+
+    /** As células ocupadas em algum momento ficam entre estes limites. */
+    std::int64_t m_min_cx{ 0 }, m_max_cx{ -1 };
+    std::int64_t m_min_cy{ 0 }, m_max_cy{ -1 };
+};
+
+#endif // SPATIAL_GRID_H
@@ -0,0 +1,72 @@
+/** @file string_pool.h
+ *
+ * Interface pública da classe `StringPool`.
+ */
+#ifndef STRING_POOL_H
+#define STRING_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>   // for equal_to<>, hash<>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+
+/** Tabela de strings internadas.
+ *
+ * Cada string distinta é guardada uma única vez e recebe um ID numérico
+ * sequencial. Estruturas que repetem a mesma string muitas vezes, como as
+ * arestas de uma mesma via, guardam apenas o ID, e comparar dois IDs
+ * equivale a comparar as strings.
+ *
+ * A string vazia é sempre a de ID `StringPool::EMPTY`. IDs nunca mudam nem
+ * são reaproveitados, e copiar a tabela preserva todos eles.
+ */
+class StringPool
+{
+public:
+    /** ID de uma string na tabela. */
+    using ID = std::uint32_t;
+
+    /** ID da string vazia. */
+    static constexpr ID EMPTY = 0;
+
+    /** Cria uma tabela contendo apenas a string vazia. */
+    StringPool();
+
+    /** Retorna o ID de `text`, adicionando-a à tabela se ainda não estiver.
+     *
+     * Pode jogar (throw) `std::length_error` se a tabela já tiver o máximo
+     * de strings representável por `StringPool::ID`.
+     */
+    ID intern(std::string_view text);
+
+    /** Retorna o ID de `text`, ou nulo se ela não estiver na tabela. */
+    std::optional<ID> find(std::string_view text) const;
+
+    /** Retorna a string de ID `id`, que deve existir na tabela. */
+    const std::string& get(ID id) const { return m_strings[id]; }
+
+    /** Retorna o número de strings na tabela, contando a vazia. */
+    std::size_t size() const { return m_strings.size(); }
+
+private:
+    /** Permite buscar por `std::string_view` sem construir uma `std::string`. */
+    struct Hash
+    {
+        using is_transparent = void;
+
+        std::size_t operator()(std::string_view text) const
+        {
+            return std::hash<std::string_view>{}(text);
+        }
+    };
+
+    std::vector<std::string> m_strings;     /**< As strings, na ordem dos IDs. */
+    std::unordered_map<std::string, ID, Hash, std::equal_to<>> m_ids;
+};
+
+#endif // STRING_POOL_H
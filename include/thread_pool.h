@@ -0,0 +1,79 @@
+/** @file thread_pool.h
+ *
+ * Interface pública da classe `ThreadPool`.
+ */
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <functional>   // for function
+#include <future>
+#include <memory>       // for make_shared()
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>  // for invoke_result_t
+#include <vector>
+
+
+/** Conjunto fixo de threads que executam tarefas em ordem de chegada.
+ *
+ * Evita criar uma thread para cada tarefa em trabalhos divididos em muitas
+ * partes pequenas, como a decodificação dos blocos de um arquivo PBF. As
+ * threads são criadas no construtor e aguardadas no destrutor, depois que
+ * todas as tarefas pendentes terminarem.
+ */
+class ThreadPool
+{
+public:
+    /** Cria o conjunto com `threads` threads (pelo menos uma). */
+    explicit ThreadPool(unsigned threads);
+
+    /** Aguarda as tarefas pendentes e encerra as threads. */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /** Retorna o número de threads do conjunto. */
+    unsigned size() const;
+
+    /** Agenda a execução de `task` em uma das threads.
+     *
+     * Exceções jogadas pela tarefa são repassadas a quem chamar `get()` no
+     * `std::future` retornado.
+     *
+     * @param task Uma função sem argumentos.
+     * @return Um `std::future` com o valor retornado por `task`.
+     */
+    template<typename F>
+    std::future<std::invoke_result_t<F>> submit(F task)
+    {
+        using R = std::invoke_result_t<F>;
+
+        // std::function needs a copyable callable, and packaged_task isn't.
+        auto packaged = std::make_shared<std::packaged_task<R()>>(std::move(task));
+        auto future = packaged->get_future();
+
+        {
+            std::lock_guard lock{ m_mutex };
+            m_tasks.emplace([packaged] () { (*packaged)(); });
+        }
+
+        m_condition.notify_one();
+
+        return future;
+    }
+
+private:
+    /** Laço executado por cada thread. */
+    void run();
+
+    std::vector<std::thread> m_threads;         /**< As threads do conjunto. */
+    std::queue<std::function<void()>> m_tasks;  /**< Tarefas aguardando execução. */
+    std::mutex m_mutex;                         /**< Protege `m_tasks` e `m_stopping`. */
+    std::condition_variable m_condition;        /**< Sinaliza novas tarefas. */
+    bool m_stopping{ false };                   /**< Se o destrutor foi chamado. */
+};
+
+#endif // THREAD_POOL_H
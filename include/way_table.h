@@ -0,0 +1,69 @@
+/** @file way_table.h
+ *
+ * Definição de `osm_parser::WayTable`.
+ */
+#ifndef WAY_TABLE_H
+#define WAY_TABLE_H
+
+#include "graph.h"
+#include "id_index.h"
+#include "projection.h"
+#include "routing_profile.h"
+
+#include <cstddef>
+#include <vector>
+
+
+namespace osm_parser
+{
+    /** As vias de um grafo lido de um mapa OSM.
+     *
+     * O grafo guarda apenas vértices e arestas: não sabe a que via pertence
+     * cada aresta. Para aplicar um arquivo de alterações
+     * (`osm_parser::apply_changes()`) sem ler o mapa de novo, é preciso saber
+     * quais nós cada via ligava, além da projeção e do perfil de rota usados
+     * na leitura. É o que esta tabela guarda, preenchida pela leitura quando
+     * pedida em `Options::way_table`.
+     *
+     * Uma via pode passar a ser aceita pelo perfil de rota, ou ser criada
+     * sobre nós que já existiam, e o arquivo de alterações só traz os nós
+     * que mudaram. Por isso a tabela pode guardar também as coordenadas dos
+     * nós das vias recusadas, quando pedido em
+     * `Options::keep_other_way_nodes`.
+     *
+     * Só grafos não simplificados podem ser alterados, pois a simplificação
+     * funde as arestas de várias vias.
+     */
+    struct WayTable
+    {
+        /** Uma via aceita pelo perfil de rota. */
+        struct Way
+        {
+            std::vector<std::size_t> nodes;     /**< Os IDs de seus nós, no sentido das arestas. */
+            Graph::NameID name{ Graph::NO_NAME }; /**< O nome, na tabela de nomes do grafo. */
+            bool oneway{ false };               /**< Se a via tem um só sentido. */
+        };
+
+        /** Um nó de alguma via do mapa que não é vértice do grafo. */
+        struct Node
+        {
+            Graph::VertexCoords coord{ 0.0, 0.0 }; /**< As coordenadas, já projetadas. */
+
+            /** Se a via referencia um nó que não está no mapa, como os que
+             * ficam fora dos limites de um extrato. A leitura ignora os pares
+             * de nós com um nó ausente, e as alterações também. */
+            bool missing{ false };
+        };
+
+        /** Se a tabela descreve o grafo. Falso em tabelas vazias e
+         * em leituras simplificadas. */
+        bool valid{ false };
+
+        Bounds bounds{ 0.0, 0.0, 0.0, 0.0 };    /**< Os limites que definem a projeção. */
+        Profile profile{ Profile::any_highway }; /**< O perfil de rota da leitura. */
+        IdIndex<Way> ways;                      /**< As vias, pelo ID. */
+        IdIndex<Node> nodes;                    /**< Os nós de vias que não são vértices, pelo ID. */
+    };
+}
+
+#endif // WAY_TABLE_H
@@ -0,0 +1,619 @@
+#include "contraction_hierarchy.h"
+
+#include "id_index.h"
+
+#include <algorithm>        // for max(), push_heap(), remove_if(), sort()
+#include <functional>       // for greater<>
+#include <queue>            // for priority_queue
+#include <stdexcept>        // for logic_error
+#include <tuple>
+#include <utility>          // for pair
+
+
+using Index = ContractionHierarchy::Index;
+
+
+namespace
+{
+    constexpr double INFINITE = std::numeric_limits<double>::max();
+
+    /* Witness searches give up after settling this many vertices. A search
+     * that gives up early only costs an unneeded shortcut, never a wrong
+     * distance, and keeps contraction fast in the dense top of the
+     * hierarchy. Searches that only estimate a priority are kept shorter. */
+    constexpr std::size_t WITNESS_LIMIT = 1000;
+    constexpr std::size_t ESTIMATE_LIMIT = 5;
+
+    /* Weight of the edge difference in the priority, against the number of
+     * contracted neighbors and the level. */
+    constexpr int EDGE_DIFFERENCE_WEIGHT = 4;
+
+    struct Edge
+    {
+        Index node;
+        double weight;
+        Index middle;
+    };
+
+    struct Entry
+    {
+        double distance;
+        Index vertex;
+
+        bool operator>(const Entry& other) const { return distance > other.distance; }
+    };
+
+    /* The contraction itself. The remaining graph is kept as adjacency
+     * vectors that only hold vertices not yet contracted; when a vertex is
+     * contracted, its edges at that moment are exactly its edges in the
+     * hierarchy, all going to vertices of higher rank. */
+    class Contractor
+    {
+    public:
+        explicit Contractor(const CsrGraph& graph)
+            : up(graph.num_vertices()), down(graph.num_vertices()),
+              m_out(graph.num_vertices()), m_in(graph.num_vertices()),
+              m_contracted(graph.num_vertices(), 0),
+              m_edge_difference(graph.num_vertices(), 0),
+              m_deleted_neighbors(graph.num_vertices(), 0),
+              m_levels(graph.num_vertices(), 0),
+              m_distances(graph.num_vertices(), INFINITE),
+              m_targets(graph.num_vertices(), 0)
+        {
+            for (Index v = 0; v < graph.num_vertices(); ++v)
+            {
+                for (Index e = graph.edges_begin(v); e < graph.edges_end(v); ++e)
+                {
+                    if (graph.target(e) != v)
+                    {
+                        add_edge(v, graph.target(e), graph.weight(e),
+                                 ContractionHierarchy::NO_MIDDLE);
+                    }
+                }
+            }
+        }
+
+        /* Contracts every vertex, least important first. Returns false if
+         * cancelled. */
+        bool run(const std::atomic<bool>* cancel)
+        {
+            using Queue = std::priority_queue<std::pair<int, Index>,
+                                              std::vector<std::pair<int, Index>>,
+                                              std::greater<std::pair<int, Index>>>;
+
+            Index n = static_cast<Index>(m_out.size());
+            std::vector<int> priorities(n);
+            Queue queue;
+
+            for (Index v = 0; v < n; ++v)
+            {
+                if (cancel && *cancel)
+                    return false;
+
+                priorities[v] = priority(v);
+                queue.push({ priorities[v], v });
+            }
+
+            // Contracting a vertex at the top of the hierarchy can take a
+            // while, so cancellation is checked before each one.
+            while (!queue.empty())
+            {
+                if (cancel && *cancel)
+                    return false;
+
+                auto [key, v] = queue.top();
+                queue.pop();
+
+                if (m_contracted[v] || key != priorities[v])
+                    continue;
+
+                // Lazy update: the priority may have grown since it was
+                // pushed. If it is no longer the smallest, try again later.
+                int current = priority(v);
+
+                if (!queue.empty() && current > queue.top().first)
+                {
+                    priorities[v] = current;
+                    queue.push({ current, v });
+                    continue;
+                }
+
+                // Neighbors only get their cheap terms updated. Their edge
+                // difference is measured again when they come up.
+                for (Index neighbor: contract(v))
+                {
+                    priorities[neighbor] = cached_priority(neighbor);
+                    queue.push({ priorities[neighbor], neighbor });
+                }
+            }
+
+            return true;
+        }
+
+        std::vector<std::vector<Edge>> up;      // Edges out of each vertex, upwards.
+        std::vector<std::vector<Edge>> down;    // Edges into each vertex, from above.
+        std::size_t num_shortcuts{ 0 };
+
+    private:
+        /* Adds an edge, or lowers the weight of the one already there, so
+         * there is at most one edge between two vertices. */
+        void add_edge(Index from, Index to, double weight, Index middle)
+        {
+            for (auto& edge: m_out[from])
+            {
+                if (edge.node != to)
+                    continue;
+
+                if (weight < edge.weight)
+                {
+                    edge = { to, weight, middle };
+
+                    for (auto& back: m_in[to])
+                    {
+                        if (back.node == from)
+                            back = { from, weight, middle };
+                    }
+                }
+
+                return;
+            }
+
+            m_out[from].push_back({ to, weight, middle });
+            m_in[to].push_back({ from, weight, middle });
+        }
+
+        /* Dijkstra from `source` in the remaining graph without `skip`. It
+         * stops past `limit`, after `max_settled` vertices, or once the
+         * `targets` vertices marked in m_targets, other than `source`, are
+         * settled. */
+        void witness_search(Index source, Index skip, double limit,
+                            std::size_t targets, std::size_t max_settled)
+        {
+            std::size_t settled = 0;
+
+            m_distances[source] = 0.0;
+            m_touched.push_back(source);
+            m_heap.clear();
+            m_heap.push_back({ 0.0, source });
+
+            while (!m_heap.empty() && settled < max_settled && targets > 0)
+            {
+                std::pop_heap(m_heap.begin(), m_heap.end(), std::greater<Entry>());
+                Entry entry = m_heap.back();
+                m_heap.pop_back();
+
+                if (entry.distance > m_distances[entry.vertex])
+                    continue;
+
+                if (entry.distance > limit)
+                    break;
+
+                ++settled;
+
+                if (m_targets[entry.vertex] && entry.vertex != source)
+                    --targets;
+
+                for (const auto& edge: m_out[entry.vertex])
+                {
+                    if (edge.node == skip)
+                        continue;
+
+                    double candidate = entry.distance + edge.weight;
+
+                    if (candidate < m_distances[edge.node])
+                    {
+                        if (m_distances[edge.node] == INFINITE)
+                            m_touched.push_back(edge.node);
+
+                        m_distances[edge.node] = candidate;
+                        m_heap.push_back({ candidate, edge.node });
+                        std::push_heap(m_heap.begin(), m_heap.end(), std::greater<Entry>());
+                    }
+                }
+            }
+        }
+
+        void clear_search()
+        {
+            for (auto v: m_touched)
+                m_distances[v] = INFINITE;
+
+            m_touched.clear();
+        }
+
+        /* Puts the edges out of in.node, other than to `v`, in
+         * m_distances. Returns true if they are enough to avoid every
+         * shortcut from in.node over `v`. */
+        bool direct_witnesses(const Edge& in, Index v)
+        {
+            for (const auto& edge: m_out[in.node])
+            {
+                if (edge.node != v)
+                {
+                    m_distances[edge.node] = edge.weight;
+                    m_touched.push_back(edge.node);
+                }
+            }
+
+            for (const auto& out: m_out[v])
+            {
+                if (out.node != in.node && m_distances[out.node] > in.weight + out.weight)
+                {
+                    clear_search();
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        /* Counts the shortcuts that contracting `v` needs, and adds them
+         * if `add` is true. */
+        int shortcuts(Index v, bool add)
+        {
+            std::vector<std::tuple<Index, Index, double>> found;
+            int count = 0;
+
+            for (const auto& out: m_out[v])
+                m_targets[out.node] = 1;
+
+            for (const auto& in: m_in[v])
+            {
+                double limit = -1.0;
+                std::size_t targets = m_out[v].size();
+
+                for (const auto& out: m_out[v])
+                {
+                    if (out.node != in.node)
+                        limit = std::max(limit, in.weight + out.weight);
+                    else
+                        --targets;
+                }
+
+                if (limit < 0.0)
+                    continue;
+
+                // In the dense top of the hierarchy, direct edges are
+                // usually witnesses already, and the search is not needed.
+                if (!direct_witnesses(in, v))
+                {
+                    witness_search(in.node, v, limit, targets,
+                                   add ? WITNESS_LIMIT : ESTIMATE_LIMIT);
+                }
+
+                for (const auto& out: m_out[v])
+                {
+                    double through = in.weight + out.weight;
+
+                    if (out.node != in.node && m_distances[out.node] > through)
+                    {
+                        ++count;
+
+                        if (add)
+                            found.emplace_back(in.node, out.node, through);
+                    }
+                }
+
+                clear_search();
+            }
+
+            for (const auto& out: m_out[v])
+                m_targets[out.node] = 0;
+
+            for (auto [from, to, weight]: found)
+                add_edge(from, to, weight, v);
+
+            num_shortcuts += found.size();
+
+            return count;
+        }
+
+        /* Edge difference: the shortcuts that contracting `v` adds, minus
+         * the edges it removes. The neighbors already contracted and the
+         * level (one above the highest contracted neighbor) spread the
+         * contraction evenly over the graph and keep the hierarchy shallow. */
+        int priority(Index v)
+        {
+            int removed = static_cast<int>(m_in[v].size() + m_out[v].size());
+
+            m_edge_difference[v] = shortcuts(v, false) - removed;
+
+            return cached_priority(v);
+        }
+
+        /* The priority with the last edge difference measured. */
+        int cached_priority(Index v) const
+        {
+            return EDGE_DIFFERENCE_WEIGHT * m_edge_difference[v]
+                + m_deleted_neighbors[v] + m_levels[v];
+        }
+
+        /* Contracts `v` and returns its neighbors. */
+        std::vector<Index> contract(Index v)
+        {
+            shortcuts(v, true);
+
+            up[v] = m_out[v];
+            down[v] = m_in[v];
+
+            std::vector<Index> neighbors;
+
+            for (const auto& edge: m_out[v])
+            {
+                auto& back = m_in[edge.node];
+                back.erase(std::remove_if(back.begin(), back.end(),
+                                          [v] (const Edge& e) { return e.node == v; }),
+                           back.end());
+                neighbors.push_back(edge.node);
+            }
+
+            for (const auto& edge: m_in[v])
+            {
+                auto& back = m_out[edge.node];
+                back.erase(std::remove_if(back.begin(), back.end(),
+                                          [v] (const Edge& e) { return e.node == v; }),
+                           back.end());
+                neighbors.push_back(edge.node);
+            }
+
+            std::sort(neighbors.begin(), neighbors.end());
+            neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+
+            for (auto neighbor: neighbors)
+            {
+                ++m_deleted_neighbors[neighbor];
+                m_levels[neighbor] = std::max(m_levels[neighbor], m_levels[v] + 1);
+            }
+
+            m_out[v] = {};
+            m_in[v] = {};
+            m_contracted[v] = 1;
+
+            return neighbors;
+        }
+
+        std::vector<std::vector<Edge>> m_out;
+        std::vector<std::vector<Edge>> m_in;
+        std::vector<std::uint8_t> m_contracted;
+        std::vector<int> m_edge_difference;
+        std::vector<int> m_deleted_neighbors;
+        std::vector<int> m_levels;
+
+        // Witness search state, reset after each search.
+        std::vector<double> m_distances;
+        std::vector<Index> m_touched;
+        std::vector<std::uint8_t> m_targets;
+        std::vector<Entry> m_heap;
+    };
+
+    /* Flattens per-vertex edge lists into offsets and one array. */
+    template<typename Arc>
+    void flatten(const std::vector<std::vector<Edge>>& lists,
+                 std::vector<Index>& offsets, std::vector<Arc>& arcs)
+    {
+        std::size_t total = 0;
+
+        for (const auto& list: lists)
+            total += list.size();
+
+        offsets.reserve(lists.size() + 1);
+        arcs.reserve(total);
+        offsets.push_back(0);
+
+        for (const auto& list: lists)
+        {
+            for (const auto& edge: list)
+                arcs.push_back({ edge.node, edge.weight, edge.middle });
+
+            offsets.push_back(static_cast<Index>(arcs.size()));
+        }
+    }
+}
+
+
+std::unique_ptr<ContractionHierarchy> ContractionHierarchy::build(
+    std::shared_ptr<const CsrGraph> graph, const std::atomic<bool>* cancel)
+{
+    Contractor contractor(*graph);
+
+    if (!contractor.run(cancel))
+        return nullptr;
+
+    std::unique_ptr<ContractionHierarchy> hierarchy{ new ContractionHierarchy() };
+
+    hierarchy->m_graph = std::move(graph);
+    hierarchy->m_num_shortcuts = contractor.num_shortcuts;
+
+    flatten(contractor.up, hierarchy->m_up_offsets, hierarchy->m_up);
+    flatten(contractor.down, hierarchy->m_down_offsets, hierarchy->m_down);
+
+    return hierarchy;
+}
+
+
+double ContractionHierarchy::find_path(Index src, Index tgt,
+                                       std::vector<Graph::VertexT>& path,
+                                       Graph::PathStats* stats) const
+{
+    struct Label
+    {
+        double distance;
+        Index parent;
+        Index arc;      // Index in m_up (forward) or m_down (backward).
+    };
+
+    using Queue = std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>>;
+
+    // Index 0 is the upward search from src, index 1 the one from tgt,
+    // which follows edges backwards. Both reach few vertices, so labels
+    // are kept in hash tables instead of arrays the size of the graph.
+    IdIndex<Label> labels[2];
+    Queue queues[2];
+    std::size_t settled = 0;
+
+    labels[0].try_emplace(src, { 0.0, src, NO_MIDDLE });
+    labels[1].try_emplace(tgt, { 0.0, tgt, NO_MIDDLE });
+    queues[0].push({ 0.0, src });
+    queues[1].push({ 0.0, tgt });
+
+    double best = src == tgt ? 0.0 : INFINITE;
+    Index meeting = src;
+
+    auto drop_stale = [&] (int side) {
+        while (!queues[side].empty()
+               && queues[side].top().distance > labels[side].find(queues[side].top().vertex)->distance)
+            queues[side].pop();
+    };
+
+    for (;;)
+    {
+        drop_stale(0);
+        drop_stale(1);
+
+        // Unlike plain bidirectional search, each side goes on until it
+        // alone cannot improve `best`: the highest vertex of the path may
+        // be far from where the two searches first touch.
+        bool open[2] = {
+            !queues[0].empty() && queues[0].top().distance < best,
+            !queues[1].empty() && queues[1].top().distance < best
+        };
+
+        if (!open[0] && !open[1])
+            break;
+
+        int side = !open[1] || (open[0] && queues[0].top().distance <= queues[1].top().distance) ? 0 : 1;
+        Entry entry = queues[side].top();
+        queues[side].pop();
+
+        ++settled;
+
+        const auto& arcs = side == 0 ? m_up : m_down;
+        const auto& offsets = side == 0 ? m_up_offsets : m_down_offsets;
+
+        // Stall on demand: if a higher vertex already reached gives a
+        // shorter way here, the distance is not final and relaxing from
+        // here is wasted work.
+        const auto& stall_arcs = side == 0 ? m_down : m_up;
+        const auto& stall_offsets = side == 0 ? m_down_offsets : m_up_offsets;
+        bool stalled = false;
+
+        for (Index e = stall_offsets[entry.vertex]; e < stall_offsets[entry.vertex + 1]; ++e)
+        {
+            const Label* higher = labels[side].find(stall_arcs[e].node);
+
+            if (higher && higher->distance + stall_arcs[e].weight < entry.distance)
+            {
+                stalled = true;
+                break;
+            }
+        }
+
+        if (stalled)
+            continue;
+
+        for (Index e = offsets[entry.vertex]; e < offsets[entry.vertex + 1]; ++e)
+        {
+            Index next = arcs[e].node;
+            double candidate = entry.distance + arcs[e].weight;
+            auto [label, inserted] = labels[side].try_emplace(next, { candidate, entry.vertex, e });
+
+            if (!inserted)
+            {
+                if (candidate >= label->distance)
+                    continue;
+
+                *label = { candidate, entry.vertex, e };
+            }
+
+            queues[side].push({ candidate, next });
+
+            const Label* other = labels[1 - side].find(next);
+
+            if (other && candidate + other->distance < best)
+            {
+                best = candidate + other->distance;
+                meeting = next;
+            }
+        }
+    }
+
+    if (stats)
+        stats->settled = settled;
+
+    if (best == INFINITE)
+        return INFINITE;
+
+    // Hierarchy edges from src up to the meeting vertex and down to tgt,
+    // each unpacked into the original vertices, from src to tgt.
+    std::vector<Index> upward;
+
+    for (Index v = meeting; v != src; v = labels[0].find(v)->parent)
+        upward.push_back(v);
+
+    std::vector<Index> vertices{ src };
+
+    for (auto it = upward.rbegin(); it != upward.rend(); ++it)
+    {
+        const Label* label = labels[0].find(*it);
+        unpack(label->parent, *it, m_up[label->arc].middle, vertices);
+    }
+
+    for (Index v = meeting; v != tgt; )
+    {
+        const Label* label = labels[1].find(v);
+        unpack(v, label->parent, m_down[label->arc].middle, vertices);
+        v = label->parent;
+    }
+
+    path.insert(path.end(), vertices.rbegin(), vertices.rend());
+
+    return best;
+}
+
+
+const ContractionHierarchy::Arc& ContractionHierarchy::find_up(Index from, Index to) const
+{
+    for (Index e = m_up_offsets[from]; e < m_up_offsets[from + 1]; ++e)
+    {
+        if (m_up[e].node == to)
+            return m_up[e];
+    }
+
+    throw std::logic_error("ContractionHierarchy: missing edge");
+}
+
+
+const ContractionHierarchy::Arc& ContractionHierarchy::find_down(Index from, Index to) const
+{
+    for (Index e = m_down_offsets[to]; e < m_down_offsets[to + 1]; ++e)
+    {
+        if (m_down[e].node == from)
+            return m_down[e];
+    }
+
+    throw std::logic_error("ContractionHierarchy: missing edge");
+}
+
+
+void ContractionHierarchy::unpack(Index from, Index to, Index middle,
+                                  std::vector<Index>& out) const
+{
+    // A shortcut from -> to over `middle` stands for from -> middle, where
+    // middle is the lower vertex, then middle -> to. Both may be shortcuts.
+    std::vector<std::tuple<Index, Index, Index>> pending{ { from, to, middle } };
+
+    while (!pending.empty())
+    {
+        auto [a, b, m] = pending.back();
+        pending.pop_back();
+
+        if (m == NO_MIDDLE)
+        {
+            out.push_back(b);
+            continue;
+        }
+
+        pending.emplace_back(m, b, find_up(m, b).middle);
+        pending.emplace_back(a, m, find_down(a, m).middle);
+    }
+}
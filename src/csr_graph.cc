@@ -0,0 +1,71 @@
+#include "csr_graph.h"
+
+#include <limits>           // for numeric_limits<>::max()
+#include <stdexcept>        // for length_error
+
+
+CsrGraph::CsrGraph(const Graph& graph)
+{
+    std::size_t num_vertices = graph.num_vertices();
+    std::size_t num_edges = 0;
+
+    for (auto [vi, vend] = graph.iter_vertices(); vi != vend; ++vi)
+        num_edges += graph.out_degree(*vi);
+
+    if (num_vertices >= std::numeric_limits<Index>::max()
+        || num_edges >= std::numeric_limits<Index>::max())
+    {
+        throw std::length_error("graph too large for CsrGraph");
+    }
+
+    m_offsets.reserve(num_vertices + 1);
+    m_targets.reserve(num_edges);
+    m_weights.reserve(num_edges);
+    m_names.reserve(num_edges);
+    m_oneway.reserve(num_edges);
+    m_coords.reserve(num_vertices);
+
+    m_offsets.push_back(0);
+
+    for (auto [vi, vend] = graph.iter_vertices(); vi != vend; ++vi)
+    {
+        for (auto [ei, eend] = graph.iter_out_edges(*vi); ei != eend; ++ei)
+        {
+            const auto& props = graph.get_edge_properties(*ei);
+
+            m_targets.push_back(static_cast<Index>(graph.get_edge_tgt(*ei)));
+            m_weights.push_back(props.weight);
+            m_names.push_back(props.name);
+            m_oneway.push_back(props.oneway ? 1 : 0);
+        }
+
+        m_offsets.push_back(static_cast<Index>(m_targets.size()));
+        m_coords.push_back(graph.get_vertex_coords(*vi));
+    }
+
+    // The reverse view is a counting sort of the edges by target. Edges
+    // into each vertex end up ordered by source.
+    m_in_offsets.assign(num_vertices + 1, 0);
+
+    for (auto target: m_targets)
+        ++m_in_offsets[target + 1];
+
+    for (std::size_t v = 0; v < num_vertices; ++v)
+        m_in_offsets[v + 1] += m_in_offsets[v];
+
+    m_in_sources.resize(num_edges);
+    m_in_weights.resize(num_edges);
+
+    std::vector<Index> next(m_in_offsets.begin(), m_in_offsets.end() - 1);
+
+    for (Index v = 0; v < num_vertices; ++v)
+    {
+        for (Index e = m_offsets[v]; e < m_offsets[v + 1]; ++e)
+        {
+            Index slot = next[m_targets[e]]++;
+
+            m_in_sources[slot] = v;
+            m_in_weights[slot] = m_weights[e];
+        }
+    }
+}
@@ -1,8 +1,21 @@
 #include "graph.h"
 
-#include <boost/graph/dijkstra_shortest_paths.hpp>
-
+#include "contraction_hierarchy.h"
+#include "csr_graph.h"
+#include "landmarks.h"
+#include "name_index.h"
+#include "path_search.h"
+#include "search_workspace.h"
+#include "spatial_grid.h"
+#include "thread_pool.h"
+
+#include <algorithm>        // for find(), lower_bound(), max(), min(), sort(), unique()
+#include <atomic>
+#include <cmath>            // for hypot()
+#include <future>
 #include <limits>           // for numeric_limits<>::max()
+#include <thread>           // for hardware_concurrency()
+#include <utility>          // for move(), pair
 
 
 std::unique_ptr<Graph> Graph::create()
@@ -12,14 +25,255 @@ std::unique_ptr<Graph> Graph::create()
 
 Graph::VertexT Graph::add_vertex(const Graph::VertexProperties& vertex)
 {
-    return boost::add_vertex(vertex, m_adj_list);
+    thaw(true);
+
+    VertexT descriptor;
+
+    // A removed vertex left its slot, with no edges, for the next one.
+    if (!m_free.empty())
+    {
+        descriptor = m_free.back();
+        m_free.pop_back();
+
+        m_removed[descriptor] = false;
+        m_generations[descriptor] = m_next_generation++;
+        m_adj_list[descriptor] = vertex;
+    }
+    else
+    {
+        descriptor = boost::add_vertex(vertex, m_adj_list);
+        m_removed.push_back(false);
+        m_generations.push_back(m_next_generation++);
+
+        if (m_predecessors)
+            m_predecessors->emplace_back();
+    }
+
+    index_id(descriptor);
+
+    std::lock_guard lock{ m_spatial.mutex };
+
+    if (m_spatial.grid)
+        m_spatial.grid->insert(descriptor, vertex.coord);
+
+    return descriptor;
 }
 
 
 void Graph::remove_vertex(const Graph::VertexT& vertex)
 {
-    boost::clear_vertex(vertex, m_adj_list);
-    boost::remove_vertex(vertex, m_adj_list);
+    if (m_removed[vertex])
+        return;
+
+    thaw();
+
+    {
+        std::lock_guard lock{ m_spatial.mutex };
+
+        if (m_spatial.grid)
+            m_spatial.grid->erase(vertex, m_adj_list[vertex].coord);
+    }
+
+    unindex_id(vertex);
+
+    // The edges that arrive at the vertex are found by their sources, so
+    // only its neighbours are visited, and not the whole graph.
+    auto& predecessors = this->predecessors();
+
+    for (auto [ei, eend] = boost::out_edges(vertex, m_adj_list); ei != eend; ++ei)
+    {
+        auto& sources = predecessors[boost::target(*ei, m_adj_list)];
+        sources.erase(std::find(sources.begin(), sources.end(), vertex));
+    }
+
+    boost::clear_out_edges(vertex, m_adj_list);
+
+    for (auto src: predecessors[vertex])
+        boost::remove_edge(src, vertex, m_adj_list);
+
+    predecessors[vertex].clear();
+
+    m_removed[vertex] = true;
+    m_free.push_back(vertex);
+}
+
+
+std::vector<Graph::VertexT> Graph::remove_vertices(const std::vector<Graph::VertexT>& vertices)
+{
+    for (auto v: vertices)
+        remove_vertex(v);
+
+    if (fragmented())
+        return compact();
+
+    return {};
+}
+
+
+std::size_t Graph::num_removed() const
+{
+    return m_free.size();
+}
+
+
+bool Graph::is_removed(const Graph::VertexT& vertex) const
+{
+    return m_removed[vertex];
+}
+
+
+Graph::VertexHandle Graph::get_handle(const Graph::VertexT& vertex) const
+{
+    return { vertex, m_generations[vertex] };
+}
+
+
+bool Graph::is_valid(const Graph::VertexHandle& handle) const
+{
+    return handle.vertex < m_generations.size()
+        && !m_removed[handle.vertex]
+        && m_generations[handle.vertex] == handle.generation;
+}
+
+
+bool Graph::fragmented() const
+{
+    return m_free.size() > num_vertices() * MAX_FRAGMENTATION;
+}
+
+
+std::vector<Graph::VertexT> Graph::compact()
+{
+    if (m_free.empty())
+        return {};
+
+    thaw();
+
+    {
+        // Cheaper to build again, when needed, than to renumber.
+        std::lock_guard lock{ m_spatial.mutex };
+        m_spatial.grid.reset();
+    }
+
+    // The list is rebuilt with the remaining vertices, renumbered in order.
+    std::vector<VertexT> new_index(num_vertices(), 0);
+
+    AdjList adj_list;
+    VertexT next = 0;
+
+    for (auto [vi, vend] = boost::vertices(m_adj_list); vi != vend; ++vi)
+    {
+        if (m_removed[*vi])
+        {
+            new_index[*vi] = REMOVED_VERTEX;
+            continue;
+        }
+
+        new_index[*vi] = next++;
+        boost::add_vertex(std::move(m_adj_list[*vi]), adj_list);
+    }
+
+    for (auto [ei, eend] = boost::edges(m_adj_list); ei != eend; ++ei)
+    {
+        auto src = new_index[boost::source(*ei, m_adj_list)];
+        auto tgt = new_index[boost::target(*ei, m_adj_list)];
+
+        if (src != REMOVED_VERTEX && tgt != REMOVED_VERTEX)
+            boost::add_edge(src, tgt, std::move(m_adj_list[*ei]), adj_list);
+    }
+
+    m_adj_list = std::move(adj_list);
+    m_removed.assign(next, false);
+    m_free.clear();
+
+    // Every vertex moved, so handles made before must not find them.
+    m_generations.resize(next);
+
+    for (auto& generation: m_generations)
+        generation = m_next_generation++;
+
+    m_predecessors.reset();
+
+    m_ids.clear();
+
+    for (auto [vi, vend] = boost::vertices(m_adj_list); vi != vend; ++vi)
+        index_id(*vi);
+
+    return new_index;
+}
+
+
+void Graph::set_vertex_coords(const Graph::VertexT& vertex,
+                              const Graph::VertexCoords& coord)
+{
+    const VertexCoords old = m_adj_list[vertex].coord;
+
+    auto distance = [] (const VertexCoords& a, const VertexCoords& b) {
+        return std::hypot(a.x - b.x, a.y - b.y);
+    };
+
+    auto coords_of = [&] (VertexT v, bool moved) {
+        return v != vertex ? m_adj_list[v].coord : (moved ? coord : old);
+    };
+
+    // Only the ends of an edge that touch the vertex change length, so the
+    // weight changes by as much as they do. Shaped edges keep their middle.
+    auto end_lengths = [&] (const EdgeT& edge, bool moved) {
+        const auto& props = m_adj_list[edge];
+        auto src = coords_of(boost::source(edge, m_adj_list), moved);
+        auto tgt = coords_of(boost::target(edge, m_adj_list), moved);
+
+        if (props.geometry.empty())
+            return distance(src, tgt);
+
+        return distance(src, props.geometry.front())
+            + distance(props.geometry.back(), tgt);
+    };
+
+    std::vector<std::pair<EdgeT, double>> changes;
+    bool shorter = false;
+
+    auto measure = [&] (const EdgeT& edge) {
+        double change = end_lengths(edge, true) - end_lengths(edge, false);
+
+        changes.emplace_back(edge, change);
+        shorter = shorter || change < 0.0;
+    };
+
+    for (auto [ei, eend] = boost::out_edges(vertex, m_adj_list); ei != eend; ++ei)
+        measure(*ei);
+
+    // Parallel edges list their source more than once.
+    std::vector<VertexT> sources{ predecessors()[vertex] };
+    std::sort(sources.begin(), sources.end());
+    sources.erase(std::unique(sources.begin(), sources.end()), sources.end());
+
+    for (auto src: sources)
+    {
+        if (src == vertex)
+            continue;
+
+        for (auto [ei, eend] = boost::out_edges(src, m_adj_list); ei != eend; ++ei)
+        {
+            if (boost::target(*ei, m_adj_list) == vertex)
+                measure(*ei);
+        }
+    }
+
+    // Landmark distances stay lower bounds only if no edge got shorter.
+    thaw(!shorter);
+
+    for (const auto& [edge, change]: changes)
+        m_adj_list[edge].weight = std::max(0.0, m_adj_list[edge].weight + change);
+
+    {
+        std::lock_guard lock{ m_spatial.mutex };
+
+        if (m_spatial.grid)
+            m_spatial.grid->move(vertex, m_adj_list[vertex].coord, coord);
+    }
+
+    m_adj_list[vertex].coord = coord;
 }
 
 
@@ -27,12 +281,31 @@ std::optional<Graph::EdgeT> Graph::add_edge(const Graph::VertexT& src,
                                             const Graph::VertexT& tgt,
                                             const Graph::EdgeProperties& edge)
 {
+    thaw();
     auto [descriptor, success] = boost::add_edge(src, tgt, edge, m_adj_list);
 
-    if (success)
-        return descriptor;
-    else
+    if (!success)
         return std::nullopt;
+
+    if (m_predecessors)
+        (*m_predecessors)[tgt].push_back(src);
+
+    return descriptor;
+}
+
+
+void Graph::remove_edge(const Graph::EdgeT& edge)
+{
+    thaw(true);
+
+    if (m_predecessors)
+    {
+        auto& sources = (*m_predecessors)[boost::target(edge, m_adj_list)];
+        sources.erase(std::find(sources.begin(), sources.end(),
+                                boost::source(edge, m_adj_list)));
+    }
+
+    boost::remove_edge(edge, m_adj_list);
 }
 
 
@@ -56,6 +329,30 @@ Graph::get_edge_properties(const Graph::EdgeT& edge) const
 }
 
 
+Graph::NameID Graph::intern_name(std::string_view name)
+{
+    return m_names.intern(name);
+}
+
+
+const std::string& Graph::get_name(Graph::NameID name) const
+{
+    return m_names.get(name);
+}
+
+
+std::size_t Graph::num_names() const
+{
+    return m_names.size();
+}
+
+
+const std::string& Graph::get_edge_name(const Graph::EdgeT& edge) const
+{
+    return m_names.get(m_adj_list[edge].name);
+}
+
+
 const Graph::VertexCoords&
 Graph::get_vertex_coords(const Graph::VertexT& vertex) const
 {
@@ -72,10 +369,13 @@ std::size_t Graph::get_vertex_id(const Graph::VertexT& vertex) const
 std::vector<std::size_t> Graph::get_vertex_id_list() const
 {
     std::vector<std::size_t> vec;
-    vec.reserve(boost::num_vertices(m_adj_list));
+    vec.reserve(boost::num_vertices(m_adj_list) - m_free.size());
 
     for (auto [vi, vend] = boost::vertices(m_adj_list); vi != vend; ++vi)
-        vec.push_back(m_adj_list[*vi].id);
+    {
+        if (!m_removed[*vi])
+            vec.push_back(m_adj_list[*vi].id);
+    }
 
     return vec;
 }
@@ -93,37 +393,303 @@ bool Graph::is_edge_oneway(const Graph::EdgeT& edge) const
 }
 
 
+std::shared_ptr<const CsrGraph> Graph::frozen() const
+{
+    std::lock_guard lock{ m_frozen.mutex };
+
+    if (!m_frozen.csr)
+        m_frozen.csr = std::make_shared<const CsrGraph>(*this);
+
+    return m_frozen.csr;
+}
+
+
+bool Graph::set_hierarchy(std::shared_ptr<const ContractionHierarchy> hierarchy)
+{
+    std::lock_guard lock{ m_frozen.mutex };
+
+    if (!hierarchy || !m_frozen.csr || hierarchy->graph() != m_frozen.csr)
+        return false;
+
+    m_frozen.hierarchy = std::move(hierarchy);
+    return true;
+}
+
+
+std::shared_ptr<const ContractionHierarchy> Graph::hierarchy() const
+{
+    std::lock_guard lock{ m_frozen.mutex };
+    return m_frozen.hierarchy;
+}
+
+
+bool Graph::set_landmarks(std::shared_ptr<const Landmarks> landmarks)
+{
+    std::lock_guard lock{ m_frozen.mutex };
+
+    if (!landmarks || !m_frozen.csr || landmarks->graph().lock() != m_frozen.csr)
+        return false;
+
+    m_frozen.landmarks = std::move(landmarks);
+    return true;
+}
+
+
+std::shared_ptr<const Landmarks> Graph::landmarks() const
+{
+    std::lock_guard lock{ m_frozen.mutex };
+    return m_frozen.landmarks;
+}
+
+
+void Graph::thaw(bool keep_landmarks)
+{
+    std::lock_guard lock{ m_frozen.mutex };
+    m_frozen.csr.reset();
+    m_frozen.hierarchy.reset();
+    m_frozen.names.reset();
+
+    if (!keep_landmarks)
+        m_frozen.landmarks.reset();
+}
+
+
+void Graph::index_id(const Graph::VertexT& vertex)
+{
+    std::size_t id = m_adj_list[vertex].id;
+
+    if (id == IdIndex<IdEntry>::RESERVED_ID)
+        return;
+
+    // A vertex already in the index stays there; the others with the same
+    // id wait in its list.
+    auto [entry, inserted] = m_ids.try_emplace(id, IdEntry{ vertex, {} });
+
+    if (!inserted)
+        entry->others.push_back(vertex);
+}
+
+
+void Graph::unindex_id(const Graph::VertexT& vertex)
+{
+    std::size_t id = m_adj_list[vertex].id;
+    IdEntry* entry = m_ids.find(id);
+
+    if (!entry)
+        return;
+
+    auto& others = entry->others;
+
+    if (entry->vertex == vertex)
+    {
+        if (others.empty())
+        {
+            m_ids.erase(id);
+            return;
+        }
+
+        entry->vertex = others.back();
+        others.pop_back();
+        return;
+    }
+
+    // Vertices drawn by hand are usually removed soon after being added,
+    // so the search starts from the end.
+    auto it = std::find(others.rbegin(), others.rend(), vertex);
+
+    if (it != others.rend())
+    {
+        *it = others.back();
+        others.pop_back();
+    }
+}
+
+
+std::vector<std::vector<Graph::VertexT>>& Graph::predecessors()
+{
+    if (!m_predecessors)
+    {
+        m_predecessors.emplace(num_vertices());
+
+        for (auto [ei, eend] = boost::edges(m_adj_list); ei != eend; ++ei)
+        {
+            (*m_predecessors)[boost::target(*ei, m_adj_list)].push_back(
+                boost::source(*ei, m_adj_list));
+        }
+    }
+
+    return *m_predecessors;
+}
+
+
+std::shared_ptr<const SpatialGrid> Graph::spatial_grid() const
+{
+    std::lock_guard lock{ m_spatial.mutex };
+
+    if (!m_spatial.grid)
+        m_spatial.grid = std::make_shared<SpatialGrid>(*this);
+
+    return m_spatial.grid;
+}
+
+
+Graph::SpatialCache& Graph::SpatialCache::operator=(const Graph::SpatialCache&)
+{
+    std::lock_guard lock{ mutex };
+    grid.reset();
+
+    return *this;
+}
+
+
+Graph::FrozenCache& Graph::FrozenCache::operator=(const Graph::FrozenCache&)
+{
+    std::lock_guard lock{ mutex };
+    csr.reset();
+    hierarchy.reset();
+    landmarks.reset();
+    names.reset();
+
+    return *this;
+}
+
+
 double Graph::plot_path(const Graph::VertexT& src,
                         const Graph::VertexT& tgt,
-                        std::vector<Graph::VertexT>& path) const
+                        std::vector<Graph::VertexT>& path,
+                        Graph::PathAlgorithm algorithm,
+                        Graph::PathStats* stats) const
 {
-    std::vector<VertexT> predecessors(num_vertices());
+    auto csr{ frozen() };
 
-    for (std::size_t i = 0; i < predecessors.size(); ++i)
-        predecessors[i] = static_cast<VertexT>(i);
+    auto csr_src = static_cast<CsrGraph::Index>(src);
+    auto csr_tgt = static_cast<CsrGraph::Index>(tgt);
 
-    std::vector<double> distances(num_vertices());
+    switch (algorithm)
+    {
+    case PathAlgorithm::astar:
+        return path_search::astar(*csr, csr_src, csr_tgt, path, stats);
 
-    boost::dijkstra_shortest_paths(m_adj_list, src,
-        predecessor_map(boost::make_iterator_property_map(
-            predecessors.begin(), get(boost::vertex_index, m_adj_list)))
-        .distance_map(boost::make_iterator_property_map(
-            distances.begin(), get(boost::vertex_index, m_adj_list)))
-        .weight_map(get(&EdgeProperties::weight, m_adj_list)));
+    case PathAlgorithm::hierarchy:
+        if (auto ch{ hierarchy() })
+            return ch->find_path(csr_src, csr_tgt, path, stats);
 
-    if (distances[tgt] == std::numeric_limits<double>::max())
-        return std::numeric_limits<double>::max();
+        return path_search::bidirectional(*csr, csr_src, csr_tgt, path, stats);
 
-    auto current_vertex = tgt;
-    while (current_vertex != src)
+    case PathAlgorithm::landmarks:
+        if (auto lm{ landmarks() })
+            return path_search::alt(*csr, *lm, csr_src, csr_tgt, path, stats);
+
+        return path_search::astar(*csr, csr_src, csr_tgt, path, stats);
+
+    case PathAlgorithm::bidirectional:
+        return path_search::bidirectional(*csr, csr_src, csr_tgt, path, stats);
+
+    case PathAlgorithm::dijkstra:
+    default:
+        return path_search::dijkstra(*csr, csr_src, csr_tgt, path, stats);
+    }
+}
+
+
+Graph::DistanceMatrix Graph::distance_matrix(const std::vector<Graph::VertexT>& sources,
+                                             const std::vector<Graph::VertexT>& targets,
+                                             bool with_paths, unsigned threads) const
+{
+    DistanceMatrix matrix;
+    matrix.num_sources = sources.size();
+    matrix.num_targets = targets.size();
+    matrix.distances.resize(sources.size() * targets.size());
+
+    if (with_paths)
+        matrix.paths.resize(sources.size() * targets.size());
+
+    if (sources.empty() || targets.empty())
+        return matrix;
+
+    auto csr{ frozen() };
+    path_search::Targets buckets{ std::vector<CsrGraph::Index>(targets.begin(), targets.end()) };
+
+    // Each worker takes the next source until none is left.
+    std::atomic<std::size_t> next{ 0 };
+
+    auto work = [&] (SearchWorkspace* workspace) {
+        for (std::size_t i = next++; i < sources.size(); i = next++)
+        {
+            std::size_t row = i * targets.size();
+
+            path_search::one_to_many(*csr, static_cast<CsrGraph::Index>(sources[i]), buckets,
+                                     &matrix.distances[row],
+                                     with_paths ? &matrix.paths[row] : nullptr,
+                                     workspace);
+        }
+    };
+
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    threads = static_cast<unsigned>(std::min<std::size_t>(threads, sources.size()));
+
+    if (threads == 1)
+    {
+        work(nullptr);
+        return matrix;
+    }
+
+    ThreadPool pool{ threads };
+    std::vector<std::future<void>> tasks;
+
+    for (unsigned t = 0; t < threads; ++t)
     {
-        path.push_back(current_vertex);
-        current_vertex = predecessors[current_vertex];
+        tasks.push_back(pool.submit([&work] () {
+            SearchWorkspace workspace;
+            work(&workspace);
+        }));
     }
 
-    path.push_back(src);
+    for (auto& task: tasks)
+        task.get();
 
-    return distances[tgt];
+    return matrix;
+}
+
+
+void Graph::reachable(const Graph::VertexT& src, const std::vector<double>& budgets,
+                      Graph::Reachable& result) const
+{
+    result.clear();
+
+    if (budgets.empty())
+        return;
+
+    result.budgets = budgets;
+    std::sort(result.budgets.begin(), result.budgets.end());
+
+    double budget = result.budgets.back();
+
+    auto band = [&] (double distance) -> std::size_t {
+        return std::lower_bound(result.budgets.begin(), result.budgets.end(), distance)
+            - result.budgets.begin();
+    };
+
+    path_search::within(*frozen(), static_cast<CsrGraph::Index>(src), budget,
+                        result.vertices, result.distances);
+
+    for (std::size_t i = 0; i < result.vertices.size(); ++i)
+    {
+        result.vertex_bands.push_back(band(result.distances[i]));
+
+        for (auto [ei, eend] = iter_out_edges(result.vertices[i]); ei != eend; ++ei)
+        {
+            double distance = result.distances[i] + m_adj_list[*ei].weight;
+
+            if (distance <= budget)
+            {
+                result.edges.push_back(*ei);
+                result.edge_bands.push_back(band(distance));
+            }
+        }
+    }
 }
 
 
@@ -151,23 +717,56 @@ std::pair<Graph::EdgeIter, Graph::EdgeIter> Graph::iter_edges() const
 }
 
 
-std::optional<Graph::VertexT>
-Graph::find_vertex_with_coords(double x, double y, double margin) const
+std::pair<Graph::OutEdgeIter, Graph::OutEdgeIter>
+Graph::iter_out_edges(const Graph::VertexT& vertex) const
 {
-    for (auto [vi, vend] = boost::vertices(m_adj_list); vi != vend; ++vi)
+    return boost::out_edges(vertex, m_adj_list);
+}
+
+
+std::size_t Graph::out_degree(const Graph::VertexT& vertex) const
+{
+    return boost::out_degree(vertex, m_adj_list);
+}
+
+
+std::size_t Graph::in_degree(const Graph::VertexT& vertex)
+{
+    return predecessors()[vertex].size();
+}
+
+
+std::optional<Graph::EdgeT>
+Graph::find_edge(const Graph::VertexT& src, const Graph::VertexT& tgt) const
+{
+    std::optional<EdgeT> best;
+
+    for (auto [ei, eend] = boost::out_edges(src, m_adj_list); ei != eend; ++ei)
     {
-        const auto& point = m_adj_list[*vi].coord;
+        if (boost::target(*ei, m_adj_list) != tgt)
+            continue;
 
-        if (x <= point.x + margin &&
-            x >= point.x - margin &&
-            y <= point.y + margin &&
-            y >= point.y - margin)
-        {
-            return *vi;
-        }
+        if (!best || m_adj_list[*ei].weight < m_adj_list[*best].weight)
+            best = *ei;
     }
 
-    return {};
+    return best;
+}
+
+
+std::optional<Graph::VertexT>
+Graph::find_vertex_with_coords(double x, double y, double margin) const
+{
+    return spatial_grid()->nearest({ x, y }, margin);
+}
+
+
+std::vector<Graph::VertexT> Graph::find_vertices_within(double x, double y, double radius) const
+{
+    std::vector<VertexT> vertices;
+    spatial_grid()->within({ x, y }, radius, vertices);
+
+    return vertices;
 }
 
 
@@ -176,10 +775,10 @@ Graph::find_vertex_id(std::size_t id) const
 {
     auto [vi, vend] = boost::vertices(m_adj_list);
 
-    while (vi != vend && m_adj_list[*vi].id != id)
-        ++vi;
+    if (const IdEntry* entry = m_ids.find(id))
+        return { vi + entry->vertex, vend };
 
-    return { vi, vend };
+    return { vend, vend };
 }
 
 
@@ -188,8 +787,23 @@ Graph::find_edge_name(const std::string& name) const
 {
     auto [vi, vend] = boost::edges(m_adj_list);
 
-    while (vi != vend && m_adj_list[*vi].name != name)
+    auto id = m_names.find(name);
+    if (!id)
+        return { vend, vend };
+
+    while (vi != vend && m_adj_list[*vi].name != *id)
         ++vi;
 
     return { vi, vend };
 }
+
+
+std::shared_ptr<const NameIndex> Graph::name_index() const
+{
+    std::lock_guard lock{ m_frozen.mutex };
+
+    if (!m_frozen.names)
+        m_frozen.names = std::make_shared<const NameIndex>(*this);
+
+    return m_frozen.names;
+}
@@ -0,0 +1,339 @@
+#include "graph_builder.h"
+#include "osm_parser.h"
+
+#include <algorithm>        // for binary_search(), max(), sort(), unique()
+#include <cmath>            // for sqrt() and pow()
+#include <iterator>         // for make_move_iterator()
+#include <utility>          // for move()
+
+
+using Vertex = Graph::VertexProperties;
+using Edge = Graph::EdgeProperties;
+
+using osm_parser::GraphBuilder;
+
+
+namespace
+{
+    double vertex_distance(const Vertex& a, const Vertex& b)
+    {
+        return std::sqrt(
+            std::pow(a.coord.x - b.coord.x, 2)
+            + std::pow(a.coord.y - b.coord.y, 2)
+        );
+    }
+}
+
+
+GraphBuilder::GraphBuilder()
+    : m_graph(Graph::create())
+{}
+
+
+void GraphBuilder::set_bounds(double minlat, double maxlat,
+                              double minlon, double maxlon)
+{
+    if (m_projection_fixed)
+        return;
+
+    m_projection = osm_parser::Projection({ minlat, maxlat, minlon, maxlon });
+    m_has_projection = true;
+}
+
+
+void GraphBuilder::set_projection(const osm_parser::Projection& projection)
+{
+    m_projection = projection;
+    m_has_projection = true;
+    m_projection_fixed = true;
+}
+
+
+bool GraphBuilder::has_projection() const
+{
+    return m_has_projection;
+}
+
+
+void GraphBuilder::set_profile(osm_parser::Profile profile)
+{
+    m_profile = profile;
+}
+
+
+osm_parser::Profile GraphBuilder::profile() const
+{
+    return m_profile;
+}
+
+
+void GraphBuilder::set_progress(const osm_parser::Options& options,
+                                std::size_t bytes_total)
+{
+    m_progress = options.progress;
+    m_cancel = options.cancel;
+    m_bytes_total = bytes_total;
+
+    if (m_progress || m_cancel)
+        m_next_report = 0;
+}
+
+
+void GraphBuilder::set_progress_base(std::size_t bytes)
+{
+    m_progress_base = bytes;
+}
+
+
+void GraphBuilder::do_report_progress(std::size_t bytes)
+{
+    // Reports are spread over the file: often enough for a progress bar
+    // and for cancelling, seldom enough to cost nothing.
+    constexpr std::size_t REPORTS = 256;
+    constexpr std::size_t MIN_STEP = 64 * 1024;
+
+    if (is_cancelled())
+        throw osm_parser::Cancelled();
+
+    if (m_progress)
+        m_progress({ bytes, m_bytes_total, m_nodes.size(), m_num_ways });
+
+    m_next_report = bytes + std::max(m_bytes_total / REPORTS, MIN_STEP);
+}
+
+
+void GraphBuilder::set_wanted_nodes(std::vector<std::size_t>&& ids)
+{
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    ids.shrink_to_fit();
+
+    m_wanted = std::move(ids);
+    m_filter_nodes = true;
+}
+
+
+bool GraphBuilder::wants_node(std::size_t id) const
+{
+    return !m_filter_nodes
+        || std::binary_search(m_wanted.begin(), m_wanted.end(), id);
+}
+
+
+void GraphBuilder::add_node(const Vertex& node)
+{
+    m_nodes.push_back(node);
+}
+
+
+void GraphBuilder::add_nodes(NodeTable&& nodes)
+{
+    if (m_nodes.empty())
+        m_nodes = std::move(nodes);
+    else
+        m_nodes.insert(m_nodes.end(),
+                       std::make_move_iterator(nodes.begin()),
+                       std::make_move_iterator(nodes.end()));
+}
+
+
+void GraphBuilder::index_nodes()
+{
+    m_node_pos.reserve(m_nodes.size());
+
+    // A repeated id is left in the table, but never referenced.
+    for (; m_indexed < m_nodes.size(); ++m_indexed)
+        m_node_pos.try_emplace(m_nodes[m_indexed].id, m_indexed);
+
+    m_node_vd.resize(m_nodes.size(), NO_VERTEX);
+}
+
+
+Graph::VertexT GraphBuilder::vertex_at(std::size_t pos)
+{
+    if (m_node_vd[pos] == NO_VERTEX)
+        m_node_vd[pos] = m_graph->add_vertex(m_nodes[pos]);
+
+    return m_node_vd[pos];
+}
+
+
+void GraphBuilder::add_way(std::size_t id,
+                           const std::vector<std::size_t>& waypoints,
+                           std::string_view name, bool oneway)
+{
+    if (m_keep_ways)
+    {
+        m_ways.push_back({ id, waypoints, std::string(name), oneway });
+        ++m_num_ways;
+        return;
+    }
+
+    if (m_indexed != m_nodes.size())
+        index_nodes();
+
+    Edge edge;
+    edge.name = m_graph->intern_name(name);
+    edge.oneway = oneway;
+    ++m_num_ways;
+
+    if (m_way_table)
+        m_way_table->ways.insert_or_assign(id, { waypoints, edge.name, oneway });
+
+    // Each waypoint is looked up once; as the target of one pair, its
+    // position is kept to be the source of the next.
+    const std::size_t* src = nullptr;
+
+    for (std::size_t i = 0; i < waypoints.size(); ++i)
+    {
+        const std::size_t* tgt = m_node_pos.find(waypoints[i]);
+
+        // If src or tgt nodes don't exist, jump to next pair
+        if (!src || !tgt)
+        {
+            src = tgt;
+            continue;
+        }
+
+        // Vertices are added to the graph only when first used
+        Graph::VertexT src_vd = vertex_at(*src);
+        Graph::VertexT tgt_vd = vertex_at(*tgt);
+
+        edge.weight = vertex_distance(m_nodes[*src], m_nodes[*tgt]);
+
+        if (!m_graph->add_edge(src_vd, tgt_vd, edge))
+        {
+            // If we get here, it means that somehow edge could not be added
+            throw ParserError("error adding edges to graph");
+        }
+
+        // Graph is directed. If we have a two-way path between vertices,
+        // then we must add another inverted edge.
+        if (!edge.oneway && !m_graph->add_edge(tgt_vd, src_vd, edge))
+            throw ParserError("error adding edges to graph");
+
+        src = tgt;
+    }
+}
+
+
+void GraphBuilder::keep_ways()
+{
+    m_keep_ways = true;
+}
+
+
+void GraphBuilder::set_way_table(osm_parser::WayTable* table)
+{
+    m_way_table = table;
+}
+
+
+void GraphBuilder::keep_other_ways()
+{
+    m_keep_other_ways = true;
+}
+
+
+bool GraphBuilder::keeps_other_ways() const
+{
+    return m_keep_other_ways;
+}
+
+
+void GraphBuilder::add_other_way(const std::vector<std::size_t>& waypoints)
+{
+    // Ways share most of their nodes with others, so the ids are made
+    // unique whenever the list has doubled since the last time.
+    constexpr std::size_t MIN_DEDUP = 1 << 16;
+
+    if (!m_keep_other_ways)
+        return;
+
+    m_other_nodes.insert(m_other_nodes.end(), waypoints.begin(), waypoints.end());
+
+    if (m_other_nodes.size() >= std::max(2 * m_other_unique, MIN_DEDUP))
+        dedup_other_nodes();
+}
+
+
+void GraphBuilder::dedup_other_nodes()
+{
+    std::sort(m_other_nodes.begin(), m_other_nodes.end());
+    m_other_nodes.erase(std::unique(m_other_nodes.begin(), m_other_nodes.end()),
+                        m_other_nodes.end());
+
+    m_other_unique = m_other_nodes.size();
+}
+
+
+GraphBuilder::NodeTable GraphBuilder::take_nodes()
+{
+    m_node_pos.clear();
+    m_indexed = 0;
+    m_node_vd.clear();
+
+    return std::move(m_nodes);
+}
+
+
+std::vector<GraphBuilder::Way> GraphBuilder::take_ways()
+{
+    return std::move(m_ways);
+}
+
+
+std::vector<std::size_t> GraphBuilder::take_other_nodes()
+{
+    dedup_other_nodes();
+    m_other_unique = 0;
+
+    return std::move(m_other_nodes);
+}
+
+
+void GraphBuilder::fill_way_table_nodes()
+{
+    if (m_indexed != m_nodes.size())
+        index_nodes();
+
+    auto& table_nodes = m_way_table->nodes;
+
+    // Nodes of the ways, and of the other ways when they are kept, that did
+    // not become vertices. Those the file does not have are kept too, so
+    // that changes skip them instead of asking for the map to be read again.
+    auto keep = [&] (std::size_t id) {
+        const std::size_t* pos = m_node_pos.find(id);
+
+        if (!pos)
+            table_nodes.try_emplace(id, { { 0.0, 0.0 }, true });
+        else if (m_node_vd[*pos] == NO_VERTEX)
+            table_nodes.try_emplace(id, { m_nodes[*pos].coord, false });
+    };
+
+    m_way_table->ways.for_each([&] (std::size_t, const osm_parser::WayTable::Way& way) {
+        for (auto id: way.nodes)
+            keep(id);
+    });
+
+    for (auto id: m_other_nodes)
+        keep(id);
+
+    std::vector<std::size_t>{}.swap(m_other_nodes);
+    m_other_unique = 0;
+}
+
+
+std::unique_ptr<Graph> GraphBuilder::finish()
+{
+    if (m_way_table)
+    {
+        m_way_table->bounds = m_projection.bounds();
+        m_way_table->profile = m_profile;
+        m_way_table->valid = true;
+
+        fill_way_table_nodes();
+    }
+
+    return std::move(m_graph);
+}
@@ -1,5 +1,7 @@
 #include "graph_drawing_area.h"
 
+#include "name_index.h"
+
 #include <gtkmm/eventcontrollerscroll.h>
 #include <gtkmm/eventcontrollerkey.h>
 #include <gtkmm/gesturedrag.h>
@@ -8,7 +10,7 @@
 #include <chrono>      // for steady_clock
 #include <format>      // for format()
 #include <limits>      // for numeric_limits<>::max(), numeric_limits<>::min()
-#include <utility>     // for move()
+#include <utility>     // for move(), pair
 
 #define VERTEX_PIXEL_RADIUS 5.0
 #define ARROW_PIXEL_LEN 10.0
@@ -33,6 +35,8 @@ GraphDrawingArea::GraphDrawingArea(BaseObjectType* cobject,
         sigc::mem_fun(*this, &GraphDrawingArea::on_drag_begin));
     drag_gesture->signal_drag_update().connect(
         sigc::mem_fun(*this, &GraphDrawingArea::on_drag_update));
+    drag_gesture->signal_drag_end().connect(
+        sigc::mem_fun(*this, &GraphDrawingArea::on_drag_end));
     add_controller(drag_gesture);
 
     auto scroll_gesture = Gtk::EventControllerScroll::create();
@@ -52,17 +56,54 @@ void GraphDrawingArea::on_drag_begin(double x, double y)
 {
     m_drag_start_x = m_offset_x;
     m_drag_start_y = m_offset_y;
+    m_drag_press_x = x;
+    m_drag_press_y = y;
+
+    // With the reachable area shown, dragging the source moves it.
+    m_dragging_src = false;
+
+    if (m_graph && m_src_vertex && !m_reachable_budgets.empty())
+    {
+        auto pressed = m_graph->find_vertex_with_coords(
+            (x / m_scale_factor) - m_offset_x,
+            (y / m_scale_factor) - m_offset_y,
+            VERTEX_PIXEL_RADIUS);
+
+        m_dragging_src = pressed && *pressed == *m_src_vertex;
+    }
 }
 
 
 void GraphDrawingArea::on_drag_update(double offset_x, double offset_y)
 {
+    if (m_dragging_src)
+    {
+        auto hovered = m_graph->find_vertex_with_coords(
+            ((m_drag_press_x + offset_x) / m_scale_factor) - m_offset_x,
+            ((m_drag_press_y + offset_y) / m_scale_factor) - m_offset_y,
+            VERTEX_PIXEL_RADIUS);
+
+        if (hovered && *hovered != *m_src_vertex)
+        {
+            set_src_vertex(*hovered);
+            queue_draw();
+        }
+
+        return;
+    }
+
     m_offset_x = m_drag_start_x + offset_x;
     m_offset_y = m_drag_start_y + offset_y;
     queue_draw();
 }
 
 
+void GraphDrawingArea::on_drag_end(double offset_x, double offset_y)
+{
+    m_dragging_src = false;
+}
+
+
 static inline double
 distance(const Graph::VertexCoords& a, const Graph::VertexCoords& b)
 {
@@ -70,6 +111,53 @@ distance(const Graph::VertexCoords& a, const Graph::VertexCoords& b)
 }
 
 
+/* Finds the point at `fraction` of the length of an edge, following its
+ * geometry from `src` to `tgt`. Also returns the angle of the segment where
+ * the point lies, for drawing arrows. */
+static std::pair<Graph::VertexCoords, double>
+point_along(const Graph::VertexCoords& src,
+            const std::vector<Graph::VertexCoords>& geometry,
+            const Graph::VertexCoords& tgt,
+            double fraction)
+{
+    const std::size_t num_points = geometry.size() + 2;
+
+    auto at = [&] (std::size_t i) -> const Graph::VertexCoords& {
+        if (i == 0)
+            return src;
+
+        return i <= geometry.size() ? geometry[i - 1] : tgt;
+    };
+
+    double length = 0.0;
+    for (std::size_t i = 1; i < num_points; ++i)
+        length += distance(at(i - 1), at(i));
+
+    double remaining = length * fraction;
+
+    for (std::size_t i = 1; i < num_points; ++i)
+    {
+        const auto& a = at(i - 1);
+        const auto& b = at(i);
+        double segment = distance(a, b);
+
+        if (remaining <= segment || i == num_points - 1)
+        {
+            double t = segment > 0.0 ? remaining / segment : 0.0;
+
+            return {
+                { a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t },
+                std::atan2(b.y - a.y, b.x - a.x)
+            };
+        }
+
+        remaining -= segment;
+    }
+
+    return { src, 0.0 };
+}
+
+
 void GraphDrawingArea::on_click(
     int n_press, double x, double y, Glib::RefPtr<Gtk::GestureClick>& click)
 {
@@ -96,7 +184,7 @@ void GraphDrawingArea::on_click(
     {
         Graph::EdgeProperties newedge;
 
-        newedge.name = "";
+        newedge.name = Graph::NO_NAME;
         newedge.oneway = false;
         newedge.weight = distance(
             m_graph->get_vertex_coords(*m_src_vertex),
@@ -111,6 +199,7 @@ void GraphDrawingArea::on_click(
             m_graph->add_edge(*selected, *m_src_vertex, newedge);
 
         set_tgt_vertex(*selected);
+        update_reachable();
     }
 
     else if (m_editable && !selected && pressed == GDK_BUTTON_PRIMARY)
@@ -148,14 +237,18 @@ bool GraphDrawingArea::on_key_pressed(guint keyval, guint keycode,
     {
         m_graph->remove_vertex(*m_src_vertex);
 
-        // removing a vertex from Graph may cause other indices to shift.
-        // This would invalidate all the references GraphDrawingArea has
-        // for particular vertices on the graph.
+        // The other vertices keep their descriptors, so only what
+        // depended on the source goes away. The target stays selected.
+        if (m_tgt_vertex == m_src_vertex)
+            m_tgt_vertex = {};
 
         m_src_vertex = {};
-        m_tgt_vertex = {};
         m_path_distance = {};
         m_path.clear();
+        m_reachable.clear();
+
+        if (m_graph->fragmented())
+            compact_graph();
 
         m_signal_changed_selection.emit();
 
@@ -174,7 +267,9 @@ void GraphDrawingArea::set_graph(std::unique_ptr<Graph> graph)
     m_tgt_vertex = {};
     m_path_distance = {};
     m_path_processing_time = {};
+    m_path_settled = {};
     m_path.clear();
+    m_reachable.clear();
 
     m_graph = std::move(graph);
 
@@ -190,6 +285,27 @@ bool GraphDrawingArea::has_graph() const
 }
 
 
+void GraphDrawingArea::modify_graph(const std::function<void(Graph&)>& edit)
+{
+    if (!m_graph)
+        return;
+
+    // Same as removing a vertex by hand: no descriptor held here
+    // survives the edit.
+    m_src_vertex = {};
+    m_tgt_vertex = {};
+    m_path_distance = {};
+    m_path.clear();
+    m_reachable.clear();
+
+    edit(*m_graph);
+
+    m_signal_changed_selection.emit();
+
+    queue_draw();
+}
+
+
 void GraphDrawingArea::save_to(const std::string& filename, int width, int height)
 {
     if (!m_graph)
@@ -200,10 +316,7 @@ void GraphDrawingArea::save_to(const std::string& filename, int width, int heigh
     double maxX = std::numeric_limits<double>::min();
     double maxY = std::numeric_limits<double>::min();
 
-    for (auto [vi, vend] = m_graph->iter_vertices(); vi != vend; ++vi)
-    {
-        auto point = m_graph->get_vertex_coords(*vi);
-
+    auto include_point = [&] (const Graph::VertexCoords& point) {
         if (point.x < minX)
             minX = point.x;
         if (point.x > maxX)
@@ -212,6 +325,19 @@ void GraphDrawingArea::save_to(const std::string& filename, int width, int heigh
             minY = point.y;
         if (point.y > maxY)
             maxY = point.y;
+    };
+
+    for (auto [vi, vend] = m_graph->iter_vertices(); vi != vend; ++vi)
+    {
+        if (!m_graph->is_removed(*vi))
+            include_point(m_graph->get_vertex_coords(*vi));
+    }
+
+    // The shape of an edge may go beyond its vertices.
+    for (auto [ei, eend] = m_graph->iter_edges(); ei != eend; ++ei)
+    {
+        for (const auto& point: m_graph->get_edge_properties(*ei).geometry)
+            include_point(point);
     }
 
     double max_dist = std::max(std::abs(maxX - minX), std::abs(maxY - minY));
@@ -246,8 +372,11 @@ void GraphDrawingArea::set_src_vertex(const Graph::VertexT& vertex)
     m_tgt_vertex = {};
     m_path_distance = {};
     m_path_processing_time = {};
+    m_path_settled = {};
     m_src_vertex = vertex;
 
+    update_reachable();
+
     m_signal_changed_selection.emit();
 }
 
@@ -272,14 +401,17 @@ void GraphDrawingArea::set_tgt_vertex(const Graph::VertexT& vertex)
 {
     auto start_time = std::chrono::steady_clock::now();
 
+    Graph::PathStats stats;
+
     m_path.clear();
     m_tgt_vertex = vertex;
-    m_path_distance =
-        m_graph->plot_path(*m_src_vertex, *m_tgt_vertex, m_path);
+    m_path_distance = m_graph->plot_path(*m_src_vertex, *m_tgt_vertex, m_path,
+                                         m_path_algorithm, &stats);
 
     std::chrono::duration<double> elapsed =
         std::chrono::steady_clock::now() - start_time;
     m_path_processing_time = elapsed.count();
+    m_path_settled = stats.settled;
 
     m_signal_changed_selection.emit();
 }
@@ -301,9 +433,118 @@ bool GraphDrawingArea::set_tgt_vertex_id(std::size_t id)
 }
 
 
+void GraphDrawingArea::update_reachable()
+{
+    if (m_graph && m_src_vertex && !m_reachable_budgets.empty())
+        m_graph->reachable(*m_src_vertex, m_reachable_budgets, m_reachable);
+    else
+        m_reachable.clear();
+}
+
+
 void GraphDrawingArea::set_editable(bool state)
 {
     m_editable = state;
+
+    // What is built from the graph after the edits should not carry the
+    // slots of removed vertices.
+    if (!m_editable && m_graph)
+        compact_graph();
+}
+
+
+void GraphDrawingArea::compact_graph()
+{
+    auto new_index{ m_graph->compact() };
+
+    if (new_index.empty())
+        return;
+
+    // Selected vertices are never removed ones, only renumbered.
+    if (m_src_vertex)
+        m_src_vertex = new_index[*m_src_vertex];
+
+    if (m_tgt_vertex)
+        m_tgt_vertex = new_index[*m_tgt_vertex];
+
+    for (auto& vertex: m_path)
+        vertex = new_index[vertex];
+
+    // Edge descriptors do not survive the compaction.
+    m_reachable.clear();
+    update_reachable();
+}
+
+
+void GraphDrawingArea::set_path_algorithm(Graph::PathAlgorithm algorithm)
+{
+    m_path_algorithm = algorithm;
+
+    if (m_src_vertex && m_tgt_vertex)
+    {
+        set_tgt_vertex(*m_tgt_vertex);
+        queue_draw();
+    }
+}
+
+
+std::shared_ptr<const CsrGraph> GraphDrawingArea::get_frozen_graph() const
+{
+    if (!m_graph)
+        return nullptr;
+
+    return m_graph->frozen();
+}
+
+
+bool GraphDrawingArea::has_hierarchy() const
+{
+    return m_graph && m_graph->hierarchy();
+}
+
+
+void GraphDrawingArea::set_hierarchy(std::shared_ptr<const ContractionHierarchy> hierarchy)
+{
+    if (!m_graph || !m_graph->set_hierarchy(std::move(hierarchy)))
+        return;
+
+    // Until now, the search fell back to the bidirectional Dijkstra.
+    if (m_path_algorithm == Graph::PathAlgorithm::hierarchy
+        && m_src_vertex && m_tgt_vertex)
+    {
+        set_tgt_vertex(*m_tgt_vertex);
+        queue_draw();
+    }
+}
+
+
+void GraphDrawingArea::set_landmarks(std::shared_ptr<const Landmarks> landmarks)
+{
+    if (!m_graph || !m_graph->set_landmarks(std::move(landmarks)))
+        return;
+
+    // Until now, the search fell back to A* (or to stale landmarks).
+    if (m_path_algorithm == Graph::PathAlgorithm::landmarks
+        && m_src_vertex && m_tgt_vertex)
+    {
+        set_tgt_vertex(*m_tgt_vertex);
+        queue_draw();
+    }
+}
+
+
+void GraphDrawingArea::set_reachable_budgets(std::vector<double> budgets)
+{
+    m_reachable_budgets = std::move(budgets);
+    update_reachable();
+    queue_draw();
+}
+
+
+void GraphDrawingArea::set_street_prefix(std::string prefix)
+{
+    m_street_prefix = std::move(prefix);
+    queue_draw();
 }
 
 
@@ -342,7 +583,7 @@ std::optional<std::size_t> GraphDrawingArea::get_tgt_vertex_id() const
 std::optional<std::size_t> GraphDrawingArea::get_num_vertices() const
 {
     if (m_graph)
-        return m_graph->num_vertices();
+        return m_graph->num_vertices() - m_graph->num_removed();
     else
         return {};
 }
@@ -369,6 +610,12 @@ std::optional<double> GraphDrawingArea::get_elapsed_time() const
 }
 
 
+std::optional<std::size_t> GraphDrawingArea::get_num_settled() const
+{
+    return m_path_settled;
+}
+
+
 GraphDrawingArea::SignalChangedSelection
 GraphDrawingArea::signal_changed_selection()
 {
@@ -401,22 +648,24 @@ void GraphDrawingArea::on_draw(const Cairo::RefPtr<Cairo::Context>& cr,
         auto src_coords = m_graph->get_vertex_coords(source);
         auto tgt_coords = m_graph->get_vertex_coords(target);
 
+        const auto& geometry = m_graph->get_edge_properties(*vi).geometry;
+
         cr->move_to(src_coords.x, src_coords.y);
+
+        for (const auto& point: geometry)
+            cr->line_to(point.x, point.y);
+
         cr->line_to(tgt_coords.x, tgt_coords.y);
 
         cr->stroke();
 
         if (m_view_arrows)
         {
-            auto dx = tgt_coords.x - src_coords.x;
-            auto dy = tgt_coords.y - src_coords.y;
-
-            auto center_x = src_coords.x + dx * 0.7;
-            auto center_y = src_coords.y + dy * 0.7;
+            auto [center, angle] = point_along(src_coords, geometry, tgt_coords, 0.7);
 
             cr->save();
-            cr->translate(center_x, center_y);
-            cr->rotate(std::atan2(dy, dx));
+            cr->translate(center.x, center.y);
+            cr->rotate(angle);
             cr->move_to(0, 0);
             cr->line_to(-ARROW_PIXEL_LEN, -ARROW_PIXEL_LEN/2.0);
             cr->line_to(-ARROW_PIXEL_LEN, ARROW_PIXEL_LEN/2.0);
@@ -427,8 +676,9 @@ void GraphDrawingArea::on_draw(const Cairo::RefPtr<Cairo::Context>& cr,
 
         if (m_view_weights)
         {
-            auto center_x = (tgt_coords.x + src_coords.x) / 2.0;
-            auto center_y = (tgt_coords.y + src_coords.y) / 2.0;
+            auto center = point_along(src_coords, geometry, tgt_coords, 0.5).first;
+            auto center_x = center.x;
+            auto center_y = center.y;
 
             auto message{ std::format("{:.0f}", m_graph->get_edge_weight(*vi)) };
 
@@ -447,12 +697,81 @@ void GraphDrawingArea::on_draw(const Cairo::RefPtr<Cairo::Context>& cr,
 
     for (auto [vi, vend] = m_graph->iter_vertices(); vi != vend; ++vi)
     {
+        if (m_graph->is_removed(*vi))
+            continue;
+
         auto point = m_graph->get_vertex_coords(*vi);
         cr->arc(point.x, point.y, VERTEX_PIXEL_RADIUS, 0.0, 2 * M_PI);
 
         cr->fill();
     }
 
+    // The streets searched by name, in blue. The index is kept by the
+    // graph until the next edit, so this costs a lookup per frame.
+    if (!m_street_prefix.empty())
+    {
+        auto names{ m_graph->name_index() };
+
+        cr->save();
+        cr->set_line_width(3.0);
+        cr->set_source_rgb(0.1, 0.4, 0.9);
+
+        for (const auto& edge: names->edges_with_prefix(m_street_prefix))
+        {
+            auto src_coords = m_graph->get_vertex_coords(m_graph->get_edge_src(edge));
+            auto tgt_coords = m_graph->get_vertex_coords(m_graph->get_edge_tgt(edge));
+
+            cr->move_to(src_coords.x, src_coords.y);
+
+            for (const auto& point: m_graph->get_edge_properties(edge).geometry)
+                cr->line_to(point.x, point.y);
+
+            cr->line_to(tgt_coords.x, tgt_coords.y);
+            cr->stroke();
+        }
+
+        cr->restore();
+    }
+
+    // The reachable area, from green (nearest band) to orange (farthest).
+    auto set_band_color = [&] (std::size_t band) {
+        double t = m_reachable.budgets.size() > 1
+            ? static_cast<double>(band) / (m_reachable.budgets.size() - 1)
+            : 0.0;
+
+        cr->set_source_rgb(0.1 + 0.8 * t, 0.6 - 0.2 * t, 0.1);
+    };
+
+    cr->save();
+    cr->set_line_width(3.0);
+
+    for (std::size_t i = 0; i < m_reachable.edges.size(); ++i)
+    {
+        const auto& edge = m_reachable.edges[i];
+        auto src_coords = m_graph->get_vertex_coords(m_graph->get_edge_src(edge));
+        auto tgt_coords = m_graph->get_vertex_coords(m_graph->get_edge_tgt(edge));
+
+        set_band_color(m_reachable.edge_bands[i]);
+        cr->move_to(src_coords.x, src_coords.y);
+
+        for (const auto& point: m_graph->get_edge_properties(edge).geometry)
+            cr->line_to(point.x, point.y);
+
+        cr->line_to(tgt_coords.x, tgt_coords.y);
+        cr->stroke();
+    }
+
+    cr->restore();
+
+    for (std::size_t i = 0; i < m_reachable.vertices.size(); ++i)
+    {
+        auto point = m_graph->get_vertex_coords(m_reachable.vertices[i]);
+
+        set_band_color(m_reachable.vertex_bands[i]);
+        cr->arc(point.x, point.y, VERTEX_PIXEL_RADIUS, 0.0, 2 * M_PI);
+        cr->fill();
+    }
+
     cr->set_source_rgb(0.8, 0.0, 0.0);
 
     if (m_src_vertex)
@@ -467,9 +786,25 @@ void GraphDrawingArea::on_draw(const Cairo::RefPtr<Cairo::Context>& cr,
         auto point = m_graph->get_vertex_coords(*m_tgt_vertex);
         cr->move_to(point.x, point.y);
 
-        for (const auto& vd: m_path)
+        for (std::size_t i = 0; i < m_path.size(); ++i)
         {
-            auto point = m_graph->get_vertex_coords(vd);
+            auto point = m_graph->get_vertex_coords(m_path[i]);
+
+            // The path is stored from the target back to the source, so
+            // the edge taken goes from m_path[i] to m_path[i - 1], and its
+            // shape is drawn backwards.
+            if (i > 0)
+            {
+                auto edge = m_graph->find_edge(m_path[i], m_path[i - 1]);
+
+                if (edge)
+                {
+                    const auto& geometry = m_graph->get_edge_properties(*edge).geometry;
+
+                    for (auto it = geometry.rbegin(); it != geometry.rend(); ++it)
+                        cr->line_to(it->x, it->y);
+                }
+            }
 
             cr->line_to(point.x, point.y);
             cr->stroke();
@@ -0,0 +1,213 @@
+#include "graph_loader.h"
+
+#include "graph_snapshot.h"
+#include "mapped_file.h"
+
+#include <glibmm/miscutils.h>
+
+#include <cstdint>
+#include <utility>          // for move()
+
+
+namespace
+{
+    // Files from this size on are read in two passes.
+    constexpr std::uint64_t TWO_PASS_MIN_SIZE = 64 * 1024 * 1024;
+}
+
+
+GraphLoader::GraphLoader()
+{
+    m_progress_dispatcher.connect(sigc::mem_fun(*this, &GraphLoader::on_progress));
+    m_finished_dispatcher.connect(sigc::mem_fun(*this, &GraphLoader::on_finished));
+}
+
+
+GraphLoader::~GraphLoader()
+{
+    m_cancel = true;
+
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+
+void GraphLoader::start(const std::string& filename, bool simplify,
+                        osm_parser::Profile profile)
+{
+    if (m_thread.joinable())
+        m_thread.join();
+
+    m_cancel = false;
+    m_running = true;
+
+    {
+        std::lock_guard lock{ m_mutex };
+        m_progress = {};
+        m_progress_pending = false;
+        m_result = nullptr;
+        m_way_table = {};
+        m_error = nullptr;
+    }
+
+    m_thread = std::thread(&GraphLoader::run, this, filename, simplify, profile);
+}
+
+
+void GraphLoader::cancel()
+{
+    m_cancel = true;
+}
+
+
+bool GraphLoader::is_running() const
+{
+    return m_running;
+}
+
+
+std::unique_ptr<Graph> GraphLoader::take_result()
+{
+    std::lock_guard lock{ m_mutex };
+
+    if (m_error)
+        std::rethrow_exception(std::exchange(m_error, nullptr));
+
+    return std::move(m_result);
+}
+
+
+osm_parser::WayTable GraphLoader::take_way_table()
+{
+    std::lock_guard lock{ m_mutex };
+
+    return std::exchange(m_way_table, {});
+}
+
+
+GraphLoader::SignalProgress GraphLoader::signal_progress()
+{
+    return m_signal_progress;
+}
+
+
+GraphLoader::SignalFinished GraphLoader::signal_finished()
+{
+    return m_signal_finished;
+}
+
+
+/* Loads the graph from its snapshot in the user cache, if there is an
+ * up to date one. Otherwise, parses the file and leaves a snapshot
+ * behind for the next time. */
+void GraphLoader::run(std::string filename, bool simplify,
+                      osm_parser::Profile profile)
+{
+    try
+    {
+        graph_snapshot::SourceKey key;
+
+        try
+        {
+            key = graph_snapshot::make_key(filename);
+        }
+        catch (const MappedFile::Error& err)
+        {
+            throw osm_parser::ParserError(err.what());
+        }
+
+        // Each way of reading the file makes a different graph, and
+        // gets a snapshot of its own.
+        std::string variant;
+
+        if (profile != osm_parser::Profile::any_highway)
+            variant.append(osm_parser::profile_name(profile));
+
+        if (simplify)
+            variant.append(variant.empty() ? "" : ",").append("simplified");
+
+        auto snapshot = graph_snapshot::cache_path(
+            Glib::get_user_cache_dir(), filename, variant);
+
+        // The ways are kept for change files, which only apply to graphs
+        // that were not simplified.
+        osm_parser::WayTable ways;
+        auto* table = simplify ? nullptr : &ways;
+
+        auto g{ graph_snapshot::load(snapshot, key, table) };
+
+        if (!g)
+        {
+            osm_parser::Options options;
+
+            // Large extracts are mostly made of nodes that don't belong to any
+            // road. Reading them in two passes keeps those out of memory.
+            options.two_pass = key.size >= TWO_PASS_MIN_SIZE;
+            options.simplify = simplify;
+            options.profile = profile;
+            options.cancel = &m_cancel;
+            options.way_table = table;
+
+            // Only the latest progress matters; the dispatcher is only
+            // poked when the main loop has caught up with the previous one.
+            options.progress = [this] (const osm_parser::Progress& progress) {
+                bool notify;
+
+                {
+                    std::lock_guard lock{ m_mutex };
+                    m_progress = progress;
+                    notify = !m_progress_pending;
+                    m_progress_pending = true;
+                }
+
+                if (notify)
+                    m_progress_dispatcher.emit();
+            };
+
+            g = osm_parser::parse(filename, options);
+
+            // The cache is only an optimization, failing to write it is fine.
+            graph_snapshot::save(*g, snapshot, key, table);
+        }
+
+        std::lock_guard lock{ m_mutex };
+        m_result = std::move(g);
+        m_way_table = std::move(ways);
+    }
+    catch (...)
+    {
+        std::lock_guard lock{ m_mutex };
+        m_error = std::current_exception();
+    }
+
+    m_finished_dispatcher.emit();
+}
+
+
+void GraphLoader::on_progress()
+{
+    osm_parser::Progress progress;
+
+    {
+        std::lock_guard lock{ m_mutex };
+
+        if (!m_progress_pending)
+            return;
+
+        progress = m_progress;
+        m_progress_pending = false;
+    }
+
+    m_signal_progress.emit(progress);
+}
+
+
+void GraphLoader::on_finished()
+{
+    if (m_thread.joinable())
+        m_thread.join();
+
+    m_running = false;
+
+    m_signal_finished.emit();
+}
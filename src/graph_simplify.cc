@@ -0,0 +1,193 @@
+#include "graph_simplify.h"
+
+#include <vector>
+
+
+using VertexT = Graph::VertexT;
+using EdgeT = Graph::EdgeT;
+using Edge = Graph::EdgeProperties;
+
+
+namespace
+{
+    /* The graph is directedS, so in-edges aren't stored. A pass-through
+     * vertex has at most two of them, which is all we keep. */
+    struct InEdges
+    {
+        unsigned count{ 0 };
+        EdgeT first[2];
+    };
+
+    /* A chain of edges, ready to be added to the new graph. */
+    struct Chain
+    {
+        VertexT src;
+        VertexT tgt;
+        Edge edge;
+    };
+
+    // Edges of different ways are never merged, even if they meet
+    // end to end.
+    bool same_way(const Edge& a, const Edge& b)
+    {
+        return a.name == b.name && a.oneway == b.oneway;
+    }
+
+    bool is_pass_through(const Graph& graph, VertexT v, const InEdges& in)
+    {
+        std::size_t out = graph.out_degree(v);
+
+        if (in.count == 1 && out == 1)
+        {
+            EdgeT in_edge = in.first[0];
+            EdgeT out_edge = *graph.iter_out_edges(v).first;
+
+            VertexT from = graph.get_edge_src(in_edge);
+            VertexT to = graph.get_edge_tgt(out_edge);
+
+            const auto& in_props = graph.get_edge_properties(in_edge);
+            const auto& out_props = graph.get_edge_properties(out_edge);
+
+            // When from == to, v is the dead end of a two-way road.
+            return from != to && from != v && to != v
+                && in_props.oneway
+                && same_way(in_props, out_props);
+        }
+
+        if (in.count == 2 && out == 2)
+        {
+            auto [ei, eend] = graph.iter_out_edges(v);
+            EdgeT out_a = *ei++;
+            EdgeT out_b = *ei;
+
+            VertexT a = graph.get_edge_tgt(out_a);
+            VertexT b = graph.get_edge_tgt(out_b);
+            VertexT c = graph.get_edge_src(in.first[0]);
+            VertexT d = graph.get_edge_src(in.first[1]);
+
+            if (a == b || a == v || b == v)
+                return false;
+
+            if (!((a == c && b == d) || (a == d && b == c)))
+                return false;
+
+            const auto& props = graph.get_edge_properties(out_a);
+
+            return !props.oneway
+                && same_way(props, graph.get_edge_properties(out_b))
+                && same_way(props, graph.get_edge_properties(in.first[0]))
+                && same_way(props, graph.get_edge_properties(in.first[1]));
+        }
+
+        return false;
+    }
+}
+
+
+std::unique_ptr<Graph> graph_simplify::contract_chains(const Graph& graph)
+{
+    const std::size_t n = graph.num_vertices();
+
+    std::vector<InEdges> in_edges(n);
+
+    for (auto [ei, eend] = graph.iter_edges(); ei != eend; ++ei)
+    {
+        auto& in = in_edges[graph.get_edge_tgt(*ei)];
+
+        if (in.count < 2)
+            in.first[in.count] = *ei;
+
+        ++in.count;
+    }
+
+    std::vector<bool> pass_through(n);
+
+    for (VertexT v = 0; v < n; ++v)
+        pass_through[v] = is_pass_through(graph, v, in_edges[v]);
+
+    in_edges = {};
+
+    std::vector<bool> visited(n);
+    std::vector<Chain> chains;
+
+    // Follows `first` through pass-through vertices until a kept one.
+    auto walk = [&] (VertexT start, EdgeT first) {
+        Chain chain{ start, graph.get_edge_tgt(first), graph.get_edge_properties(first) };
+        VertexT prev = start;
+
+        while (pass_through[chain.tgt])
+        {
+            VertexT cur = chain.tgt;
+            visited[cur] = true;
+
+            chain.edge.geometry.push_back(graph.get_vertex_coords(cur));
+
+            // Take the way forward: the only edge of a one-way road, or
+            // the one that doesn't go back where we came from.
+            auto [ei, eend] = graph.iter_out_edges(cur);
+            EdgeT next = *ei;
+
+            for (; ei != eend; ++ei)
+            {
+                if (graph.get_edge_tgt(*ei) != prev)
+                {
+                    next = *ei;
+                    break;
+                }
+            }
+
+            // Edges may already have a shape, if the graph was simplified before.
+            const auto& props = graph.get_edge_properties(next);
+            chain.edge.geometry.insert(chain.edge.geometry.end(),
+                                       props.geometry.begin(), props.geometry.end());
+
+            chain.edge.weight += props.weight;
+            chain.tgt = graph.get_edge_tgt(next);
+            prev = cur;
+        }
+
+        chains.push_back(std::move(chain));
+    };
+
+    for (VertexT v = 0; v < n; ++v)
+    {
+        if (pass_through[v])
+            continue;
+
+        for (auto [ei, eend] = graph.iter_out_edges(v); ei != eend; ++ei)
+            walk(v, *ei);
+    }
+
+    // Anything left is a loop with no junction on it, such as a lone
+    // roundabout. One vertex of each loop is kept.
+    for (VertexT v = 0; v < n; ++v)
+    {
+        if (!pass_through[v] || visited[v])
+            continue;
+
+        pass_through[v] = false;
+
+        for (auto [ei, eend] = graph.iter_out_edges(v); ei != eend; ++ei)
+            walk(v, *ei);
+    }
+
+    auto simplified{ Graph::create() };
+
+    const VertexT NO_VERTEX = static_cast<VertexT>(-1);
+    std::vector<VertexT> new_vd(n, NO_VERTEX);
+
+    for (VertexT v = 0; v < n; ++v)
+    {
+        if (!pass_through[v])
+            new_vd[v] = simplified->add_vertex(graph.get_vertex_properties(v));
+    }
+
+    // Name ids belong to the graph that made them.
+    for (auto& chain: chains)
+    {
+        chain.edge.name = simplified->intern_name(graph.get_name(chain.edge.name));
+        simplified->add_edge(new_vd[chain.src], new_vd[chain.tgt], chain.edge);
+    }
+
+    return simplified;
+}
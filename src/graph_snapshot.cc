@@ -0,0 +1,561 @@
+#include "graph_snapshot.h"
+
+#include "mapped_file.h"
+#include "routing_profile.h"
+
+#include <bit>              // for rotl()
+#include <cstdio>           // for snprintf()
+#include <cstring>          // for memcpy()
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+#include <utility>          // for move()
+#include <vector>
+
+
+namespace fs = std::filesystem;
+
+using graph_snapshot::SourceKey;
+using osm_parser::WayTable;
+
+
+/* Snapshot layout.
+ *
+ * All values are written in the native byte order; snapshots are a local
+ * cache and never leave the machine that wrote them. The ENDIANNESS field
+ * makes a snapshot from another machine be rejected instead of misread.
+ *
+ *     Header
+ *     VertexRecord[num_vertices]       in descriptor order
+ *     EdgeRecord[num_edges]            in Graph::iter_edges() order
+ *     PointRecord[num_points]          edge geometries, in edge order
+ *     WayRecord[num_ways]              the way table, if saved
+ *     uint64_t[num_way_nodes]          node ids of the ways, in way order
+ *     TableNodeRecord[num_table_nodes] nodes of the ways that aren't vertices
+ *     NameRecord[num_names]            the graph's name table, in id order
+ *     char[names_size]                 the names, one after the other
+ *
+ * Every section size is a multiple of 8 bytes, except the last one.
+ */
+namespace
+{
+    constexpr char MAGIC[8] = { 'G', 'X', 'S', 'N', 'A', 'P', '\0', '\0' };
+    constexpr std::uint32_t VERSION = 4;
+    constexpr std::uint32_t ENDIANNESS = 0x01020304;
+
+    struct Header
+    {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t endianness;
+        std::uint64_t source_size;
+        std::int64_t source_mtime;
+        std::uint64_t source_hash;
+        std::uint64_t num_vertices;
+        std::uint64_t num_edges;
+        std::uint64_t num_points;
+        std::uint64_t num_names;
+        std::uint64_t names_size;
+        std::uint32_t has_ways;     // Whether a way table was saved.
+        std::uint32_t profile;
+        double minlat, maxlat, minlon, maxlon;
+        std::uint64_t num_ways;
+        std::uint64_t num_way_nodes;
+        std::uint64_t num_table_nodes;
+    };
+
+    struct VertexRecord
+    {
+        std::uint64_t id;
+        double x;
+        double y;
+    };
+
+    struct EdgeRecord
+    {
+        std::uint32_t src;
+        std::uint32_t tgt;
+        double weight;
+        std::uint32_t name;
+        std::uint32_t oneway;
+        std::uint32_t num_points;   // Taken from the geometry section.
+        std::uint32_t reserved;
+    };
+
+    struct PointRecord
+    {
+        double x;
+        double y;
+    };
+
+    struct WayRecord
+    {
+        std::uint64_t id;
+        std::uint32_t num_nodes;    // Taken from the way node section.
+        std::uint32_t name;
+        std::uint32_t oneway;
+        std::uint32_t reserved;
+    };
+
+    struct TableNodeRecord
+    {
+        std::uint64_t id;
+        double x;
+        double y;
+        std::uint32_t missing;
+        std::uint32_t reserved;
+    };
+
+    struct NameRecord
+    {
+        std::uint32_t offset;
+        std::uint32_t size;
+    };
+
+    /* Reads records of type T out of the mapped snapshot. */
+    class SectionReader
+    {
+    public:
+        explicit SectionReader(std::string_view data)
+            : m_data(data) {}
+
+        template<typename T>
+        bool read(T& record)
+        {
+            if (sizeof(T) > m_data.size() - m_pos)
+                return false;
+
+            // The mapping is page aligned, but memcpy keeps this correct
+            // regardless of layout, and compiles to a plain load.
+            std::memcpy(&record, m_data.data() + m_pos, sizeof(T));
+            m_pos += sizeof(T);
+
+            return true;
+        }
+
+        std::string_view take(std::size_t size)
+        {
+            if (size > m_data.size() - m_pos)
+                return {};
+
+            auto view = m_data.substr(m_pos, size);
+            m_pos += size;
+
+            return view;
+        }
+
+    private:
+        std::string_view m_data;
+        std::size_t m_pos{ 0 };
+    };
+
+    /* A fast, non-cryptographic 64 bit hash. Four independent lanes keep the
+     * CPU busy, so this runs at about memory speed. */
+    std::uint64_t hash_bytes(std::string_view data)
+    {
+        constexpr std::uint64_t PRIME_1 = 0x9E3779B97F4A7C15ULL;
+        constexpr std::uint64_t PRIME_2 = 0xBF58476D1CE4E5B9ULL;
+
+        std::uint64_t lanes[4] = { PRIME_1, PRIME_2, ~PRIME_1, ~PRIME_2 };
+
+        auto mix = [] (std::uint64_t lane, std::uint64_t word) {
+            return std::rotl(lane ^ (word * PRIME_1), 31) * PRIME_2;
+        };
+
+        const char* p = data.data();
+        std::size_t remaining = data.size();
+
+        while (remaining >= 32)
+        {
+            for (auto& lane: lanes)
+            {
+                std::uint64_t word;
+                std::memcpy(&word, p, 8);
+                lane = mix(lane, word);
+                p += 8;
+            }
+
+            remaining -= 32;
+        }
+
+        std::uint64_t h = data.size();
+
+        for (auto lane: lanes)
+            h = mix(h, lane);
+
+        while (remaining > 0)
+        {
+            std::uint64_t word = 0;
+            std::size_t count = remaining < 8 ? remaining : 8;
+            std::memcpy(&word, p, count);
+            h = mix(h, word);
+            p += count;
+            remaining -= count;
+        }
+
+        return h ^ (h >> 29);
+    }
+}
+
+
+SourceKey graph_snapshot::make_key(const std::string& filename)
+{
+    MappedFile file{ filename };
+
+    return {
+        file.size(),
+        static_cast<std::int64_t>(
+            fs::last_write_time(filename).time_since_epoch().count()),
+        hash_bytes(file.data())
+    };
+}
+
+
+std::string graph_snapshot::cache_path(const std::string& cache_dir,
+                                       const std::string& filename,
+                                       const std::string& variant)
+{
+    std::error_code ec;
+    auto absolute = fs::absolute(filename, ec);
+    std::string source = ec ? filename : absolute.string();
+
+    // A path can't contain '\0', so no variant collides with another file.
+    if (!variant.empty())
+        source.append(1, '\0').append(variant);
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.gxs",
+                  static_cast<unsigned long long>(hash_bytes(source)));
+
+    return (fs::path(cache_dir) / "gexplorer" / name).string();
+}
+
+
+bool graph_snapshot::save(const Graph& graph, const std::string& path,
+                          const SourceKey& key, const WayTable* ways)
+{
+    std::vector<EdgeRecord> edges;
+    std::vector<PointRecord> points;
+    std::vector<WayRecord> way_records;
+    std::vector<std::uint64_t> way_nodes;
+    std::vector<TableNodeRecord> table_nodes;
+    std::vector<NameRecord> names;
+    std::string name_data;
+
+    // Edges refer to names by their id in the graph, so the name table
+    // is written as it is.
+    for (std::size_t id = 0; id < graph.num_names(); ++id)
+    {
+        const auto& name = graph.get_name(static_cast<Graph::NameID>(id));
+
+        names.push_back({ static_cast<std::uint32_t>(name_data.size()),
+                          static_cast<std::uint32_t>(name.size()) });
+        name_data.append(name);
+    }
+
+    for (auto [ei, eend] = graph.iter_edges(); ei != eend; ++ei)
+    {
+        const auto& props = graph.get_edge_properties(*ei);
+
+        edges.push_back({
+            static_cast<std::uint32_t>(graph.get_edge_src(*ei)),
+            static_cast<std::uint32_t>(graph.get_edge_tgt(*ei)),
+            props.weight,
+            props.name,
+            props.oneway ? 1u : 0u,
+            static_cast<std::uint32_t>(props.geometry.size()),
+            0
+        });
+
+        for (const auto& point: props.geometry)
+            points.push_back({ point.x, point.y });
+    }
+
+    bool has_ways = ways && ways->valid;
+
+    if (has_ways)
+    {
+        ways->ways.for_each([&] (std::size_t id, const WayTable::Way& way) {
+            way_records.push_back({
+                id,
+                static_cast<std::uint32_t>(way.nodes.size()),
+                way.name,
+                way.oneway ? 1u : 0u,
+                0
+            });
+
+            way_nodes.insert(way_nodes.end(), way.nodes.begin(), way.nodes.end());
+        });
+
+        ways->nodes.for_each([&] (std::size_t id, const WayTable::Node& node) {
+            table_nodes.push_back({
+                id,
+                node.coord.x,
+                node.coord.y,
+                node.missing ? 1u : 0u,
+                0
+            });
+        });
+    }
+
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.endianness = ENDIANNESS;
+    header.source_size = key.size;
+    header.source_mtime = key.mtime;
+    header.source_hash = key.hash;
+    header.num_vertices = graph.num_vertices();
+    header.num_edges = edges.size();
+    header.num_points = points.size();
+    header.num_names = names.size();
+    header.names_size = name_data.size();
+
+    if (has_ways)
+    {
+        header.has_ways = 1;
+        header.profile = static_cast<std::uint32_t>(ways->profile);
+        header.minlat = ways->bounds.minlat;
+        header.maxlat = ways->bounds.maxlat;
+        header.minlon = ways->bounds.minlon;
+        header.maxlon = ways->bounds.maxlon;
+        header.num_ways = way_records.size();
+        header.num_way_nodes = way_nodes.size();
+        header.num_table_nodes = table_nodes.size();
+    }
+
+    std::error_code ec;
+    fs::create_directories(fs::path(path).parent_path(), ec);
+
+    std::string tmp_path = path + ".tmp";
+    std::ofstream out{ tmp_path, std::ios::binary | std::ios::trunc };
+
+    if (!out)
+        return false;
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    for (auto [vi, vend] = graph.iter_vertices(); vi != vend; ++vi)
+    {
+        const auto& props = graph.get_vertex_properties(*vi);
+        VertexRecord record{ props.id, props.coord.x, props.coord.y };
+        out.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    }
+
+    out.write(reinterpret_cast<const char*>(edges.data()),
+              static_cast<std::streamsize>(edges.size() * sizeof(EdgeRecord)));
+    out.write(reinterpret_cast<const char*>(points.data()),
+              static_cast<std::streamsize>(points.size() * sizeof(PointRecord)));
+    out.write(reinterpret_cast<const char*>(way_records.data()),
+              static_cast<std::streamsize>(way_records.size() * sizeof(WayRecord)));
+    out.write(reinterpret_cast<const char*>(way_nodes.data()),
+              static_cast<std::streamsize>(way_nodes.size() * sizeof(std::uint64_t)));
+    out.write(reinterpret_cast<const char*>(table_nodes.data()),
+              static_cast<std::streamsize>(table_nodes.size() * sizeof(TableNodeRecord)));
+    out.write(reinterpret_cast<const char*>(names.data()),
+              static_cast<std::streamsize>(names.size() * sizeof(NameRecord)));
+    out.write(name_data.data(), static_cast<std::streamsize>(name_data.size()));
+    out.close();
+
+    if (!out)
+    {
+        fs::remove(tmp_path, ec);
+        return false;
+    }
+
+    fs::rename(tmp_path, path, ec);
+
+    return !ec;
+}
+
+
+std::unique_ptr<Graph> graph_snapshot::load(const std::string& path,
+                                            const SourceKey& key,
+                                            WayTable* ways)
+{
+    std::error_code ec;
+    if (!fs::exists(path, ec))
+        return nullptr;
+
+    MappedFile file;
+
+    try
+    {
+        file = MappedFile(path);
+    }
+    catch (const MappedFile::Error&)
+    {
+        return nullptr;
+    }
+
+    SectionReader reader{ file.data() };
+    Header header;
+
+    if (!reader.read(header) ||
+        std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        header.version != VERSION ||
+        header.endianness != ENDIANNESS ||
+        SourceKey{ header.source_size, header.source_mtime, header.source_hash } != key ||
+        (ways && (!header.has_ways || header.profile >= osm_parser::NUM_PROFILES)))
+    {
+        return nullptr;
+    }
+
+    // Check all sizes up front, so a truncated file is rejected before
+    // any allocation is made based on its contents. Each count is compared
+    // with what is left before it is multiplied, so that a corrupt count
+    // can't wrap the product around and pass.
+    std::uint64_t remaining = file.size() - sizeof(Header);
+
+    auto take_section = [&remaining] (std::uint64_t count, std::size_t size) {
+        if (count > remaining / size)
+            return false;
+
+        remaining -= count * size;
+        return true;
+    };
+
+    if (!take_section(header.num_vertices, sizeof(VertexRecord)) ||
+        !take_section(header.num_edges, sizeof(EdgeRecord)) ||
+        !take_section(header.num_points, sizeof(PointRecord)) ||
+        !take_section(header.num_ways, sizeof(WayRecord)) ||
+        !take_section(header.num_way_nodes, sizeof(std::uint64_t)) ||
+        !take_section(header.num_table_nodes, sizeof(TableNodeRecord)) ||
+        !take_section(header.num_names, sizeof(NameRecord)) ||
+        !take_section(header.names_size, 1) ||
+        remaining != 0)
+    {
+        return nullptr;
+    }
+
+    auto graph{ Graph::create() };
+
+    for (std::uint64_t i = 0; i < header.num_vertices; ++i)
+    {
+        VertexRecord record;
+        reader.read(record);
+        graph->add_vertex({ record.id, { record.x, record.y } });
+    }
+
+    SectionReader edge_reader{ reader.take(header.num_edges * sizeof(EdgeRecord)) };
+    SectionReader point_reader{ reader.take(header.num_points * sizeof(PointRecord)) };
+    std::uint64_t points_left = header.num_points;
+
+    SectionReader way_reader{ reader.take(header.num_ways * sizeof(WayRecord)) };
+    SectionReader way_node_reader{ reader.take(header.num_way_nodes * sizeof(std::uint64_t)) };
+    SectionReader table_node_reader{ reader.take(header.num_table_nodes * sizeof(TableNodeRecord)) };
+
+    std::vector<NameRecord> name_records(header.num_names);
+    for (auto& record: name_records)
+        reader.read(record);
+
+    std::string_view name_data = reader.take(header.names_size);
+
+    // Interning the names in order gives back the same ids, but they are
+    // mapped anyway, so that the edges never depend on it.
+    std::vector<Graph::NameID> name_ids;
+    name_ids.reserve(name_records.size());
+
+    for (const auto& name: name_records)
+    {
+        if (name.offset > name_data.size() ||
+            name.size > name_data.size() - name.offset)
+        {
+            return nullptr;
+        }
+
+        name_ids.push_back(graph->intern_name(name_data.substr(name.offset, name.size)));
+    }
+
+    Graph::EdgeProperties edge;
+
+    for (std::uint64_t i = 0; i < header.num_edges; ++i)
+    {
+        EdgeRecord record;
+        edge_reader.read(record);
+
+        if (record.src >= header.num_vertices ||
+            record.tgt >= header.num_vertices ||
+            record.name >= name_ids.size())
+        {
+            return nullptr;
+        }
+
+        if (record.num_points > points_left)
+            return nullptr;
+
+        points_left -= record.num_points;
+
+        edge.geometry.resize(record.num_points);
+        for (auto& point: edge.geometry)
+        {
+            PointRecord point_record;
+            point_reader.read(point_record);
+            point = { point_record.x, point_record.y };
+        }
+
+        edge.name = name_ids[record.name];
+        edge.weight = record.weight;
+        edge.oneway = record.oneway != 0;
+
+        graph->add_edge(record.src, record.tgt, edge);
+    }
+
+    if (!ways)
+        return graph;
+
+    WayTable table;
+    table.valid = true;
+    table.profile = static_cast<osm_parser::Profile>(header.profile);
+    table.bounds = { header.minlat, header.maxlat, header.minlon, header.maxlon };
+    table.ways.reserve(header.num_ways);
+
+    std::uint64_t way_nodes_left = header.num_way_nodes;
+
+    for (std::uint64_t i = 0; i < header.num_ways; ++i)
+    {
+        WayRecord record;
+        way_reader.read(record);
+
+        if (record.num_nodes > way_nodes_left ||
+            record.name >= name_ids.size() ||
+            record.id == IdIndex<WayTable::Way>::RESERVED_ID)
+        {
+            return nullptr;
+        }
+
+        way_nodes_left -= record.num_nodes;
+
+        WayTable::Way way;
+        way.nodes.resize(record.num_nodes);
+
+        for (auto& node: way.nodes)
+        {
+            std::uint64_t id = 0;
+            way_node_reader.read(id);
+            node = id;
+        }
+
+        way.name = name_ids[record.name];
+        way.oneway = record.oneway != 0;
+
+        table.ways.insert_or_assign(record.id, std::move(way));
+    }
+
+    table.nodes.reserve(header.num_table_nodes);
+
+    for (std::uint64_t i = 0; i < header.num_table_nodes; ++i)
+    {
+        TableNodeRecord record;
+        table_node_reader.read(record);
+
+        if (record.id == IdIndex<WayTable::Node>::RESERVED_ID)
+            return nullptr;
+
+        table.nodes.insert_or_assign(record.id, { { record.x, record.y }, record.missing != 0 });
+    }
+
+    *ways = std::move(table);
+
+    return graph;
+}
@@ -0,0 +1,165 @@
+#include "hierarchy_builder.h"
+
+#include <exception>
+#include <utility>          // for move()
+
+
+HierarchyBuilder::HierarchyBuilder()
+{
+    m_landmarks_dispatcher.connect(sigc::mem_fun(*this, &HierarchyBuilder::on_landmarks_ready));
+    m_finished_dispatcher.connect(sigc::mem_fun(*this, &HierarchyBuilder::on_finished));
+}
+
+
+HierarchyBuilder::~HierarchyBuilder()
+{
+    m_cancel = true;
+
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+
+void HierarchyBuilder::start(std::shared_ptr<const CsrGraph> graph)
+{
+    cancel();
+
+    m_cancel = false;
+    m_running = true;
+    m_graph = graph;
+
+    m_thread = std::thread(&HierarchyBuilder::run, this, std::move(graph), m_generation);
+}
+
+
+void HierarchyBuilder::cancel()
+{
+    m_cancel = true;
+
+    if (m_thread.joinable())
+        m_thread.join();
+
+    // The build may have finished and poked the dispatcher already.
+    // on_finished() drops results from earlier generations.
+    ++m_generation;
+    m_running = false;
+    m_graph.reset();
+}
+
+
+bool HierarchyBuilder::is_running() const
+{
+    return m_running;
+}
+
+
+std::shared_ptr<const ContractionHierarchy> HierarchyBuilder::take_result()
+{
+    std::lock_guard lock{ m_mutex };
+
+    if (m_result_generation != m_generation)
+        return nullptr;
+
+    return std::exchange(m_result, nullptr);
+}
+
+
+std::shared_ptr<const Landmarks> HierarchyBuilder::take_landmarks()
+{
+    std::lock_guard lock{ m_mutex };
+
+    if (m_landmarks_generation != m_generation)
+        return nullptr;
+
+    return std::exchange(m_landmarks, nullptr);
+}
+
+
+HierarchyBuilder::SignalFinished HierarchyBuilder::signal_landmarks_ready()
+{
+    return m_signal_landmarks_ready;
+}
+
+
+HierarchyBuilder::SignalFinished HierarchyBuilder::signal_finished()
+{
+    return m_signal_finished;
+}
+
+
+void HierarchyBuilder::run(std::shared_ptr<const CsrGraph> graph,
+                           std::size_t generation)
+{
+    std::shared_ptr<const Landmarks> landmarks;
+    std::shared_ptr<const ContractionHierarchy> hierarchy;
+
+    // Out of memory, most likely, if either throws. The graph is still
+    // usable without them.
+    try
+    {
+        landmarks = Landmarks::build(graph, Landmarks::DEFAULT_COUNT,
+                                     Landmarks::Selection::avoid, &m_cancel);
+    }
+    catch (const std::exception&)
+    {
+    }
+
+    if (m_cancel)
+        return;
+
+    {
+        std::lock_guard lock{ m_mutex };
+        m_landmarks = std::move(landmarks);
+        m_landmarks_generation = generation;
+    }
+
+    m_landmarks_dispatcher.emit();
+
+    try
+    {
+        hierarchy = ContractionHierarchy::build(std::move(graph), &m_cancel);
+    }
+    catch (const std::exception&)
+    {
+    }
+
+    {
+        std::lock_guard lock{ m_mutex };
+        m_result = std::move(hierarchy);
+        m_result_generation = generation;
+    }
+
+    m_finished_dispatcher.emit();
+}
+
+
+void HierarchyBuilder::on_landmarks_ready()
+{
+    {
+        std::lock_guard lock{ m_mutex };
+
+        if (!m_running || m_landmarks_generation != m_generation)
+            return;
+    }
+
+    m_signal_landmarks_ready.emit();
+}
+
+
+void HierarchyBuilder::on_finished()
+{
+    {
+        std::lock_guard lock{ m_mutex };
+
+        if (!m_running || m_result_generation != m_generation)
+            return;
+    }
+
+    if (m_thread.joinable())
+        m_thread.join();
+
+    m_running = false;
+    m_graph.reset();
+
+    m_signal_finished.emit();
+}
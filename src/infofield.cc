@@ -35,12 +35,17 @@ InfoField::InfoField(BaseObjectType* cobject,
     if (!m_elapsed)
         THROW_INVALID_ID("path-elapsed");
 
+    m_settled = builder->get_widget<Gtk::Label>("path-settled");
+    if (!m_settled)
+        THROW_INVALID_ID("path-settled");
+
     set_num();
     set_num_path();
     set_source();
     set_target();
     set_distance();
     set_elapsed_time();
+    set_settled();
 }
 
 
@@ -101,3 +106,12 @@ void InfoField::set_elapsed_time(std::optional<double> elapsed)
     else
         m_elapsed->set_label("-");
 }
+
+
+void InfoField::set_settled(std::optional<std::size_t> settled)
+{
+    if (settled)
+        m_settled->set_label(std::to_string(*settled));
+    else
+        m_settled->set_label("-");
+}
@@ -0,0 +1,408 @@
+#include "landmarks.h"
+
+#include "thread_pool.h"
+
+#include <algorithm>        // for max(), min(), partial_sort()
+#include <cmath>            // for isfinite()
+#include <functional>       // for greater<>
+#include <future>
+#include <limits>           // for numeric_limits<>
+#include <queue>            // for priority_queue
+#include <random>           // for mt19937
+#include <thread>           // for hardware_concurrency()
+#include <utility>          // for move(), pair
+
+
+using Index = Landmarks::Index;
+
+
+namespace
+{
+    constexpr double INFINITE = std::numeric_limits<double>::max();
+
+    /* A float keeps 24 bits of a distance. Bounds give up this fraction of
+     * the distances they are made of, which covers the rounding with room
+     * to spare and keeps them lower bounds. */
+    constexpr double ROUNDING = 1e-6;
+
+    /* Fixed, so that the same graph always gets the same landmarks. */
+    constexpr unsigned SEED = 20240601;
+
+    /* Random roots tried, in the avoid selection, before giving up on
+     * finding another landmark. */
+    constexpr int ROOT_ATTEMPTS = 32;
+
+    enum class Direction { forward, backward, both };
+
+    struct Entry
+    {
+        double distance;
+        Index vertex;
+
+        bool operator>(const Entry& other) const { return distance > other.distance; }
+    };
+
+    /* Dijkstra from `sources` to every vertex. Backward searches follow the
+     * edges in reverse, giving the distances to the sources; `both` treats
+     * the graph as undirected. `parents` and `order` (vertices in the order
+     * they are settled) are filled if not null. */
+    void one_to_all(const CsrGraph& graph, const std::vector<Index>& sources,
+                    Direction direction, std::vector<double>& distances,
+                    std::vector<Index>* parents = nullptr,
+                    std::vector<Index>* order = nullptr)
+    {
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+
+        distances.assign(graph.num_vertices(), INFINITE);
+
+        if (parents)
+            parents->assign(graph.num_vertices(), 0);
+
+        for (auto source: sources)
+        {
+            distances[source] = 0.0;
+            queue.push({ 0.0, source });
+
+            if (parents)
+                (*parents)[source] = source;
+        }
+
+        auto relax = [&] (Index from, Index to, double weight) {
+            double candidate = distances[from] + weight;
+
+            if (candidate < distances[to])
+            {
+                distances[to] = candidate;
+                queue.push({ candidate, to });
+
+                if (parents)
+                    (*parents)[to] = from;
+            }
+        };
+
+        while (!queue.empty())
+        {
+            Entry entry = queue.top();
+            queue.pop();
+
+            if (entry.distance > distances[entry.vertex])
+                continue;
+
+            if (order)
+                order->push_back(entry.vertex);
+
+            Index v = entry.vertex;
+
+            if (direction != Direction::backward)
+            {
+                for (Index e = graph.edges_begin(v); e < graph.edges_end(v); ++e)
+                    relax(v, graph.target(e), graph.weight(e));
+            }
+
+            if (direction != Direction::forward)
+            {
+                for (Index e = graph.in_begin(v); e < graph.in_end(v); ++e)
+                    relax(v, graph.in_source(e), graph.in_weight(e));
+            }
+        }
+    }
+
+    /* Stores `distances` as the column `column` of a table with `stride`
+     * columns. */
+    void store_column(const std::vector<double>& distances, std::size_t column,
+                      std::size_t stride, std::vector<float>& table)
+    {
+        for (std::size_t v = 0; v < distances.size(); ++v)
+        {
+            table[v * stride + column] = distances[v] == INFINITE
+                ? std::numeric_limits<float>::infinity()
+                : static_cast<float>(distances[v]);
+        }
+    }
+
+    /* The vertex farthest from all the chosen ones, ignoring directions,
+     * or `graph.num_vertices()` if every reachable vertex is chosen. */
+    Index farthest_from(const CsrGraph& graph, const std::vector<Index>& chosen)
+    {
+        std::vector<double> distances;
+        one_to_all(graph, chosen, Direction::both, distances);
+
+        Index best = static_cast<Index>(graph.num_vertices());
+        double farthest = 0.0;
+
+        for (Index v = 0; v < graph.num_vertices(); ++v)
+        {
+            if (distances[v] != INFINITE && distances[v] > farthest)
+            {
+                farthest = distances[v];
+                best = v;
+            }
+        }
+
+        return best;
+    }
+}
+
+
+std::unique_ptr<Landmarks> Landmarks::build(
+    std::shared_ptr<const CsrGraph> graph, std::size_t count,
+    Landmarks::Selection selection, const std::atomic<bool>* cancel)
+{
+    std::size_t n = graph->num_vertices();
+    count = std::min(count, n);
+
+    std::unique_ptr<Landmarks> result{ new Landmarks() };
+    Landmarks& lm = *result;
+
+    lm.m_graph = graph;
+    lm.m_num_vertices = n;
+    lm.m_stride = count;
+    lm.m_from.assign(n * count, 0.0f);
+    lm.m_to.assign(n * count, 0.0f);
+
+    if (count == 0)
+        return result;
+
+    ThreadPool pool{ std::min(static_cast<unsigned>(2 * count),
+                              std::max(1u, std::thread::hardware_concurrency())) };
+
+    // The forward and backward tables of one landmark, as two tasks.
+    auto submit_tables = [&] (std::size_t k, Index landmark) {
+        std::vector<std::future<void>> tasks;
+
+        for (auto [direction, table]: { std::pair{ Direction::forward, &lm.m_from },
+                                        std::pair{ Direction::backward, &lm.m_to } })
+        {
+            tasks.push_back(pool.submit([&graph, &table = *table, direction, k, count, landmark] () {
+                std::vector<double> distances;
+                one_to_all(*graph, { landmark }, direction, distances);
+                store_column(distances, k, count, table);
+            }));
+        }
+
+        return tasks;
+    };
+
+    std::mt19937 rng{ SEED };
+    std::uniform_int_distribution<Index> random_vertex(0, static_cast<Index>(n - 1));
+
+    if (selection == Selection::farthest)
+    {
+        // The first landmark is the farthest from a random vertex, so it
+        // lies at the edge of the map.
+        Index start = random_vertex(rng);
+        Index first = farthest_from(*graph, { start });
+
+        lm.m_landmarks.push_back(first == n ? start : first);
+
+        while (lm.m_landmarks.size() < count)
+        {
+            if (cancel && *cancel)
+                return nullptr;
+
+            Index next = farthest_from(*graph, lm.m_landmarks);
+
+            if (next == n)
+                break;
+
+            lm.m_landmarks.push_back(next);
+        }
+
+        // The tables are independent: all of them are computed at once.
+        std::vector<std::future<void>> tasks;
+
+        for (std::size_t k = 0; k < lm.m_landmarks.size(); ++k)
+        {
+            for (auto& task: submit_tables(k, lm.m_landmarks[k]))
+                tasks.push_back(std::move(task));
+        }
+
+        for (auto& task: tasks)
+            task.get();
+    }
+    else
+    {
+        std::vector<double> distances;
+        std::vector<Index> parents;
+        std::vector<Index> order;
+        std::vector<double> sizes(n);
+        std::vector<std::uint8_t> is_landmark(n, 0);
+
+        // Shortest path tree from `root`. Each vertex weighs how much the
+        // current bounds fall short of its distance from the root; the size
+        // of a subtree is the sum of its weights, or zero if it already
+        // holds a landmark. The new landmark is found from the largest
+        // subtree, down to a leaf through the largest child each time, or
+        // is `n` if no subtree has a positive size.
+        auto grow_tree = [&] (Index root) {
+            std::vector<std::size_t> active(lm.m_landmarks.size());
+
+            for (std::size_t k = 0; k < active.size(); ++k)
+                active[k] = k;
+
+            order.clear();
+            one_to_all(*graph, { root }, Direction::forward, distances, &parents, &order);
+
+            for (auto v: order)
+                sizes[v] = distances[v] - lm.bound(root, v, active);
+
+            for (auto it = order.rbegin(); it != order.rend(); ++it)
+            {
+                Index v = *it;
+
+                if (is_landmark[v])
+                    sizes[v] = -1.0;
+
+                if (v == root)
+                    continue;
+
+                if (sizes[v] < 0.0)
+                    sizes[parents[v]] = -1.0;
+                else if (sizes[parents[v]] >= 0.0)
+                    sizes[parents[v]] += sizes[v];
+            }
+
+            Index best = root;
+
+            for (auto v: order)
+            {
+                if (sizes[v] > sizes[best])
+                    best = v;
+            }
+
+            if (sizes[best] <= 0.0)
+                return static_cast<Index>(n);
+
+            std::vector<Index> heaviest_child(n, static_cast<Index>(n));
+
+            for (auto v: order)
+            {
+                if (v == root || sizes[v] < 0.0)
+                    continue;
+
+                Index& child = heaviest_child[parents[v]];
+
+                if (child == n || sizes[v] > sizes[child])
+                    child = v;
+            }
+
+            while (heaviest_child[best] != n)
+                best = heaviest_child[best];
+
+            return best;
+        };
+
+        while (lm.m_landmarks.size() < count)
+        {
+            if (cancel && *cancel)
+                return nullptr;
+
+            // A root at a dead end, or already covered by the landmarks,
+            // gives nothing; another one is drawn, a few times at most.
+            Index best = static_cast<Index>(n);
+
+            for (int attempt = 0; attempt < ROOT_ATTEMPTS && best == n; ++attempt)
+            {
+                Index root = random_vertex(rng);
+
+                if (graph->edges_begin(root) != graph->edges_end(root))
+                    best = grow_tree(root);
+            }
+
+            if (best == n)
+                break;
+
+            std::size_t k = lm.m_landmarks.size();
+
+            lm.m_landmarks.push_back(best);
+            is_landmark[best] = 1;
+
+            // The next tree needs the bounds of this landmark.
+            for (auto& task: submit_tables(k, best))
+                task.get();
+        }
+    }
+
+    // Fewer landmarks than asked for: the tables are packed again.
+    std::size_t stride = lm.m_landmarks.size();
+    lm.m_stride = stride;
+
+    if (stride < count)
+    {
+        for (auto* table: { &lm.m_from, &lm.m_to })
+        {
+            for (std::size_t v = 0; v < n; ++v)
+            {
+                for (std::size_t k = 0; k < stride; ++k)
+                    (*table)[v * stride + k] = (*table)[v * count + k];
+            }
+
+            table->resize(n * stride);
+            table->shrink_to_fit();
+        }
+    }
+
+    return result;
+}
+
+
+std::vector<std::size_t> Landmarks::choose_active(Index src, Index tgt) const
+{
+    std::vector<std::size_t> active;
+
+    if (src >= m_num_vertices || tgt >= m_num_vertices)
+        return active;
+
+    std::vector<std::pair<double, std::size_t>> bounds;
+
+    for (std::size_t k = 0; k < m_landmarks.size(); ++k)
+        bounds.emplace_back(bound_by(k, src, tgt), k);
+
+    std::size_t chosen = std::min(ACTIVE_COUNT, bounds.size());
+
+    std::partial_sort(bounds.begin(), bounds.begin() + chosen, bounds.end(),
+                      std::greater<std::pair<double, std::size_t>>());
+
+    for (std::size_t i = 0; i < chosen; ++i)
+        active.push_back(bounds[i].second);
+
+    return active;
+}
+
+
+double Landmarks::bound(Index vertex, Index tgt, const std::vector<std::size_t>& active) const
+{
+    if (vertex >= m_num_vertices || tgt >= m_num_vertices)
+        return 0.0;
+
+    double best = 0.0;
+
+    for (auto k: active)
+        best = std::max(best, bound_by(k, vertex, tgt));
+
+    return best;
+}
+
+
+double Landmarks::bound_by(std::size_t landmark, Index vertex, Index tgt) const
+{
+    std::size_t v = vertex * m_stride + landmark;
+    std::size_t t = tgt * m_stride + landmark;
+    double best = 0.0;
+
+    // d(v, t) >= d(L, t) - d(L, v). Infinite distances give no bound.
+    double from_t = m_from[t];
+    double from_v = m_from[v];
+
+    if (std::isfinite(from_t) && std::isfinite(from_v))
+        best = std::max(best, from_t - from_v - ROUNDING * (from_t + from_v));
+
+    // d(v, t) >= d(v, L) - d(t, L).
+    double to_v = m_to[v];
+    double to_t = m_to[t];
+
+    if (std::isfinite(to_v) && std::isfinite(to_t))
+        best = std::max(best, to_v - to_t - ROUNDING * (to_v + to_t));
+
+    return best;
+}
@@ -8,6 +8,13 @@
 #include <gtkmm/error.h>
 #include <gtkmm/filefilter.h>
 
+#include <algorithm>    // for min()
+#include <exception>
+#include <format>       // for format()
+#include <string>
+#include <utility>      // for move()
+#include <vector>
+
 
 #define THROW_INVALID_ID(id) \
     { throw Gtk::BuilderError(Gtk::BuilderError::INVALID_ID, \
@@ -26,22 +33,31 @@ MainWindow::MainWindow(BaseObjectType* cobject,
     m_graph_area->signal_changed_selection().connect(
         sigc::mem_fun(*this, &MainWindow::on_selection_changed));
 
-    auto button_new = builder->get_widget<Gtk::Button>("button-new");
-    if (!button_new)
+    m_button_new = builder->get_widget<Gtk::Button>("button-new");
+    if (!m_button_new)
         THROW_INVALID_ID("button-new");
 
-    button_new->signal_clicked().connect([this] () {
+    m_button_new->signal_clicked().connect([this] () {
+        this->m_hierarchy_builder.cancel();
         this->m_graph_area->set_graph( Graph::create() );
+        this->m_way_table = {};
         this->with_graph_opened(true);
     });
 
-    auto button_open = builder->get_widget<Gtk::Button>("button-open");
-    if (!button_open)
+    m_button_open = builder->get_widget<Gtk::Button>("button-open");
+    if (!m_button_open)
         THROW_INVALID_ID("button-open");
 
-    button_open->signal_clicked().connect(
+    m_button_open->signal_clicked().connect(
         sigc::mem_fun(*this, &MainWindow::open_file_dialog));
 
+    m_button_apply_changes = builder->get_widget<Gtk::Button>("button-apply-changes");
+    if (!m_button_apply_changes)
+        THROW_INVALID_ID("button-apply-changes");
+
+    m_button_apply_changes->signal_clicked().connect(
+        sigc::mem_fun(*this, &MainWindow::apply_changes_dialog));
+
     m_button_save = builder->get_widget<Gtk::Button>("button-save");
     if (!m_button_save)
         THROW_INVALID_ID("button-save");
@@ -54,7 +70,9 @@ MainWindow::MainWindow(BaseObjectType* cobject,
         THROW_INVALID_ID("button-close");
 
     m_button_close->signal_clicked().connect([this] () {
+        this->m_hierarchy_builder.cancel();
         this->m_graph_area->set_graph(nullptr);
+        this->m_way_table = {};
         this->with_graph_opened(false);
     });
 
@@ -62,8 +80,13 @@ MainWindow::MainWindow(BaseObjectType* cobject,
     if (!m_toggle_edit)
         THROW_INVALID_ID("toggle-edit");
 
+    // Edits throw the hierarchy away, and most of them the landmarks too;
+    // they are built again once the edits are done.
     m_toggle_edit->signal_toggled().connect([this] () {
         this->m_graph_area->set_editable(this->m_toggle_edit->get_active());
+
+        if (!this->m_toggle_edit->get_active())
+            this->build_hierarchy();
     });
 
     m_toggle_show_arrows = builder->get_widget<Gtk::CheckButton>("toggle-view");
@@ -86,6 +109,50 @@ MainWindow::MainWindow(BaseObjectType* cobject,
         );
     });
 
+    m_toggle_simplify = builder->get_widget<Gtk::CheckButton>("toggle-simplify");
+    if (!m_toggle_simplify)
+        THROW_INVALID_ID("toggle-simplify");
+
+    m_toggle_reachable = builder->get_widget<Gtk::CheckButton>("toggle-reachable");
+    if (!m_toggle_reachable)
+        THROW_INVALID_ID("toggle-reachable");
+
+    m_reachable_budget = builder->get_widget<Gtk::SpinButton>("reachable-budget");
+    if (!m_reachable_budget)
+        THROW_INVALID_ID("reachable-budget");
+
+    m_toggle_reachable->signal_toggled().connect(
+        sigc::mem_fun(*this, &MainWindow::update_reachable));
+
+    m_reachable_budget->signal_value_changed().connect(
+        sigc::mem_fun(*this, &MainWindow::update_reachable));
+
+    m_street_search = builder->get_widget<Gtk::SearchEntry2>("street-search");
+    if (!m_street_search)
+        THROW_INVALID_ID("street-search");
+
+    m_street_search->signal_search_changed().connect([this] () {
+        this->m_graph_area->set_street_prefix(this->m_street_search->get_text());
+    });
+
+    // The items are listed in the order of osm_parser::Profile.
+    m_profile_select = builder->get_widget<Gtk::DropDown>("profile-select");
+    if (!m_profile_select)
+        THROW_INVALID_ID("profile-select");
+
+    // The items are listed in the order of Graph::PathAlgorithm.
+    m_algorithm_select = builder->get_widget<Gtk::DropDown>("algorithm-select");
+    if (!m_algorithm_select)
+        THROW_INVALID_ID("algorithm-select");
+
+    m_algorithm_select->property_selected().signal_changed().connect([this] () {
+        auto selected = this->m_algorithm_select->get_selected();
+
+        if (selected < Graph::NUM_PATH_ALGORITHMS)
+            this->m_graph_area->set_path_algorithm(
+                static_cast<Graph::PathAlgorithm>(selected));
+    });
+
     m_src_field = Gtk::Builder::get_widget_derived<SearchField>(
         builder, "source-field");
     if (!m_src_field)
@@ -111,6 +178,34 @@ MainWindow::MainWindow(BaseObjectType* cobject,
 
     button_plot->signal_clicked().connect(
         sigc::mem_fun(*this, &MainWindow::on_plot_btn_clicked));
+
+    m_load_box = builder->get_widget<Gtk::Box>("load-box");
+    if (!m_load_box)
+        THROW_INVALID_ID("load-box");
+
+    m_load_progress = builder->get_widget<Gtk::ProgressBar>("load-progress");
+    if (!m_load_progress)
+        THROW_INVALID_ID("load-progress");
+
+    auto button_cancel_load = builder->get_widget<Gtk::Button>("button-cancel-load");
+    if (!button_cancel_load)
+        THROW_INVALID_ID("button-cancel-load");
+
+    button_cancel_load->signal_clicked().connect([this] () {
+        this->m_loader.cancel();
+    });
+
+    m_loader.signal_progress().connect(
+        sigc::mem_fun(*this, &MainWindow::on_load_progress));
+
+    m_loader.signal_finished().connect(
+        sigc::mem_fun(*this, &MainWindow::on_load_finished));
+
+    m_hierarchy_builder.signal_landmarks_ready().connect(
+        sigc::mem_fun(*this, &MainWindow::on_landmarks_ready));
+
+    m_hierarchy_builder.signal_finished().connect(
+        sigc::mem_fun(*this, &MainWindow::on_hierarchy_finished));
 }
 
 
@@ -140,6 +235,7 @@ void MainWindow::open_file_dialog()
     auto osm_filter = Gtk::FileFilter::create();
     osm_filter->set_name("OSM files");
     osm_filter->add_pattern("*.osm");
+    osm_filter->add_pattern("*.osm.pbf");
 
     filters->append(osm_filter);
 
@@ -162,7 +258,48 @@ void MainWindow::on_file_selection(
 
         std::string fpath = file->get_path();
 
-        auto g{ osm_parser::parse(fpath) };
+        // Loading happens in the background. The graph is picked up by
+        // on_load_finished().
+        auto profile = osm_parser::Profile::any_highway;
+        auto selected = m_profile_select->get_selected();
+
+        if (selected < osm_parser::NUM_PROFILES)
+            profile = static_cast<osm_parser::Profile>(selected);
+
+        m_loader.start(fpath, m_toggle_simplify->get_active(), profile);
+        with_loading(true);
+    }
+    catch (const Gtk::DialogError& err)
+    {
+        if (err.code() != Gtk::DialogError::DISMISSED)
+            throw err;
+    }
+}
+
+
+void MainWindow::on_load_progress(const osm_parser::Progress& progress)
+{
+    if (!m_loader.is_running())
+        return;
+
+    double fraction = progress.bytes_total > 0
+        ? static_cast<double>(progress.bytes_done) / progress.bytes_total
+        : 0.0;
+
+    m_load_progress->set_fraction(std::min(fraction, 1.0));
+    m_load_progress->set_text(std::format(
+        "{:.0f}% - {} nodes, {} ways", 100.0 * fraction,
+        progress.nodes, progress.ways));
+}
+
+
+void MainWindow::on_load_finished()
+{
+    with_loading(false);
+
+    try
+    {
+        auto g{ m_loader.take_result() };
 
         auto vertex_list{ g->get_vertex_id_list() };
 
@@ -170,23 +307,105 @@ void MainWindow::on_file_selection(
         m_tgt_field->set_data(vertex_list);
 
         m_graph_area->set_graph(std::move(g));
+        m_way_table = m_loader.take_way_table();
 
         with_graph_opened(true);
+        build_hierarchy();
     }
     catch (const osm_parser::ParserError& err)
     {
         auto alert = Gtk::AlertDialog::create();
         alert->set_message(
             "Could not parse file. Make sure it is in a proper "
-            "OSM XML format.");
+            "OSM XML or PBF format.");
+
+        alert->show(*this);
+    }
+    catch (const osm_parser::Cancelled&)
+    {
+        // The user asked for it, the current graph stays.
+    }
+    catch (const std::exception& err)
+    {
+        // Running out of memory, an id the graph can't index or a failure
+        // in the snapshot cache must not take the application down.
+        auto alert = Gtk::AlertDialog::create();
+        alert->set_message("Could not load file.");
+        alert->set_detail(err.what());
 
         alert->show(*this);
     }
+}
+
+
+void MainWindow::apply_changes_dialog()
+{
+    auto file_dialog = Gtk::FileDialog::create();
+    file_dialog->set_title("Select OSM change file");
+
+    auto filters = Gio::ListStore<Gtk::FileFilter>::create();
+
+    auto osc_filter = Gtk::FileFilter::create();
+    osc_filter->set_name("OSM change files");
+    osc_filter->add_pattern("*.osc");
+
+    filters->append(osc_filter);
+
+    file_dialog->set_filters(filters);
+
+    file_dialog->open(*this, sigc::bind(
+        sigc::mem_fun(*this, &MainWindow::on_changes_selection),
+        file_dialog
+    ));
+}
+
+
+void MainWindow::on_changes_selection(
+        const Glib::RefPtr<Gio::AsyncResult>& result,
+        const Glib::RefPtr<Gtk::FileDialog>& dialog)
+{
+    try
+    {
+        auto file = dialog->open_finish(result);
+
+        std::string fpath = file->get_path();
+        std::vector<std::size_t> vertex_list;
+
+        // Change files are a small fraction of the map, so they are read
+        // right away instead of in the background.
+        m_graph_area->modify_graph([&] (Graph& graph) {
+            osm_parser::apply_changes(graph, m_way_table, fpath);
+            vertex_list = graph.get_vertex_id_list();
+        });
+
+        m_src_field->set_data(vertex_list);
+        m_tgt_field->set_data(vertex_list);
+
+        build_hierarchy();
+    }
     catch (const Gtk::DialogError& err)
     {
         if (err.code() != Gtk::DialogError::DISMISSED)
             throw err;
     }
+    catch (const osm_parser::ParserError& err)
+    {
+        auto alert = Gtk::AlertDialog::create();
+        alert->set_message(
+            "Could not apply changes. Make sure the file is in the "
+            "osmChange format.");
+        alert->set_detail(err.what());
+
+        alert->show(*this);
+    }
+    catch (const std::exception& err)
+    {
+        auto alert = Gtk::AlertDialog::create();
+        alert->set_message("Could not apply changes.");
+        alert->set_detail(err.what());
+
+        alert->show(*this);
+    }
 }
 
 
@@ -237,6 +456,56 @@ void MainWindow::on_selection_changed()
     m_info_field->set_target(m_graph_area->get_tgt_vertex_id());
     m_info_field->set_distance(m_graph_area->get_path_distance());
     m_info_field->set_elapsed_time(m_graph_area->get_elapsed_time());
+    m_info_field->set_settled(m_graph_area->get_num_settled());
+}
+
+
+/* Shows the area reachable from the source in four bands, up to the
+ * chosen distance, or hides it. */
+void MainWindow::update_reachable()
+{
+    std::vector<double> budgets;
+
+    if (m_toggle_reachable->get_active())
+    {
+        double budget = m_reachable_budget->get_value();
+
+        for (int band = 1; band <= 4; ++band)
+            budgets.push_back(budget * band / 4.0);
+    }
+
+    m_graph_area->set_reachable_budgets(std::move(budgets));
+}
+
+
+/* Builds the landmarks and the contraction hierarchy of the graph in the
+ * background. Until they are ready, searches with them fall back to A* and
+ * the bidirectional Dijkstra. */
+void MainWindow::build_hierarchy()
+{
+    auto csr{ m_graph_area->get_frozen_graph() };
+
+    if (!csr || csr->num_vertices() == 0 || m_graph_area->has_hierarchy())
+        return;
+
+    // Leaving edit mode without editing keeps the same graph, and the build
+    // under way for it.
+    if (m_hierarchy_builder.is_running() && m_hierarchy_builder.graph() == csr)
+        return;
+
+    m_hierarchy_builder.start(std::move(csr));
+}
+
+
+void MainWindow::on_landmarks_ready()
+{
+    m_graph_area->set_landmarks(m_hierarchy_builder.take_landmarks());
+}
+
+
+void MainWindow::on_hierarchy_finished()
+{
+    m_graph_area->set_hierarchy(m_hierarchy_builder.take_result());
 }
 
 
@@ -244,4 +513,16 @@ void MainWindow::with_graph_opened(bool opened)
 {
     m_button_save->set_sensitive(opened);
     m_button_close->set_sensitive(opened);
+    m_button_apply_changes->set_sensitive(opened && m_way_table.valid);
+}
+
+
+void MainWindow::with_loading(bool loading)
+{
+    m_load_progress->set_fraction(0.0);
+    m_load_progress->set_text("Opening file...");
+    m_load_box->set_visible(loading);
+
+    m_button_new->set_sensitive(!loading);
+    m_button_open->set_sensitive(!loading);
 }
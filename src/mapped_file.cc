@@ -0,0 +1,45 @@
+#include "mapped_file.h"
+
+#include <boost/interprocess/exceptions.hpp>
+
+#include <filesystem>       // for file_size()
+
+
+namespace bip = boost::interprocess;
+
+
+MappedFile::MappedFile(const std::string& filename)
+{
+    try
+    {
+        // Mapping an empty file is an error on most systems.
+        if (std::filesystem::file_size(filename) == 0)
+            return;
+
+        m_file = bip::file_mapping(filename.c_str(), bip::read_only);
+        m_region = bip::mapped_region(m_file, bip::read_only);
+
+        // Files are read front to back, so let the system read ahead.
+        m_region.advise(bip::mapped_region::advice_sequential);
+    }
+    catch (const bip::interprocess_exception& err)
+    {
+        throw Error(filename + ": " + err.what());
+    }
+    catch (const std::filesystem::filesystem_error& err)
+    {
+        throw Error(err.what());
+    }
+}
+
+
+std::string_view MappedFile::data() const
+{
+    return { static_cast<const char*>(m_region.get_address()), m_region.get_size() };
+}
+
+
+std::size_t MappedFile::size() const
+{
+    return m_region.get_size();
+}
@@ -0,0 +1,137 @@
+#include "name_index.h"
+
+#include <algorithm>        // for lower_bound(), partition_point(), stable_sort()
+#include <numeric>          // for iota()
+#include <utility>          // for move()
+
+
+NameIndex::NameIndex(const Graph& graph)
+{
+    // The graph has few names compared to edges, so the names are sorted
+    // first and the edges then placed with a counting sort.
+    std::vector<std::string> keys(graph.num_names());
+
+    for (Graph::NameID id = 1; id < keys.size(); ++id)
+        keys[id] = normalize(graph.get_name(id));
+
+    std::vector<Graph::NameID> order(keys.size() - 1);
+    std::iota(order.begin(), order.end(), Graph::NameID{ 1 });
+
+    // Equal keys stay in id order, so the first of them is the oldest name.
+    std::stable_sort(order.begin(), order.end(), [&] (auto a, auto b) {
+        return keys[a] < keys[b];
+    });
+
+    std::vector<std::size_t> position(keys.size(), 0);
+
+    for (auto id: order)
+    {
+        if (m_keys.empty() || m_keys.back() != keys[id])
+        {
+            m_keys.push_back(std::move(keys[id]));
+            m_names.push_back(graph.get_name(id));
+        }
+
+        position[id] = m_keys.size() - 1;
+    }
+
+    m_offsets.assign(m_keys.size() + 1, 0);
+
+    for (auto [ei, eend] = graph.iter_edges(); ei != eend; ++ei)
+    {
+        auto name = graph.get_edge_properties(*ei).name;
+
+        if (name != StringPool::EMPTY)
+            ++m_offsets[position[name] + 1];
+    }
+
+    for (std::size_t i = 1; i < m_offsets.size(); ++i)
+        m_offsets[i] += m_offsets[i - 1];
+
+    m_edges.resize(m_offsets.back());
+
+    std::vector<std::size_t> next(m_offsets.begin(), m_offsets.end() - 1);
+
+    for (auto [ei, eend] = graph.iter_edges(); ei != eend; ++ei)
+    {
+        auto name = graph.get_edge_properties(*ei).name;
+
+        if (name != StringPool::EMPTY)
+            m_edges[next[position[name]]++] = *ei;
+    }
+}
+
+
+std::string NameIndex::normalize(std::string_view name)
+{
+    std::string key{ name };
+
+    for (std::size_t i = 0; i < key.size(); ++i)
+    {
+        auto c = static_cast<unsigned char>(key[i]);
+
+        if (c >= 'A' && c <= 'Z')
+        {
+            key[i] = static_cast<char>(c - 'A' + 'a');
+        }
+        else if (c == 0xC3 && i + 1 < key.size())
+        {
+            // U+00C0 to U+00DE, except U+00D7 (the multiplication sign),
+            // are the upper case Latin-1 letters; the lower case ones are
+            // 0x20 after them, with the same first byte.
+            auto next = static_cast<unsigned char>(key[i + 1]);
+
+            if (next >= 0x80 && next <= 0x9E && next != 0x97)
+                key[i + 1] = static_cast<char>(next + 0x20);
+
+            ++i;
+        }
+    }
+
+    return key;
+}
+
+
+std::optional<std::size_t> NameIndex::find(std::string_view name) const
+{
+    auto key = normalize(name);
+    auto it = std::lower_bound(m_keys.begin(), m_keys.end(), key);
+
+    if (it == m_keys.end() || *it != key)
+        return {};
+
+    return it - m_keys.begin();
+}
+
+
+std::pair<std::size_t, std::size_t> NameIndex::find_prefix(std::string_view prefix) const
+{
+    auto key = normalize(prefix);
+
+    // The names starting with the prefix come right after it, in order.
+    auto first = std::lower_bound(m_keys.begin(), m_keys.end(), key);
+    auto last = std::partition_point(first, m_keys.end(), [&] (const std::string& k) {
+        return k.starts_with(key);
+    });
+
+    return { first - m_keys.begin(), last - m_keys.begin() };
+}
+
+
+std::span<const NameIndex::EdgeT> NameIndex::edges_named(std::string_view name) const
+{
+    auto i = find(name);
+
+    if (!i)
+        return {};
+
+    return edges(*i);
+}
+
+
+std::span<const NameIndex::EdgeT> NameIndex::edges_with_prefix(std::string_view prefix) const
+{
+    auto [first, last] = find_prefix(prefix);
+
+    return edges(first, last);
+}
@@ -0,0 +1,316 @@
+#include "osm_parser.h"
+
+#include "id_index.h"
+#include "projection.h"
+#include "way_table.h"
+
+#include <cmath>            // for sqrt() and pow()
+#include <optional>
+#include <string>
+#include <utility>          // for move(), pair
+#include <vector>
+
+
+using osm_parser::ChangeSet;
+using osm_parser::WayTable;
+
+using VertexT = Graph::VertexT;
+
+
+namespace
+{
+    double coords_distance(const Graph::VertexCoords& a, const Graph::VertexCoords& b)
+    {
+        return std::sqrt(std::pow(a.x - b.x, 2) + std::pow(a.y - b.y, 2));
+    }
+
+    /* Removes one edge from src to tgt made for `way`. Other ways may join
+     * the same two vertices, so the name and direction must match. */
+    void remove_way_edge(Graph& graph, VertexT src, VertexT tgt,
+                         const WayTable::Way& way)
+    {
+        for (auto [ei, eend] = graph.iter_out_edges(src); ei != eend; ++ei)
+        {
+            const auto& props = graph.get_edge_properties(*ei);
+
+            if (graph.get_edge_tgt(*ei) == tgt
+                && props.name == way.name && props.oneway == way.oneway)
+            {
+                graph.remove_edge(*ei);
+                return;
+            }
+        }
+    }
+
+    /* The vertex of node `id`, if it is in the graph. */
+    std::optional<VertexT> find_node(const Graph& graph, std::size_t id)
+    {
+        auto [vi, vend] = graph.find_vertex_id(id);
+
+        if (vi == vend)
+            return {};
+
+        return *vi;
+    }
+
+    /* Removes the edges that the reading made for `way`: one for each pair
+     * of nodes in the graph, and one back if the way is two-way. */
+    void remove_way_edges(Graph& graph, const WayTable::Way& way)
+    {
+        std::optional<VertexT> src;
+
+        for (auto node: way.nodes)
+        {
+            std::optional<VertexT> tgt = find_node(graph, node);
+
+            if (src && tgt)
+            {
+                remove_way_edge(graph, *src, *tgt, way);
+
+                if (!way.oneway)
+                    remove_way_edge(graph, *tgt, *src, way);
+            }
+
+            src = tgt;
+        }
+    }
+}
+
+
+void osm_parser::apply_changes(Graph& graph, WayTable& table,
+                               const ChangeSet& changes)
+{
+    if (!table.valid)
+        throw ParserError("the graph has no way table to apply changes to");
+
+    Projection projection{ table.bounds };
+
+    // Vertex of each node in the graph, except the deleted ones, which stay
+    // in the graph until the end.
+    auto vertex_of_node = [&] (std::size_t id) -> std::optional<VertexT> {
+        if (const auto* node = changes.nodes.find(id); node && node->deleted)
+            return {};
+
+        return find_node(graph, id);
+    };
+
+    // The ways to rebuild are the changed ones, and the ones that go
+    // through a changed node, whose edges must be measured again.
+    std::vector<std::size_t> rebuilt;
+
+    changes.ways.for_each([&] (std::size_t id, const ChangeSet::Way&) {
+        rebuilt.push_back(id);
+    });
+
+    if (!changes.nodes.empty())
+    {
+        table.ways.for_each([&] (std::size_t id, const WayTable::Way& way) {
+            if (changes.ways.contains(id))
+                return;
+
+            for (auto node: way.nodes)
+            {
+                if (changes.nodes.contains(node))
+                {
+                    rebuilt.push_back(id);
+                    break;
+                }
+            }
+        });
+    }
+
+    // A changed way may use a node that is not a vertex, when it is new to
+    // the profile or was drawn over nodes of other ways. Unless the table
+    // kept it or the changes bring it, its coordinates can't be had without
+    // reading the map again.
+    changes.ways.for_each([&] (std::size_t id, const ChangeSet::Way& way) {
+        if (way.deleted)
+            return;
+
+        for (auto node: way.nodes)
+        {
+            if (!changes.nodes.contains(node) && !table.nodes.contains(node)
+                && !find_node(graph, node))
+            {
+                throw ParserError("way " + std::to_string(id) + " uses node "
+                                  + std::to_string(node) + ", which is not in the "
+                                  "graph nor in the changes; the map must be read again");
+            }
+        }
+    });
+
+    // Whether a node can be used by a way once the changes are in: it is a
+    // vertex, or its coordinates are known. As when reading, pairs with a
+    // node that is not in the map are skipped.
+    auto is_known = [&] (std::size_t id) {
+        if (const auto* node = changes.nodes.find(id))
+            return !node->deleted;
+
+        if (find_node(graph, id))
+            return true;
+
+        const auto* node = table.nodes.find(id);
+        return node && !node->missing;
+    };
+
+    // Every edge the ways will have is worked out before the graph is
+    // touched, with both of its nodes known. What comes after can't fail,
+    // so the graph and the table are never left half changed.
+    struct Link
+    {
+        std::size_t src;
+        std::size_t tgt;
+        Graph::NameID name;
+        bool oneway;
+    };
+
+    std::vector<Link> links;
+    std::vector<std::pair<std::size_t, WayTable::Way>> replaced;
+
+    auto link_way = [&] (const WayTable::Way& way) {
+        for (std::size_t i = 1; i < way.nodes.size(); ++i)
+        {
+            if (is_known(way.nodes[i - 1]) && is_known(way.nodes[i]))
+                links.push_back({ way.nodes[i - 1], way.nodes[i], way.name, way.oneway });
+        }
+    };
+
+    for (auto id: rebuilt)
+    {
+        const auto* change = changes.ways.find(id);
+
+        if (!change)
+        {
+            link_way(*table.ways.find(id));
+        }
+        else if (!change->deleted)
+        {
+            WayTable::Way way{ change->nodes, graph.intern_name(change->name), change->oneway };
+
+            link_way(way);
+            replaced.emplace_back(id, std::move(way));
+        }
+    }
+
+    // Edges are removed while the vertices are still where the ways put
+    // them. The nodes of changed ways may end up in no way at all.
+    std::vector<std::size_t> dropped;
+
+    for (auto id: rebuilt)
+    {
+        if (const auto* way = table.ways.find(id))
+        {
+            remove_way_edges(graph, *way);
+
+            if (changes.ways.contains(id))
+                dropped.insert(dropped.end(), way->nodes.begin(), way->nodes.end());
+        }
+    }
+
+    std::vector<VertexT> removed;
+
+    // Changed nodes that are not vertices go to the table, where new
+    // vertices take their coordinates from. Deleted ones stay there as
+    // missing, so that the ways that still use them skip them.
+    changes.nodes.for_each([&] (std::size_t id, const ChangeSet::Node& node) {
+        std::optional<VertexT> vertex = find_node(graph, id);
+
+        if (node.deleted)
+        {
+            if (vertex)
+                removed.push_back(*vertex);
+
+            table.nodes.insert_or_assign(id, { { 0.0, 0.0 }, true });
+        }
+        else if (vertex)
+        {
+            graph.set_vertex_coords(*vertex, projection.project(node.lat, node.lon));
+        }
+        else
+        {
+            table.nodes.insert_or_assign(id, { projection.project(node.lat, node.lon), false });
+        }
+    });
+
+    // As when reading, a node becomes a vertex only when first used.
+    auto vertex_of = [&] (std::size_t id) {
+        if (std::optional<VertexT> vertex = vertex_of_node(id))
+            return *vertex;
+
+        VertexT vertex = graph.add_vertex({ id, table.nodes.find(id)->coord });
+        table.nodes.erase(id);
+
+        return vertex;
+    };
+
+    Graph::EdgeProperties edge;
+
+    for (const auto& link: links)
+    {
+        VertexT src = vertex_of(link.src);
+        VertexT tgt = vertex_of(link.tgt);
+
+        edge.name = link.name;
+        edge.oneway = link.oneway;
+        edge.weight = coords_distance(graph.get_vertex_coords(src),
+                                      graph.get_vertex_coords(tgt));
+
+        // Both ends are vertices of the graph, which is all that adding
+        // an edge needs.
+        graph.add_edge(src, tgt, edge);
+
+        if (!edge.oneway)
+            graph.add_edge(tgt, src, edge);
+    }
+
+    changes.ways.for_each([&] (std::size_t id, const ChangeSet::Way& way) {
+        if (way.deleted)
+            table.ways.erase(id);
+    });
+
+    for (auto& [id, way]: replaced)
+        table.ways.insert_or_assign(id, std::move(way));
+
+    // Vertices of nodes that no way uses anymore go away. Finding them
+    // means looking at every way, so it is only done when ways lost nodes.
+    if (!dropped.empty())
+    {
+        IdIndex<bool> orphans;
+
+        for (auto node: dropped)
+        {
+            if (vertex_of_node(node))
+                orphans.try_emplace(node, true);
+        }
+
+        table.ways.for_each([&] (std::size_t, const WayTable::Way& way) {
+            if (orphans.empty())
+                return;
+
+            for (auto node: way.nodes)
+                orphans.erase(node);
+        });
+
+        // Edges drawn by hand, leaving or arriving, keep their vertices.
+        // The nodes are still in the map, maybe in ways of other kinds, so
+        // the table keeps them.
+        orphans.for_each([&] (std::size_t id, bool) {
+            VertexT vertex = *vertex_of_node(id);
+
+            if (graph.out_degree(vertex) == 0 && graph.in_degree(vertex) == 0)
+            {
+                table.nodes.insert_or_assign(id, { graph.get_vertex_coords(vertex), false });
+                removed.push_back(vertex);
+            }
+        });
+    }
+
+    graph.remove_vertices(removed);
+}
+
+
+void osm_parser::apply_changes(Graph& graph, WayTable& table,
+                               const std::string& filename)
+{
+    apply_changes(graph, table, read_changes(filename, table.profile));
+}
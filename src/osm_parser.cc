@@ -1,231 +1,816 @@
 #include "osm_parser.h"
 
-#include <boost/property_tree/exceptions.hpp>
-#include <boost/property_tree/ptree.hpp>
-#include <boost/property_tree/xml_parser.hpp>
-
-#include <algorithm>        // for reverse()
-#include <cmath>            // for cos(), sqrt() and pow()
-#include <map>
+#include "graph_builder.h"
+#include "graph_simplify.h"
+#include "mapped_file.h"
+#include "osm_pbf_reader.h"
+#include "osm_xml_reader.h"
+#include "thread_pool.h"
+
+#include <algorithm>        // for min(), clamp(), reverse()
+#include <atomic>
+#include <chrono>           // for milliseconds
+#include <future>
 #include <memory>           // for unique_ptr
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>           // for hardware_concurrency()
+#include <type_traits>      // for is_unsigned_v
 #include <utility>          // for move()
 #include <vector>
 
 
 using Vertex = Graph::VertexProperties;
-using Edge = Graph::EdgeProperties;
 
-typedef std::map<std::size_t, Vertex> NodeMap;
+using osm_parser::GraphBuilder;
+using osm_parser::XmlReader;
+
+typedef GraphBuilder::NodeTable NodeTable;
+
+
+template<typename T>
+static T attribute_as(const XmlReader::Element& el, std::string_view name)
+{
+    auto value = el.attribute(name);
+
+    if (!value)
+        throw osm_parser::ParserError(
+            std::string("missing attribute: ").append(name));
+
+    // Editors such as JOSM save the objects they create with negative ids
+    // until they are uploaded, and those can't be matched with the map.
+    if constexpr (std::is_unsigned_v<T>)
+    {
+        if (value->starts_with('-'))
+            throw osm_parser::ParserError(
+                std::string("negative id in attribute: ").append(name));
+    }
+
+    auto number = XmlReader::to_number<T>(*value);
+
+    if (!number)
+        throw osm_parser::ParserError(
+            std::string("invalid number in attribute: ").append(name));
+
+    return *number;
+}
+
+
+/* Reads a <node> whose id, already parsed to decide whether it is wanted,
+ * is `id`. */
+static Vertex read_node(const XmlReader::Element& el, std::size_t id,
+                        const GraphBuilder& builder)
+{
+    Vertex vertex;
+
+    vertex.id = id;
+    vertex.coord = builder.project(attribute_as<double>(el, "lat"),
+                                   attribute_as<double>(el, "lon"));
+
+    return vertex;
+}
 
-namespace pt = boost::property_tree;
 
+/* Finds the next "<name" tag, making sure it isn't a longer element name. */
+static std::size_t find_element(std::string_view document,
+                                std::string_view name,
+                                std::size_t from)
+{
+    std::string tag{ "<" };
+    tag.append(name);
+
+    for (auto pos = document.find(tag, from);
+         pos != std::string_view::npos;
+         pos = document.find(tag, pos + 1))
+    {
+        auto after = pos + tag.size();
 
-/* Parameters used in map projection.
+        if (after == document.size())
+            return pos;
+
+        char c = document[after];
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '/' || c == '>')
+            return pos;
+    }
+
+    return std::string_view::npos;
+}
+
+
+/* The node section ends where the first element that isn't a node starts. */
+static std::size_t find_node_section_end(std::string_view document,
+                                         std::size_t begin)
+{
+    return std::min({
+        find_element(document, "way", begin),
+        find_element(document, "relation", begin),
+        document.find("</osm", begin),
+        document.size()
+    });
+}
+
+
+/* Reads the nodes of one chunk. Runs on the thread pool.
  *
- * Since OSM marks points in a geographic coordinate system, we need a method
- * to project those points in a planar surface while maintaining their
- * relative distances.
- * The choosen method is to apply an equirectangular projection, since
- * this application is expected to deal mostly with small area sizes
- * on closer to 0º latitudes.
+ * Every so often, the bytes read are added to `done` and the chunk is
+ * abandoned if the parse has been cancelled.
  */
-namespace
+static NodeTable parse_node_chunk(std::string_view chunk,
+                                  const GraphBuilder& builder,
+                                  std::atomic<std::size_t>& done)
 {
-    constexpr double METERS_PER_DEGREE_LAT = 111320.0;
-    double METERS_PER_DEGREE_LON;
-    double center_lat, center_lon;
+    constexpr unsigned CHECK_INTERVAL = 4096;
+
+    XmlReader reader{ chunk };
+    XmlReader::Element el;
+    NodeTable nodes;
+
+    std::size_t reported = 0;
+    unsigned count = 0;
 
-    double project_lon(double lon)
+    while (reader.next(el))
     {
-        return (lon - center_lon) * METERS_PER_DEGREE_LON;
+        if (!el.closing && el.name == "node")
+        {
+            auto id = attribute_as<std::size_t>(el, "id");
+
+            if (builder.wants_node(id))
+                nodes.push_back(read_node(el, id, builder));
+        }
+
+        if (++count == CHECK_INTERVAL)
+        {
+            if (builder.is_cancelled())
+                return {};
+
+            done += reader.offset() - reported;
+            reported = reader.offset();
+            count = 0;
+        }
     }
 
-    double project_lat(double lat)
+    done += chunk.size() - reported;
+
+    return nodes;
+}
+
+
+/* Reads the node section of the file with several threads.
+ *
+ * The section is cut in roughly equal chunks, each one starting at a "<node"
+ * tag. Each thread tokenizes, converts and projects its own nodes into a
+ * local table. Chunks are joined back in file order, so the result is
+ * already sorted when the file is.
+ *
+ * Attribute values can't contain a raw '<', so a "<node" found in the middle
+ * of the section is always the start of an element. The section is only
+ * assumed to be free of comments.
+ *
+ * While the chunks are read, progress is reported as if the section, which
+ * starts at `offset` in the file, was read from start to end.
+ */
+static NodeTable parse_node_section(std::string_view section,
+                                    std::size_t offset,
+                                    GraphBuilder& builder,
+                                    ThreadPool& pool)
+{
+    // Below this, starting a thread costs more than reading the chunk.
+    constexpr std::size_t MIN_CHUNK_SIZE = 1 << 22;
+
+    std::size_t chunks = std::clamp<std::size_t>(
+        section.size() / MIN_CHUNK_SIZE, 1, pool.size());
+
+    std::vector<std::size_t> limits{ 0 };
+
+    for (std::size_t i = 1; i < chunks; ++i)
     {
-        return (center_lat - lat) * METERS_PER_DEGREE_LAT;
+        auto pos = std::min(
+            find_element(section, "node", i * section.size() / chunks),
+            section.size());
+
+        if (pos > limits.back())
+            limits.push_back(pos);
     }
 
-    double vertex_distance(const Vertex& a, const Vertex& b)
+    limits.push_back(section.size());
+
+    std::atomic<std::size_t> done{ 0 };
+    std::vector<std::future<NodeTable>> parts;
+
+    for (std::size_t i = 1; i < limits.size(); ++i)
     {
-        return std::sqrt(
-            std::pow(a.coord.x - b.coord.x, 2)
-            + std::pow(a.coord.y - b.coord.y, 2)
-        );
+        auto chunk = section.substr(limits[i - 1], limits[i] - limits[i - 1]);
+
+        parts.push_back(pool.submit([chunk, &builder, &done] () {
+            return parse_node_chunk(chunk, builder, done);
+        }));
     }
 
-    void set_projection_params(double minlat, double maxlat,
-                                      double minlon, double maxlon)
+    std::vector<NodeTable> tables;
+    std::size_t total = 0;
+
+    try
+    {
+        for (auto& part: parts)
+        {
+            while (part.wait_for(std::chrono::milliseconds(100)) != std::future_status::ready)
+                builder.report_progress(offset + done);
+
+            tables.push_back(part.get());
+            total += tables.back().size();
+        }
+
+        builder.report_progress(offset + section.size());
+    }
+    catch (...)
     {
-        center_lat = (minlat + maxlat) / 2.0;
-        center_lon = (minlon + maxlon) / 2.0;
+        // The tasks use `done`, so none of them may outlive this frame.
+        // Once cancelled, they return early.
+        for (auto& part: parts)
+        {
+            if (part.valid())
+                part.wait();
+        }
 
-        METERS_PER_DEGREE_LON =
-            std::cos(center_lat * M_PI / 180.0) * METERS_PER_DEGREE_LAT;
+        throw;
     }
+
+    NodeTable nodes;
+    nodes.reserve(total);
+
+    for (auto& table: tables)
+    {
+        nodes.insert(nodes.end(), table.begin(), table.end());
+        NodeTable{}.swap(table);
+    }
+
+    return nodes;
 }
 
 
-static inline bool is_visible(const pt::ptree& el)
+// We will only care about features that are visible.
+// Historical OSM data should be disregarded. Extracts that don't carry
+// history usually omit the attribute altogether.
+static inline bool is_visible(const XmlReader::Element& el)
 {
-    return el.get<std::string>("<xmlattr>.visible") == "true";
+    return el.attribute("visible").value_or("true") == "true";
 }
 
 
-static std::unique_ptr<Graph> parse_internal(const std::string& filename)
+/* Reads the children of the <way> in `el`, up to its closing tag.
+ *
+ * On return, `waypoints` and `name` describe the way, `filter` holds its
+ * tags, and the result tells whether it should become part of the graph: it
+ * must be visible and be accepted by `filter`'s profile. Ways that are not
+ * visible are left with no waypoints.
+ */
+static bool read_way(XmlReader& reader,
+                     XmlReader::Element& el,
+                     osm_parser::WayFilter& filter,
+                     std::vector<std::size_t>& waypoints,
+                     std::string& name)
 {
-    pt::ptree tree;
-    pt::read_xml(filename, tree);
-    pt::ptree root = tree.get_child("osm");
+    bool visible = is_visible(el);
 
-    set_projection_params(
-        root.get<double>("bounds.<xmlattr>.minlat"),
-        root.get<double>("bounds.<xmlattr>.maxlat"),
-        root.get<double>("bounds.<xmlattr>.minlon"),
-        root.get<double>("bounds.<xmlattr>.maxlon")
-    );
+    waypoints.clear();
+    filter.clear();
+    name.clear();
 
-    pt::ptree::assoc_iterator element, element_end;
-    NodeMap node_map;
+    if (el.self_closing)
+        return false;
 
-    for (boost::tie(element, element_end) = root.equal_range("node");
-         element != element_end;
-         ++element)
+    while (reader.next(el))
     {
-        const pt::ptree& node = element->second;
+        if (el.closing)
+        {
+            if (el.name == "way")
+                break;
 
-        Vertex vertex;
+            continue;
+        }
+
+        if (el.name == "nd")
+        {
+            waypoints.push_back(attribute_as<std::size_t>(el, "ref"));
+        }
+        else if (el.name == "tag")
+        {
+            std::string_view key = el.attribute("k").value_or("");
+            std::string_view value = el.attribute("v").value_or("");
 
-        vertex.id = node.get<std::size_t>("<xmlattr>.id");
-        vertex.coord.x = project_lon(node.get<double>("<xmlattr>.lon"));
-        vertex.coord.y = project_lat(node.get<double>("<xmlattr>.lat"));
+            if (filter.add_tag(key, value) == osm_parser::Word::name)
+                name = XmlReader::decode(value);
+        }
+    }
 
-        node_map.insert({vertex.id, vertex});
+    if (!visible)
+    {
+        waypoints.clear();
+        return false;
     }
 
-    std::map<std::size_t, std::size_t> nodeid_to_vd;
-    auto graph{ Graph::create() };
+    if (!filter.accepted())
+        return false;
 
-    for (boost::tie(element, element_end) = root.equal_range("way");
-         element != element_end;
-         ++element)
+    if (filter.reversed())
+        std::reverse(waypoints.begin(), waypoints.end());
+
+    return true;
+}
+
+
+/* First pass of the two-pass mode.
+ *
+ * Collects the ids of every node referenced by a way that will be part of
+ * the graph, or by any visible way if the builder keeps the other ways.
+ * Reading starts at the first <way>, so the node section, which is most
+ * of the file, isn't even tokenized.
+ */
+static std::vector<std::size_t> collect_way_nodes(std::string_view document,
+                                                  GraphBuilder& builder)
+{
+    std::vector<std::size_t> ids;
+
+    auto begin = find_element(document, "way", 0);
+    if (begin == std::string_view::npos)
+        return ids;
+
+    XmlReader reader{ document };
+    XmlReader::Element el;
+    osm_parser::WayFilter filter{ builder.profile() };
+    std::vector<std::size_t> waypoints;
+    std::string name;
+
+    reader.seek(begin);
+
+    while (reader.next(el))
     {
-        const pt::ptree& way = element->second;
+        if (!el.closing && el.name == "way"
+            && (read_way(reader, el, filter, waypoints, name)
+                || builder.keeps_other_ways()))
+            ids.insert(ids.end(), waypoints.begin(), waypoints.end());
 
-        // We will only care about features that are visible
-        // Historical OSM data should be disregarded.
-        if (!is_visible(way))
-            continue;
+        builder.report_progress(reader.offset());
+    }
 
-        Edge edge;
-        edge.name = "";
-        edge.oneway = false;
-        std::vector<std::size_t> waypoints;
+    return ids;
+}
 
-        bool is_way = false;
 
-        for (const pt::ptree::value_type& el: way)
+/* Reads the file element by element, as they appear.
+ *
+ * OSM XML always lists <bounds> first, then every <node>, then every <way>.
+ * Nodes are kept until the ways that reference them are read. Ways are turned
+ * into edges as soon as their closing tag is found, so the document itself
+ * is never held in memory.
+ *
+ * With more than one thread, the whole node section is handed to
+ * parse_node_section() as soon as its first node is found, and reading
+ * resumes right after it.
+ */
+static void parse_xml(std::string_view document,
+                      GraphBuilder& builder,
+                      ThreadPool* pool)
+{
+    XmlReader reader{ document };
+    XmlReader::Element el;
+
+    bool has_root = false;
+    bool has_nodes = false;
+
+    osm_parser::WayFilter filter{ builder.profile() };
+    std::string name;
+    std::vector<std::size_t> waypoints;
+
+    for (;;)
+    {
+        std::size_t element_offset = reader.offset();
+        builder.report_progress(element_offset);
+
+        if (!reader.next(el))
+            break;
+
+        if (el.closing)
+            continue;
+
+        if (el.name == "node")
         {
-            if (el.first == "nd")
-            {
-                waypoints.push_back(el.second.get<std::size_t>("<xmlattr>.ref"));
-            }
-            else if (el.first == "tag")
+            if (!builder.has_projection())
+                throw osm_parser::ParserError("no <bounds> before first <node>");
+
+            if (pool && !has_nodes)
             {
-                std::string key{ el.second.get<std::string>("<xmlattr>.k") };
-
-                std::string value{ el.second.get<std::string>("<xmlattr>.v") };
-
-                if (key == "name")
-                    edge.name = value;
-                else if (key == "oneway")
-                {
-                    if (value == "yes")
-                        edge.oneway = true;
-                    else if (value == "-1")
-                    {
-                        edge.oneway = true;
-
-                        // This reverse only works here because OSM XML
-                        // assures us the element order won't change.
-                        // That is: <nd> elements always comes before <tag> ones.
-                        // This means that at this point, the waypoints
-                        // vector is already complete.
-                        std::reverse(waypoints.begin(), waypoints.end());
-                    }
-                }
-                else if (key == "highway")
-                {
-                    is_way = true;
-                }
+                auto end = find_node_section_end(document, element_offset);
+
+                builder.add_nodes(parse_node_section(
+                    document.substr(element_offset, end - element_offset),
+                    element_offset, builder, *pool));
+
+                has_nodes = true;
+                reader.seek(end);
+                continue;
             }
+
+            auto id = attribute_as<std::size_t>(el, "id");
+
+            if (builder.wants_node(id))
+                builder.add_node(read_node(el, id, builder));
+
+            has_nodes = true;
+        }
+        else if (el.name == "way")
+        {
+            auto id = attribute_as<std::size_t>(el, "id");
+
+            if (read_way(reader, el, filter, waypoints, name))
+                builder.add_way(id, waypoints, name, filter.oneway());
+            else
+                builder.add_other_way(waypoints);
+        }
+        else if (el.name == "bounds")
+        {
+            builder.set_bounds(
+                attribute_as<double>(el, "minlat"),
+                attribute_as<double>(el, "maxlat"),
+                attribute_as<double>(el, "minlon"),
+                attribute_as<double>(el, "maxlon")
+            );
+        }
+        else if (el.name == "osm")
+        {
+            has_root = true;
         }
+    }
+
+    if (!has_root)
+        throw osm_parser::ParserError("no <osm> element in file");
+}
 
-        if (!is_way)
+
+/* Reads the <bounds> of a document. It comes before any node, so reading
+ * stops at the first one. */
+static std::optional<osm_parser::Bounds> read_xml_bounds(std::string_view document)
+{
+    XmlReader reader{ document };
+    XmlReader::Element el;
+
+    while (reader.next(el))
+    {
+        if (el.closing)
             continue;
 
-        for (std::size_t i = 1; i < waypoints.size(); ++i)
+        if (el.name == "bounds")
         {
-            std::size_t src_nodeid = waypoints[i - 1];
-            std::size_t tgt_nodeid = waypoints[i];
+            return osm_parser::Bounds{
+                attribute_as<double>(el, "minlat"),
+                attribute_as<double>(el, "maxlat"),
+                attribute_as<double>(el, "minlon"),
+                attribute_as<double>(el, "maxlon")
+            };
+        }
 
-            // If src or tgt nodes don't exist, jump to next pair
-            if (!node_map.contains(src_nodeid) || !node_map.contains(tgt_nodeid))
-                continue;
+        if (el.name == "node" || el.name == "way" || el.name == "relation")
+            break;
+    }
+
+    return std::nullopt;
+}
+
+
+static MappedFile map_file(const std::string& filename)
+{
+    try
+    {
+        return MappedFile(filename);
+    }
+    catch (const MappedFile::Error& err)
+    {
+        throw osm_parser::ParserError(
+            std::string("could not open file: ").append(err.what()));
+    }
+}
+
+
+static unsigned resolve_threads(unsigned threads)
+{
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    return threads;
+}
+
+
+/* Reads a whole file into `builder`, in one or two passes, as asked
+ * by `options`. */
+static void parse_data(std::string_view data,
+                       GraphBuilder& builder,
+                       const osm_parser::Options& options,
+                       ThreadPool* pool)
+{
+    bool pbf = osm_parser::is_pbf(data);
+
+    builder.set_profile(options.profile);
+    builder.set_progress(options, options.two_pass ? 2 * data.size() : data.size());
+
+    if (options.two_pass)
+    {
+        builder.set_wanted_nodes(pbf
+            ? osm_parser::collect_pbf_way_nodes(data, builder, pool)
+            : collect_way_nodes(data, builder));
+
+        builder.set_progress_base(data.size());
+    }
+
+    if (pbf)
+        osm_parser::parse_pbf(data, builder, pool);
+    else
+        parse_xml(data, builder, pool);
+
+    builder.report_progress(data.size());
+}
+
+
+/* Empties the table asked for by `options`, and has `builder` fill it
+ * unless the graph is going to be simplified. */
+static void prepare_way_table(GraphBuilder& builder,
+                              const osm_parser::Options& options)
+{
+    if (!options.way_table)
+        return;
+
+    *options.way_table = osm_parser::WayTable{};
+
+    if (options.simplify)
+        return;
+
+    builder.set_way_table(options.way_table);
+
+    if (options.keep_other_way_nodes)
+        builder.keep_other_ways();
+}
+
+
+std::unique_ptr<Graph> osm_parser::parse(const std::string& filename,
+                                         const Options& options)
+{
+    MappedFile file{ map_file(filename) };
+    unsigned threads = resolve_threads(options.threads);
+
+    GraphBuilder builder;
+    prepare_way_table(builder, options);
+
+    // Declared last so that, if parsing throws, pending tasks are done
+    // before the builder and the mapping go away.
+    std::unique_ptr<ThreadPool> pool;
+    if (threads > 1)
+        pool = std::make_unique<ThreadPool>(threads);
+
+    parse_data(file.data(), builder, options, pool.get());
+
+    auto graph{ builder.finish() };
+
+    if (options.cancel && *options.cancel)
+        throw Cancelled();
+
+    if (options.simplify)
+        graph = graph_simplify::contract_chains(*graph);
+
+    return graph;
+}
+
+
+std::unique_ptr<Graph> osm_parser::parse_tiles(const std::vector<std::string>& filenames,
+                                               const Options& options)
+{
+    if (filenames.empty())
+        throw ParserError("no files to read");
+
+    std::vector<MappedFile> files;
+    files.reserve(filenames.size());
+
+    for (const auto& filename: filenames)
+        files.push_back(map_file(filename));
+
+    // Every tile is projected around the middle of all of them, so that
+    // they end up on the same plane. Tiles that don't declare bounds
+    // just don't take part in choosing it.
+    Bounds box{ Bounds::empty() };
+
+    for (std::size_t i = 0; i < files.size(); ++i)
+    {
+        auto data = files[i].data();
+
+        try
+        {
+            if (auto bounds = is_pbf(data) ? read_pbf_bounds(data) : read_xml_bounds(data))
+                box.extend(*bounds);
+        }
+        catch (const ParserError& err)
+        {
+            throw ParserError(filenames[i] + ": " + err.what());
+        }
+    }
+
+    if (box.is_empty())
+        throw ParserError("none of the files declares its bounds");
+
+    Projection projection{ box };
+
+    // Each tile is read by a builder of its own, on a single thread, with
+    // the tiles spread over the pool. Builders only keep the ways, which are
+    // added to the graph once every node of every tile is known.
+    std::size_t count = files.size();
+    std::vector<GraphBuilder> tiles(count);
+    std::vector<std::atomic<std::size_t>> done(count);
+    std::size_t bytes_total = 0;
 
-            Vertex& src = node_map[src_nodeid];
-            Vertex& tgt = node_map[tgt_nodeid];
-            std::size_t src_vd, tgt_vd;
+    for (const auto& file: files)
+        bytes_total += options.two_pass ? 2 * file.size() : file.size();
 
-            if (!nodeid_to_vd.contains(src_nodeid))
+    auto read_tile = [&] (std::size_t i) {
+        Options tile_options;
+        tile_options.two_pass = options.two_pass;
+        tile_options.profile = options.profile;
+        tile_options.cancel = options.cancel;
+        tile_options.progress = [&done, i] (const Progress& progress) {
+            done[i].store(progress.bytes_done, std::memory_order_relaxed);
+        };
+
+        tiles[i].set_projection(projection);
+        tiles[i].keep_ways();
+
+        if (options.way_table && !options.simplify && options.keep_other_way_nodes)
+            tiles[i].keep_other_ways();
+
+        try
+        {
+            parse_data(files[i].data(), tiles[i], tile_options, nullptr);
+        }
+        catch (const ParserError& err)
+        {
+            throw ParserError(filenames[i] + ": " + err.what());
+        }
+    };
+
+    GraphBuilder merged;
+    merged.set_projection(projection);
+    merged.set_profile(options.profile);
+    prepare_way_table(merged, options);
+    merged.set_progress(options, bytes_total);
+
+    auto report_done = [&] () {
+        std::size_t bytes = 0;
+
+        for (const auto& d: done)
+            bytes += d.load(std::memory_order_relaxed);
+
+        merged.report_progress(bytes);
+    };
+
+    auto threads = static_cast<unsigned>(
+        std::min<std::size_t>(resolve_threads(options.threads), count));
+
+    if (threads <= 1)
+    {
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            read_tile(i);
+            report_done();
+        }
+    }
+    else
+    {
+        ThreadPool pool{ threads };
+        std::vector<std::future<void>> parts;
+
+        for (std::size_t i = 0; i < count; ++i)
+            parts.push_back(pool.submit([&read_tile, i] () { read_tile(i); }));
+
+        try
+        {
+            for (auto& part: parts)
             {
-                // Vertex is not yet added to graph
-                src_vd = graph->add_vertex(src);
-                nodeid_to_vd[src_nodeid] = src_vd;
-            }
-            else
-                src_vd = nodeid_to_vd[src_nodeid];
+                while (part.wait_for(std::chrono::milliseconds(100)) != std::future_status::ready)
+                    report_done();
 
-            if (!nodeid_to_vd.contains(tgt_nodeid))
+                part.get();
+            }
+        }
+        catch (...)
+        {
+            // The tasks use the tiles and the mappings, which are about
+            // to go away.
+            for (auto& part: parts)
             {
-                tgt_vd = graph->add_vertex(tgt);
-                nodeid_to_vd[tgt_nodeid] = tgt_vd;
+                if (part.valid())
+                    part.wait();
             }
-            else
-                tgt_vd = nodeid_to_vd[tgt_nodeid];
 
-            edge.weight = vertex_distance(src, tgt);
+            throw;
+        }
+    }
 
-            if (!graph->add_edge(src_vd, tgt_vd, edge))
-            {
-                // If we get here, it means that somehow edge could not be added
-                throw osm_parser::ParserError("error adding edges to graph");
-            }
+    // Nodes on the edges of the tiles are in more than one of them;
+    // the builder keeps the first one.
+    for (auto& tile: tiles)
+        merged.add_nodes(tile.take_nodes());
+
+    // Ways that cross tiles are also in more than one, but they reference
+    // all of their nodes in each one, so any copy can be taken.
+    IdIndex<bool> seen;
 
-            // Graph is directed. If we have a two-way path between vertices,
-            // then we must add another inverted edge.
-            if (!edge.oneway && !graph->add_edge(tgt_vd, src_vd, edge))
-                throw osm_parser::ParserError("error adding edges to graph");
+    for (auto& tile: tiles)
+    {
+        for (const auto& way: tile.take_ways())
+        {
+            if (seen.try_emplace(way.id, true).second)
+                merged.add_way(way.id, way.waypoints, way.name, way.oneway);
         }
     }
 
+    for (auto& tile: tiles)
+        merged.add_other_way(tile.take_other_nodes());
+
+    merged.report_progress(bytes_total);
+
+    auto graph{ merged.finish() };
+
+    if (options.cancel && *options.cancel)
+        throw Cancelled();
+
+    if (options.simplify)
+        graph = graph_simplify::contract_chains(*graph);
+
     return graph;
 }
 
 
-std::unique_ptr<Graph> osm_parser::parse(const std::string& filename)
+osm_parser::ChangeSet osm_parser::read_changes(const std::string& filename,
+                                               Profile profile)
 {
-    std::unique_ptr<Graph> g{ nullptr };
+    MappedFile file{ map_file(filename) };
 
-    try
-    {
-        g = parse_internal(filename);
-    }
-    catch (const pt::ptree_error& err)
+    XmlReader reader{ file.data() };
+    XmlReader::Element el;
+
+    bool has_root = false;
+    bool deleting = false;
+
+    ChangeSet changes;
+    WayFilter filter{ profile };
+
+    // Elements come in <create>, <modify> and <delete> blocks. Only
+    // <delete> needs telling apart; the others carry the new state.
+    while (reader.next(el))
     {
-        throw ParserError(
-            std::string("could not parse xml file: ").append(err.what())
-        );
+        if (el.closing)
+        {
+            if (el.name == "delete")
+                deleting = false;
+
+            continue;
+        }
+
+        if (el.name == "node")
+        {
+            auto id = attribute_as<std::size_t>(el, "id");
+            ChangeSet::Node node;
+
+            node.deleted = deleting || !is_visible(el);
+
+            if (!node.deleted)
+            {
+                node.lat = attribute_as<double>(el, "lat");
+                node.lon = attribute_as<double>(el, "lon");
+            }
+
+            changes.nodes.insert_or_assign(id, node);
+        }
+        else if (el.name == "way")
+        {
+            auto id = attribute_as<std::size_t>(el, "id");
+            ChangeSet::Way way;
+
+            bool accepted = read_way(reader, el, filter, way.nodes, way.name);
+
+            way.deleted = deleting || !accepted;
+            way.oneway = filter.oneway();
+
+            changes.ways.insert_or_assign(id, std::move(way));
+        }
+        else if (el.name == "delete")
+        {
+            deleting = !el.self_closing;
+        }
+        else if (el.name == "osmChange")
+        {
+            has_root = true;
+        }
     }
 
-    return g;
+    if (!has_root)
+        throw ParserError("no <osmChange> element in file");
+
+    return changes;
 }
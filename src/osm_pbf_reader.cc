@@ -0,0 +1,1019 @@
+#include "osm_pbf_reader.h"
+#include "osm_parser.h"
+
+#include <zlib.h>
+
+#include <algorithm>        // for min(), max(), reverse()
+#include <cstdint>
+#include <deque>
+#include <limits>           // for numeric_limits<>::max()
+#include <optional>
+#include <string>
+#include <utility>          // for move()
+#include <vector>
+
+
+using Vertex = Graph::VertexProperties;
+
+using osm_parser::Bounds;
+using osm_parser::GraphBuilder;
+using osm_parser::ParserError;
+using osm_parser::Profile;
+using osm_parser::WayFilter;
+using osm_parser::Word;
+
+typedef GraphBuilder::NodeTable NodeTable;
+
+
+/* Decoding of the protobuf wire format.
+ *
+ * A message is a sequence of fields, each one starting with a varint key that
+ * holds the field number and the wire type. Only the wire types used by the
+ * OSM schema are understood: varints, length-delimited data (strings, nested
+ * messages and packed repeated fields) and fixed 32/64 bit values, which are
+ * only skipped.
+ *
+ * See: https://protobuf.dev/programming-guides/encoding/
+ */
+namespace
+{
+    enum WireType: std::uint32_t
+    {
+        VARINT = 0,
+        FIXED64 = 1,
+        LENGTH_DELIMITED = 2,
+        FIXED32 = 5,
+    };
+
+    class ProtoReader
+    {
+    public:
+        explicit ProtoReader(std::string_view data)
+            : m_data(data) {}
+
+        /* Reads the key of the next field. Returns false at the end. */
+        bool next()
+        {
+            if (m_pos >= m_data.size())
+                return false;
+
+            std::uint64_t key = read_varint();
+            m_field = static_cast<std::uint32_t>(key >> 3);
+            m_wire = static_cast<std::uint32_t>(key & 0x7);
+
+            return true;
+        }
+
+        std::uint32_t field() const
+        {
+            return m_field;
+        }
+
+        std::uint64_t varint()
+        {
+            expect(VARINT);
+            return read_varint();
+        }
+
+        std::int64_t svarint()
+        {
+            return zigzag(varint());
+        }
+
+        std::string_view bytes()
+        {
+            expect(LENGTH_DELIMITED);
+
+            std::uint64_t size = read_varint();
+
+            if (size > m_data.size() - m_pos)
+                throw ParserError("malformed pbf: field past end of message");
+
+            auto value = m_data.substr(m_pos, size);
+            m_pos += size;
+
+            return value;
+        }
+
+        void skip()
+        {
+            switch (m_wire)
+            {
+            case VARINT:
+                read_varint();
+                break;
+            case FIXED64:
+                advance(8);
+                break;
+            case LENGTH_DELIMITED:
+                bytes();
+                break;
+            case FIXED32:
+                advance(4);
+                break;
+            default:
+                throw ParserError("malformed pbf: unknown wire type");
+            }
+        }
+
+        /* Calls f() for every value of a repeated varint field, packed or not. */
+        template<typename F>
+        void repeated_varint(F f)
+        {
+            if (m_wire == VARINT)
+            {
+                f(read_varint());
+                return;
+            }
+
+            ProtoReader packed{ bytes() };
+
+            while (!packed.at_end())
+                f(packed.read_varint());
+        }
+
+        bool at_end() const
+        {
+            return m_pos >= m_data.size();
+        }
+
+        std::uint64_t read_varint()
+        {
+            std::uint64_t value = 0;
+
+            for (unsigned shift = 0; shift < 64; shift += 7)
+            {
+                if (m_pos >= m_data.size())
+                    throw ParserError("malformed pbf: truncated varint");
+
+                auto byte = static_cast<std::uint8_t>(m_data[m_pos++]);
+                value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+
+                if (!(byte & 0x80))
+                    return value;
+            }
+
+            throw ParserError("malformed pbf: varint too long");
+        }
+
+        static std::int64_t zigzag(std::uint64_t value)
+        {
+            return static_cast<std::int64_t>(value >> 1)
+                ^ -static_cast<std::int64_t>(value & 1);
+        }
+
+    private:
+        void expect(std::uint32_t wire)
+        {
+            if (m_wire != wire)
+                throw ParserError("malformed pbf: unexpected wire type");
+        }
+
+        void advance(std::size_t count)
+        {
+            if (count > m_data.size() - m_pos)
+                throw ParserError("malformed pbf: field past end of message");
+
+            m_pos += count;
+        }
+
+        std::string_view m_data;
+        std::size_t m_pos{ 0 };
+        std::uint32_t m_field{ 0 };
+        std::uint32_t m_wire{ 0 };
+    };
+}
+
+
+/* Field numbers from the OSM PBF schema (fileformat.proto and osmformat.proto).
+ *
+ * See: https://wiki.openstreetmap.org/wiki/PBF_Format
+ */
+namespace
+{
+    namespace blob_header
+    {
+        constexpr std::uint32_t TYPE = 1;
+        constexpr std::uint32_t DATASIZE = 3;
+    }
+
+    namespace blob
+    {
+        constexpr std::uint32_t RAW = 1;
+        constexpr std::uint32_t RAW_SIZE = 2;
+        constexpr std::uint32_t ZLIB_DATA = 3;
+    }
+
+    namespace header_block
+    {
+        constexpr std::uint32_t BBOX = 1;
+        constexpr std::uint32_t REQUIRED_FEATURES = 4;
+    }
+
+    namespace header_bbox
+    {
+        constexpr std::uint32_t LEFT = 1;
+        constexpr std::uint32_t RIGHT = 2;
+        constexpr std::uint32_t TOP = 3;
+        constexpr std::uint32_t BOTTOM = 4;
+    }
+
+    namespace primitive_block
+    {
+        constexpr std::uint32_t STRINGTABLE = 1;
+        constexpr std::uint32_t PRIMITIVEGROUP = 2;
+        constexpr std::uint32_t GRANULARITY = 17;
+        constexpr std::uint32_t LAT_OFFSET = 19;
+        constexpr std::uint32_t LON_OFFSET = 20;
+    }
+
+    namespace primitive_group
+    {
+        constexpr std::uint32_t NODES = 1;
+        constexpr std::uint32_t DENSE = 2;
+        constexpr std::uint32_t WAYS = 3;
+    }
+
+    namespace node
+    {
+        constexpr std::uint32_t ID = 1;
+        constexpr std::uint32_t INFO = 4;
+        constexpr std::uint32_t LAT = 8;
+        constexpr std::uint32_t LON = 9;
+    }
+
+    namespace dense_nodes
+    {
+        constexpr std::uint32_t ID = 1;
+        constexpr std::uint32_t DENSEINFO = 5;
+        constexpr std::uint32_t LAT = 8;
+        constexpr std::uint32_t LON = 9;
+    }
+
+    namespace dense_info
+    {
+        constexpr std::uint32_t VISIBLE = 6;
+    }
+
+    namespace way
+    {
+        constexpr std::uint32_t ID = 1;
+        constexpr std::uint32_t KEYS = 2;
+        constexpr std::uint32_t VALS = 3;
+        constexpr std::uint32_t INFO = 4;
+        constexpr std::uint32_t REFS = 8;
+    }
+
+    namespace info
+    {
+        constexpr std::uint32_t VISIBLE = 6;
+    }
+
+    // Blobs are at most 32 MiB once uncompressed, by the format definition.
+    constexpr std::size_t MAX_BLOB_SIZE = 32 * 1024 * 1024;
+    constexpr std::size_t MAX_HEADER_SIZE = 64 * 1024;
+
+    /* A way that passed the filters, ready to be given to GraphBuilder. */
+    struct Way
+    {
+        std::size_t id;
+        std::vector<std::size_t> waypoints;
+        std::string name;
+        bool oneway;
+    };
+
+    /* Everything decoded from one OSMData blob.
+     *
+     * When the projection isn't known yet, nodes hold raw coordinates in
+     * degrees: longitude in coord.x and latitude in coord.y, and `extent`
+     * covers every visible node of the block, including the ones that were
+     * not kept.
+     */
+    struct Block
+    {
+        NodeTable nodes;
+        bool projected{ false };
+        Bounds extent{ Bounds::empty() };
+        std::vector<Way> ways;
+        std::vector<std::size_t> other_nodes;   // Of the ways not accepted.
+    };
+
+    /* How a worker should decode a block. */
+    struct DecodeMode
+    {
+        const GraphBuilder* builder;    // Decides which nodes are kept.
+        bool project;                   // If the bounds are already known.
+        bool ways_only;                 // Nodes are skipped altogether.
+        Profile profile;                // Decides which ways are kept.
+        bool other_ways;                // Keep the nodes of the other ways.
+    };
+}
+
+
+static std::uint32_t read_be32(std::string_view data)
+{
+    auto b = [&] (std::size_t i) {
+        return static_cast<std::uint32_t>(static_cast<std::uint8_t>(data[i]));
+    };
+
+    return (b(0) << 24) | (b(1) << 16) | (b(2) << 8) | b(3);
+}
+
+
+/* Returns the payload of a Blob, inflating it into `buffer` when needed. */
+static std::string_view blob_data(std::string_view blob_message,
+                                  std::string& buffer)
+{
+    ProtoReader blob{ blob_message };
+    std::optional<std::string_view> raw, zlib_data;
+    std::uint64_t raw_size = 0;
+
+    while (blob.next())
+    {
+        switch (blob.field())
+        {
+        case blob::RAW:
+            raw = blob.bytes();
+            break;
+        case blob::RAW_SIZE:
+            raw_size = blob.varint();
+            break;
+        case blob::ZLIB_DATA:
+            zlib_data = blob.bytes();
+            break;
+        default:
+            blob.skip();
+        }
+    }
+
+    if (raw)
+        return *raw;
+
+    if (!zlib_data)
+        throw ParserError("unsupported pbf blob compression");
+
+    if (raw_size > MAX_BLOB_SIZE)
+        throw ParserError("malformed pbf: blob too large");
+
+    buffer.resize(raw_size);
+    uLongf size = static_cast<uLongf>(raw_size);
+
+    int status = uncompress(
+        reinterpret_cast<Bytef*>(buffer.data()), &size,
+        reinterpret_cast<const Bytef*>(zlib_data->data()),
+        static_cast<uLong>(zlib_data->size()));
+
+    if (status != Z_OK || size != raw_size)
+        throw ParserError("malformed pbf: could not inflate blob");
+
+    return buffer;
+}
+
+
+static std::optional<Bounds> read_header(std::string_view blob_message)
+{
+    std::string buffer;
+    ProtoReader header{ blob_data(blob_message, buffer) };
+    std::optional<Bounds> bounds;
+
+    while (header.next())
+    {
+        if (header.field() == header_block::BBOX)
+        {
+            ProtoReader bbox{ header.bytes() };
+            std::int64_t left = 0, right = 0, top = 0, bottom = 0;
+
+            while (bbox.next())
+            {
+                switch (bbox.field())
+                {
+                case header_bbox::LEFT:
+                    left = bbox.svarint();
+                    break;
+                case header_bbox::RIGHT:
+                    right = bbox.svarint();
+                    break;
+                case header_bbox::TOP:
+                    top = bbox.svarint();
+                    break;
+                case header_bbox::BOTTOM:
+                    bottom = bbox.svarint();
+                    break;
+                default:
+                    bbox.skip();
+                }
+            }
+
+            // The header box is always in nanodegrees.
+            bounds = Bounds{ bottom * 1e-9, top * 1e-9, left * 1e-9, right * 1e-9 };
+        }
+        else if (header.field() == header_block::REQUIRED_FEATURES)
+        {
+            auto feature = header.bytes();
+
+            // Files with history keep every version of the objects, and
+            // the graph would get all of them at once.
+            if (feature != "OsmSchema-V0.6" && feature != "DenseNodes")
+            {
+                throw ParserError(std::string("unsupported pbf feature: ")
+                    .append(feature));
+            }
+        }
+        else
+            header.skip();
+    }
+
+    return bounds;
+}
+
+
+/* Coordinates of a block are stored as offsets in units of `granularity`
+ * nanodegrees. */
+struct BlockScale
+{
+    std::int64_t granularity{ 100 };
+    std::int64_t lat_offset{ 0 };
+    std::int64_t lon_offset{ 0 };
+
+    double lat(std::int64_t value) const
+    {
+        return 1e-9 * static_cast<double>(lat_offset + granularity * value);
+    }
+
+    double lon(std::int64_t value) const
+    {
+        return 1e-9 * static_cast<double>(lon_offset + granularity * value);
+    }
+};
+
+
+static void add_node(std::int64_t id, double lat, double lon,
+                     const DecodeMode& mode, Block& block)
+{
+    Vertex vertex;
+    vertex.id = static_cast<std::size_t>(id);
+
+    // The map extent must not depend on which nodes are kept.
+    if (!mode.project)
+        block.extent.extend(lat, lon);
+
+    if (!mode.builder->wants_node(vertex.id))
+        return;
+
+    if (mode.project)
+        vertex.coord = mode.builder->project(lat, lon);
+    else
+        vertex.coord = { lon, lat };
+
+    block.nodes.push_back(vertex);
+}
+
+
+static bool info_visible(std::string_view info_message)
+{
+    ProtoReader info{ info_message };
+    bool visible = true;
+
+    while (info.next())
+    {
+        if (info.field() == info::VISIBLE)
+            visible = info.varint() != 0;
+        else
+            info.skip();
+    }
+
+    return visible;
+}
+
+
+static void read_plain_node(std::string_view message,
+                            const BlockScale& scale,
+                            const DecodeMode& mode,
+                            Block& block)
+{
+    ProtoReader node{ message };
+    std::int64_t id = 0, lat = 0, lon = 0;
+    bool visible = true;
+
+    while (node.next())
+    {
+        switch (node.field())
+        {
+        case node::ID:
+            id = node.svarint();
+            break;
+        case node::INFO:
+            visible = info_visible(node.bytes());
+            break;
+        case node::LAT:
+            lat = node.svarint();
+            break;
+        case node::LON:
+            lon = node.svarint();
+            break;
+        default:
+            node.skip();
+        }
+    }
+
+    if (visible)
+        add_node(id, scale.lat(lat), scale.lon(lon), mode, block);
+}
+
+
+/* DenseNodes store ids, latitudes and longitudes in three parallel packed
+ * arrays, each one delta coded against the previous node. */
+static void read_dense_nodes(std::string_view message,
+                             const BlockScale& scale,
+                             const DecodeMode& mode,
+                             Block& block)
+{
+    ProtoReader dense{ message };
+    std::string_view ids, lats, lons, visibles;
+
+    while (dense.next())
+    {
+        switch (dense.field())
+        {
+        case dense_nodes::ID:
+            ids = dense.bytes();
+            break;
+        case dense_nodes::LAT:
+            lats = dense.bytes();
+            break;
+        case dense_nodes::LON:
+            lons = dense.bytes();
+            break;
+        case dense_nodes::DENSEINFO:
+        {
+            ProtoReader info{ dense.bytes() };
+
+            while (info.next())
+            {
+                if (info.field() == dense_info::VISIBLE)
+                    visibles = info.bytes();
+                else
+                    info.skip();
+            }
+
+            break;
+        }
+        default:
+            dense.skip();
+        }
+    }
+
+    ProtoReader id_reader{ ids }, lat_reader{ lats }, lon_reader{ lons };
+    ProtoReader visible_reader{ visibles };
+    std::int64_t id = 0, lat = 0, lon = 0;
+
+    while (!id_reader.at_end())
+    {
+        if (lat_reader.at_end() || lon_reader.at_end())
+            throw ParserError("malformed pbf: dense node arrays differ in size");
+
+        id += ProtoReader::zigzag(id_reader.read_varint());
+        lat += ProtoReader::zigzag(lat_reader.read_varint());
+        lon += ProtoReader::zigzag(lon_reader.read_varint());
+
+        // Files without history have no visibility information.
+        bool visible = visibles.empty() || visible_reader.read_varint() != 0;
+
+        if (visible)
+            add_node(id, scale.lat(lat), scale.lon(lon), mode, block);
+    }
+}
+
+
+static void read_way(std::string_view message,
+                     const std::vector<std::string_view>& strings,
+                     const DecodeMode& mode,
+                     Block& block)
+{
+    ProtoReader reader{ message };
+    std::vector<std::uint32_t> keys, vals;
+    std::vector<std::size_t> waypoints;
+    std::size_t id = 0;
+    bool visible = true;
+
+    while (reader.next())
+    {
+        switch (reader.field())
+        {
+        case way::ID:
+            id = static_cast<std::size_t>(reader.varint());
+            break;
+        case way::KEYS:
+            reader.repeated_varint([&] (std::uint64_t v) {
+                keys.push_back(static_cast<std::uint32_t>(v));
+            });
+            break;
+        case way::VALS:
+            reader.repeated_varint([&] (std::uint64_t v) {
+                vals.push_back(static_cast<std::uint32_t>(v));
+            });
+            break;
+        case way::INFO:
+            visible = info_visible(reader.bytes());
+            break;
+        case way::REFS:
+        {
+            std::int64_t ref = 0;
+            reader.repeated_varint([&] (std::uint64_t v) {
+                ref += ProtoReader::zigzag(v);
+                waypoints.push_back(static_cast<std::size_t>(ref));
+            });
+            break;
+        }
+        default:
+            reader.skip();
+        }
+    }
+
+    // We will only care about features that are visible.
+    if (!visible || keys.size() != vals.size())
+        return;
+
+    std::string_view name;
+    WayFilter filter{ mode.profile };
+
+    for (std::size_t i = 0; i < keys.size(); ++i)
+    {
+        if (keys[i] >= strings.size() || vals[i] >= strings.size())
+            throw ParserError("malformed pbf: string index out of range");
+
+        std::string_view key = strings[keys[i]];
+        std::string_view value = strings[vals[i]];
+
+        if (filter.add_tag(key, value) == Word::name)
+            name = value;
+    }
+
+    if (!filter.accepted())
+    {
+        if (mode.other_ways)
+            block.other_nodes.insert(block.other_nodes.end(),
+                                     waypoints.begin(), waypoints.end());
+        return;
+    }
+
+    if (filter.reversed())
+        std::reverse(waypoints.begin(), waypoints.end());
+
+    // The string table goes away with the block's buffer, so the name
+    // is copied.
+    block.ways.push_back({ id, std::move(waypoints), std::string(name), filter.oneway() });
+}
+
+
+/* Decodes one OSMData blob. Runs on the thread pool. */
+static Block read_block(std::string_view blob_message, const DecodeMode& mode)
+{
+    std::string buffer;
+    ProtoReader reader{ blob_data(blob_message, buffer) };
+
+    std::vector<std::string_view> strings;
+    std::vector<std::string_view> groups;
+    BlockScale scale;
+
+    // Fields may come in any order, and groups can only be read once
+    // the string table and the scale are known.
+    while (reader.next())
+    {
+        switch (reader.field())
+        {
+        case primitive_block::STRINGTABLE:
+        {
+            ProtoReader table{ reader.bytes() };
+
+            while (table.next())
+            {
+                if (table.field() == 1)
+                    strings.push_back(table.bytes());
+                else
+                    table.skip();
+            }
+
+            break;
+        }
+        case primitive_block::PRIMITIVEGROUP:
+            groups.push_back(reader.bytes());
+            break;
+        case primitive_block::GRANULARITY:
+            scale.granularity = static_cast<std::int64_t>(reader.varint());
+            break;
+        case primitive_block::LAT_OFFSET:
+            scale.lat_offset = static_cast<std::int64_t>(reader.varint());
+            break;
+        case primitive_block::LON_OFFSET:
+            scale.lon_offset = static_cast<std::int64_t>(reader.varint());
+            break;
+        default:
+            reader.skip();
+        }
+    }
+
+    Block block;
+    block.projected = mode.project;
+
+    for (auto group_message: groups)
+    {
+        ProtoReader group{ group_message };
+
+        while (group.next())
+        {
+            switch (group.field())
+            {
+            case primitive_group::NODES:
+                if (mode.ways_only)
+                    group.skip();
+                else
+                    read_plain_node(group.bytes(), scale, mode, block);
+                break;
+            case primitive_group::DENSE:
+                if (mode.ways_only)
+                    group.skip();
+                else
+                    read_dense_nodes(group.bytes(), scale, mode, block);
+                break;
+            case primitive_group::WAYS:
+                read_way(group.bytes(), strings, mode, block);
+                break;
+            default:
+                group.skip();
+            }
+        }
+    }
+
+    return block;
+}
+
+
+bool osm_parser::is_pbf(std::string_view data)
+{
+    if (data.size() < 4)
+        return false;
+
+    std::uint32_t size = read_be32(data);
+
+    if (size > MAX_HEADER_SIZE || size > data.size() - 4)
+        return false;
+
+    return data.substr(4, size).find("OSMHeader") != std::string_view::npos;
+}
+
+
+/* Reads the blob starting at `pos`, and moves `pos` past it.
+ *
+ * Returns the blob type and its Blob message.
+ */
+static std::pair<std::string_view, std::string_view> next_blob(std::string_view data,
+                                                               std::size_t& pos)
+{
+    if (data.size() - pos < 4)
+        throw ParserError("malformed pbf: truncated blob header");
+
+    std::uint32_t header_size = read_be32(data.substr(pos));
+    pos += 4;
+
+    if (header_size > MAX_HEADER_SIZE || header_size > data.size() - pos)
+        throw ParserError("malformed pbf: invalid blob header size");
+
+    ProtoReader header{ data.substr(pos, header_size) };
+    pos += header_size;
+
+    std::string_view type;
+    std::uint64_t blob_size = 0;
+
+    while (header.next())
+    {
+        if (header.field() == blob_header::TYPE)
+            type = header.bytes();
+        else if (header.field() == blob_header::DATASIZE)
+            blob_size = header.varint();
+        else
+            header.skip();
+    }
+
+    if (blob_size > data.size() - pos)
+        throw ParserError("malformed pbf: truncated blob");
+
+    std::string_view blob_message = data.substr(pos, blob_size);
+    pos += blob_size;
+
+    return { type, blob_message };
+}
+
+
+/* Walks the file blob by blob.
+ *
+ * `on_header` is called with each OSMHeader blob. For each OSMData blob,
+ * `make_task` is called on this thread and returns the function that decodes
+ * it; tasks are handed to the pool and their blocks given to `consume` in
+ * file order, along with the offset where the blob ends, with a limited
+ * number of them in flight so that memory doesn't grow with the size of
+ * the file.
+ */
+template<typename OnHeader, typename MakeTask, typename Consume>
+static void walk_blocks(std::string_view data,
+                        ThreadPool* pool,
+                        OnHeader on_header,
+                        MakeTask make_task,
+                        Consume consume)
+{
+    bool has_header = false;
+
+    const std::size_t max_in_flight = pool ? 4 * pool->size() : 0;
+    std::deque<std::pair<std::future<Block>, std::size_t>> in_flight;
+
+    auto consume_front = [&] () {
+        auto [block, end] = std::move(in_flight.front());
+        in_flight.pop_front();
+        consume(block.get(), end);
+    };
+
+    std::size_t pos = 0;
+
+    try
+    {
+        while (pos < data.size())
+        {
+            auto [type, blob_message] = next_blob(data, pos);
+
+            if (type == "OSMHeader")
+            {
+                on_header(blob_message);
+                has_header = true;
+            }
+            else if (type == "OSMData")
+            {
+                if (!has_header)
+                    throw ParserError("malformed pbf: data before header");
+
+                auto task = make_task(blob_message);
+
+                if (!pool)
+                {
+                    consume(task(), pos);
+                    continue;
+                }
+
+                in_flight.emplace_back(pool->submit(std::move(task)), pos);
+
+                if (in_flight.size() >= max_in_flight)
+                    consume_front();
+            }
+            // Unknown blob types must be skipped, according to the format.
+        }
+
+        while (!in_flight.empty())
+            consume_front();
+    }
+    catch (...)
+    {
+        // The tasks read `data` and the state captured by `make_task`, so
+        // none of them may outlive this frame.
+        for (auto& task: in_flight)
+            task.first.wait();
+
+        throw;
+    }
+
+    if (!has_header)
+        throw ParserError("malformed pbf: no header block");
+}
+
+
+/* Nodes come before ways in any sorted file; they can only be projected once
+ * the projection is known, which is either from the builder, from the header
+ * or, when it has no bounds, after every node has been read.
+ */
+void osm_parser::parse_pbf(std::string_view data,
+                           GraphBuilder& builder,
+                           ThreadPool* pool)
+{
+    // Only used while the projection is unknown.
+    NodeTable raw_nodes;
+    Bounds extent{ Bounds::empty() };
+
+    auto flush_raw_nodes = [&] () {
+        if (builder.has_projection())
+            return;
+
+        Bounds box = extent.is_empty() ? Bounds{ 0.0, 0.0, 0.0, 0.0 } : extent;
+
+        builder.set_bounds(box.minlat, box.maxlat, box.minlon, box.maxlon);
+
+        for (auto& node: raw_nodes)
+            node.coord = builder.project(node.coord.y, node.coord.x);
+
+        builder.add_nodes(std::move(raw_nodes));
+    };
+
+    auto on_header = [&] (std::string_view blob_message) {
+        auto bounds = read_header(blob_message);
+
+        if (bounds)
+            builder.set_bounds(bounds->minlat, bounds->maxlat,
+                               bounds->minlon, bounds->maxlon);
+    };
+
+    auto make_task = [&] (std::string_view blob_message) {
+        DecodeMode mode{ &builder, builder.has_projection(), false,
+                         builder.profile(), builder.keeps_other_ways() };
+
+        return [blob_message, mode] () {
+            return read_block(blob_message, mode);
+        };
+    };
+
+    auto consume = [&] (Block&& block, std::size_t end) {
+        if (block.projected)
+            builder.add_nodes(std::move(block.nodes));
+        else if (!builder.has_projection())
+        {
+            raw_nodes.insert(raw_nodes.end(), block.nodes.begin(), block.nodes.end());
+            extent.extend(block.extent);
+        }
+        else
+        {
+            // Nodes that came after the projection was settled.
+            for (auto& node: block.nodes)
+                node.coord = builder.project(node.coord.y, node.coord.x);
+
+            builder.add_nodes(std::move(block.nodes));
+        }
+
+        if (!block.ways.empty())
+            flush_raw_nodes();
+
+        for (const auto& way: block.ways)
+            builder.add_way(way.id, way.waypoints, way.name, way.oneway);
+
+        builder.add_other_way(block.other_nodes);
+        builder.report_progress(end);
+    };
+
+    walk_blocks(data, pool, on_header, make_task, consume);
+
+    flush_raw_nodes();
+}
+
+
+std::vector<std::size_t> osm_parser::collect_pbf_way_nodes(std::string_view data,
+                                                          GraphBuilder& builder,
+                                                          ThreadPool* pool)
+{
+    // Nothing is filtered or projected in this pass, so the builder
+    // is only there to answer wants_node().
+    GraphBuilder unfiltered;
+    DecodeMode mode{ &unfiltered, false, true,
+                     builder.profile(), builder.keeps_other_ways() };
+
+    std::vector<std::size_t> ids;
+
+    auto make_task = [mode] (std::string_view blob_message) {
+        return [blob_message, mode] () {
+            return read_block(blob_message, mode);
+        };
+    };
+
+    auto consume = [&ids, &builder] (Block&& block, std::size_t end) {
+        for (const auto& way: block.ways)
+            ids.insert(ids.end(), way.waypoints.begin(), way.waypoints.end());
+
+        ids.insert(ids.end(), block.other_nodes.begin(), block.other_nodes.end());
+        builder.report_progress(end);
+    };
+
+    // The header is still read, so that unsupported files are refused
+    // before any work is done.
+    auto on_header = [] (std::string_view blob_message) {
+        read_header(blob_message);
+    };
+
+    walk_blocks(data, pool, on_header, make_task, consume);
+
+    return ids;
+}
+
+
+std::optional<Bounds> osm_parser::read_pbf_bounds(std::string_view data)
+{
+    std::size_t pos = 0;
+
+    // The header is the first blob, but blobs of unknown types may come
+    // before it.
+    while (pos < data.size())
+    {
+        auto [type, blob_message] = next_blob(data, pos);
+
+        if (type == "OSMHeader")
+            return read_header(blob_message);
+
+        if (type == "OSMData")
+            throw ParserError("malformed pbf: data before header");
+    }
+
+    throw ParserError("malformed pbf: no header block");
+}
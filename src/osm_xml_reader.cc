@@ -0,0 +1,286 @@
+#include "osm_xml_reader.h"
+#include "osm_parser.h"
+
+#include <algorithm>        // for min()
+#include <charconv>         // for from_chars()
+
+
+namespace
+{
+    inline bool is_space(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    }
+
+    void append_utf8(std::string& out, unsigned long cp)
+    {
+        if (cp < 0x80)
+            out.push_back(static_cast<char>(cp));
+        else if (cp < 0x800)
+        {
+            out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+        else if (cp < 0x10000)
+        {
+            out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+            out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+        else
+        {
+            out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+            out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+    }
+}
+
+
+using osm_parser::XmlReader;
+
+
+std::optional<std::string_view>
+XmlReader::Element::attribute(std::string_view name) const
+{
+    for (const auto& attr: attributes)
+    {
+        if (attr.name == name)
+            return attr.value;
+    }
+
+    return {};
+}
+
+
+XmlReader::XmlReader(std::string_view document)
+    : m_document(document)
+{}
+
+
+std::size_t XmlReader::find_tag_end() const
+{
+    char quote = '\0';
+
+    for (std::size_t i = m_pos + 1; i < m_document.size(); ++i)
+    {
+        char c = m_document[i];
+
+        if (quote)
+        {
+            if (c == quote)
+                quote = '\0';
+        }
+        else if (c == '"' || c == '\'')
+            quote = c;
+        else if (c == '>')
+            return i;
+    }
+
+    return std::string_view::npos;
+}
+
+
+void XmlReader::split_tag(std::size_t begin, std::size_t end, Element& el)
+{
+    const char* data = m_document.data();
+
+    el.attributes.clear();
+    el.closing = false;
+    el.self_closing = false;
+
+    if (begin < end && data[begin] == '/')
+    {
+        el.closing = true;
+        ++begin;
+    }
+
+    if (begin < end && data[end - 1] == '/')
+    {
+        el.self_closing = true;
+        --end;
+    }
+
+    std::size_t i = begin;
+    while (i < end && !is_space(data[i]))
+        ++i;
+
+    if (i == begin)
+        throw ParserError("malformed xml: element without a name");
+
+    el.name = { data + begin, i - begin };
+
+    for (;;)
+    {
+        while (i < end && is_space(data[i]))
+            ++i;
+
+        if (i == end)
+            break;
+
+        std::size_t name_begin = i;
+        while (i < end && data[i] != '=' && !is_space(data[i]))
+            ++i;
+
+        std::string_view name{ data + name_begin, i - name_begin };
+
+        while (i < end && is_space(data[i]))
+            ++i;
+
+        if (i == end || data[i] != '=')
+            throw ParserError("malformed xml: attribute without a value");
+
+        ++i;
+        while (i < end && is_space(data[i]))
+            ++i;
+
+        if (i == end || (data[i] != '"' && data[i] != '\''))
+            throw ParserError("malformed xml: unquoted attribute value");
+
+        char quote = data[i++];
+        std::size_t value_begin = i;
+
+        while (i < end && data[i] != quote)
+            ++i;
+
+        if (i == end)
+            throw ParserError("malformed xml: unterminated attribute value");
+
+        el.attributes.push_back({ name, { data + value_begin, i - value_begin } });
+        ++i;
+    }
+}
+
+
+bool XmlReader::next(Element& el)
+{
+    for (;;)
+    {
+        std::size_t lt = m_document.find('<', m_pos);
+
+        if (lt == std::string_view::npos)
+        {
+            m_pos = m_document.size();
+            return false;
+        }
+
+        m_pos = lt;
+
+        std::string_view head = m_document.substr(m_pos);
+        std::string_view terminator;
+
+        if (head.starts_with("<!--"))
+            terminator = "-->";
+        else if (head.starts_with("<![CDATA["))
+            terminator = "]]>";
+        else if (head.starts_with("<?"))
+            terminator = "?>";
+
+        if (!terminator.empty())
+        {
+            std::size_t found = m_document.find(terminator, m_pos + 2);
+
+            if (found == std::string_view::npos)
+                throw ParserError("malformed xml: unexpected end of file");
+
+            m_pos = found + terminator.size();
+            continue;
+        }
+
+        std::size_t gt = find_tag_end();
+
+        if (gt == std::string_view::npos)
+            throw ParserError("malformed xml: unexpected end of file");
+
+        // Declarations such as <!DOCTYPE> carry nothing we care about.
+        if (m_document[m_pos + 1] == '!')
+        {
+            m_pos = gt + 1;
+            continue;
+        }
+
+        split_tag(m_pos + 1, gt, el);
+        m_pos = gt + 1;
+
+        return true;
+    }
+}
+
+
+std::size_t XmlReader::offset() const
+{
+    return m_pos;
+}
+
+
+void XmlReader::seek(std::size_t offset)
+{
+    m_pos = std::min(offset, m_document.size());
+}
+
+
+std::string XmlReader::decode(std::string_view value)
+{
+    std::string out;
+    out.reserve(value.size());
+
+    while (!value.empty())
+    {
+        auto amp = value.find('&');
+        out.append(value.substr(0, amp));
+
+        if (amp == std::string_view::npos)
+            break;
+
+        value.remove_prefix(amp);
+        auto semicolon = value.find(';');
+
+        if (semicolon == std::string_view::npos)
+        {
+            out.append(value);
+            break;
+        }
+
+        std::string_view entity = value.substr(1, semicolon - 1);
+        value.remove_prefix(semicolon + 1);
+
+        if (entity == "amp")
+            out.push_back('&');
+        else if (entity == "lt")
+            out.push_back('<');
+        else if (entity == "gt")
+            out.push_back('>');
+        else if (entity == "quot")
+            out.push_back('"');
+        else if (entity == "apos")
+            out.push_back('\'');
+        else if (entity.starts_with('#'))
+        {
+            unsigned long cp = 0;
+            int base = 10;
+            entity.remove_prefix(1);
+
+            if (entity.starts_with('x') || entity.starts_with('X'))
+            {
+                base = 16;
+                entity.remove_prefix(1);
+            }
+
+            auto [ptr, ec] = std::from_chars(
+                entity.data(), entity.data() + entity.size(), cp, base);
+
+            if (ec == std::errc() && ptr == entity.data() + entity.size())
+                append_utf8(out, cp);
+        }
+        else
+        {
+            // Unknown entity. Keep it as it was written.
+            out.push_back('&');
+            out.append(entity);
+            out.push_back(';');
+        }
+    }
+
+    return out;
+}
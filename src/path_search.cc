@@ -0,0 +1,357 @@
+#include "path_search.h"
+
+#include <algorithm>        // for max(), sort()
+#include <cmath>            // for sqrt()
+
+
+using Index = CsrGraph::Index;
+
+
+namespace
+{
+    constexpr double INFINITE = SearchWorkspace::INFINITE;
+
+    using Entry = SearchWorkspace::Entry;
+
+    /* The workspace of searches called without one: each thread keeps its
+     * own, so that interactive queries reuse it. */
+    SearchWorkspace& local_workspace(SearchWorkspace* workspace)
+    {
+        thread_local SearchWorkspace local;
+        return workspace ? *workspace : local;
+    }
+
+    /* Best-first search from src, ordered by distance plus `estimate(v)`.
+     *
+     * With an estimate of zero, this is Dijkstra. With an estimate that never
+     * overstates the distance left and never drops by more than an edge's
+     * weight along it (consistent), it is A*, and the target's distance is
+     * final when it is first popped, just as in Dijkstra. An estimate that
+     * only never overstates still finds the shortest path, since vertices
+     * reached again by a shorter route are pushed again.
+     */
+    template<typename Estimate>
+    double search(const CsrGraph& graph, Index src, Index tgt,
+                  std::vector<Graph::VertexT>& path, Graph::PathStats* stats,
+                  SearchWorkspace& ws, Estimate estimate)
+    {
+        std::size_t settled = 0;
+
+        // Binary heap with lazy deletion: a vertex is pushed again when its
+        // distance drops, and stale entries are skipped when popped.
+        ws.reset(graph.num_vertices());
+        ws.set(0, src, 0.0, src);
+        ws.push(0, { estimate(src), 0.0, src });
+
+        while (!ws.empty(0))
+        {
+            Entry entry = ws.pop(0);
+
+            if (entry.distance > ws.distance(0, entry.vertex))
+                continue;
+
+            ++settled;
+
+            if (entry.vertex == tgt)
+                break;
+
+            for (Index e = graph.edges_begin(entry.vertex); e < graph.edges_end(entry.vertex); ++e)
+            {
+                Index next = graph.target(e);
+                double candidate = entry.distance + graph.weight(e);
+
+                if (candidate < ws.distance(0, next))
+                {
+                    ws.set(0, next, candidate, entry.vertex);
+                    ws.push(0, { candidate + estimate(next), candidate, next });
+                }
+            }
+        }
+
+        if (stats)
+            stats->settled = settled;
+
+        double distance = ws.distance(0, tgt);
+
+        if (distance == INFINITE)
+            return INFINITE;
+
+        for (Index v = tgt; v != src; v = ws.parent(0, v))
+            path.push_back(v);
+
+        path.push_back(src);
+
+        return distance;
+    }
+}
+
+
+double path_search::dijkstra(const CsrGraph& graph, Index src, Index tgt,
+                             std::vector<Graph::VertexT>& path, Graph::PathStats* stats,
+                             SearchWorkspace* workspace)
+{
+    return search(graph, src, tgt, path, stats, local_workspace(workspace),
+                  [] (Index) { return 0.0; });
+}
+
+
+double path_search::astar(const CsrGraph& graph, Index src, Index tgt,
+                          std::vector<Graph::VertexT>& path, Graph::PathStats* stats,
+                          SearchWorkspace* workspace)
+{
+    const auto& target = graph.coords(tgt);
+
+    return search(graph, src, tgt, path, stats, local_workspace(workspace), [&] (Index v) {
+        const auto& point = graph.coords(v);
+        double dx = point.x - target.x;
+        double dy = point.y - target.y;
+
+        return std::sqrt(dx * dx + dy * dy);
+    });
+}
+
+
+double path_search::alt(const CsrGraph& graph, const Landmarks& landmarks,
+                        Index src, Index tgt,
+                        std::vector<Graph::VertexT>& path, Graph::PathStats* stats,
+                        SearchWorkspace* workspace)
+{
+    const auto& target = graph.coords(tgt);
+    auto active = landmarks.choose_active(src, tgt);
+
+    return search(graph, src, tgt, path, stats, local_workspace(workspace), [&] (Index v) {
+        const auto& point = graph.coords(v);
+        double dx = point.x - target.x;
+        double dy = point.y - target.y;
+
+        return std::max(std::sqrt(dx * dx + dy * dy), landmarks.bound(v, tgt, active));
+    });
+}
+
+
+double path_search::bidirectional(const CsrGraph& graph, Index src, Index tgt,
+                                  std::vector<Graph::VertexT>& path, Graph::PathStats* stats,
+                                  SearchWorkspace* workspace)
+{
+    // Side 0 is the forward search, from src; side 1 the backward one,
+    // from tgt, where the parent of a vertex is the next one towards tgt.
+    SearchWorkspace& ws = local_workspace(workspace);
+    std::size_t settled = 0;
+
+    ws.reset(graph.num_vertices());
+    ws.set(0, src, 0.0, src);
+    ws.set(1, tgt, 0.0, tgt);
+    ws.push(0, { 0.0, 0.0, src });
+    ws.push(1, { 0.0, 0.0, tgt });
+
+    // The shortest path seen so far goes through `meeting`.
+    double best = src == tgt ? 0.0 : INFINITE;
+    Index meeting = src;
+
+    auto drop_stale = [&] (int side) {
+        while (!ws.empty(side)
+               && ws.top(side).distance > ws.distance(side, ws.top(side).vertex))
+            ws.pop(side);
+    };
+
+    for (;;)
+    {
+        drop_stale(0);
+        drop_stale(1);
+
+        if (ws.empty(0) || ws.empty(1))
+            break;
+
+        // No path through a vertex that is still pending can beat `best`.
+        if (ws.top(0).key + ws.top(1).key >= best)
+            break;
+
+        int side = ws.top(0).key <= ws.top(1).key ? 0 : 1;
+        Entry entry = ws.pop(side);
+
+        ++settled;
+
+        auto relax = [&] (Index next, double weight) {
+            double candidate = entry.distance + weight;
+
+            if (candidate >= ws.distance(side, next))
+                return;
+
+            ws.set(side, next, candidate, entry.vertex);
+            ws.push(side, { candidate, candidate, next });
+
+            double other = ws.distance(1 - side, next);
+
+            if (other != INFINITE && candidate + other < best)
+            {
+                best = candidate + other;
+                meeting = next;
+            }
+        };
+
+        if (side == 0)
+        {
+            for (Index e = graph.edges_begin(entry.vertex); e < graph.edges_end(entry.vertex); ++e)
+                relax(graph.target(e), graph.weight(e));
+        }
+        else
+        {
+            for (Index e = graph.in_begin(entry.vertex); e < graph.in_end(entry.vertex); ++e)
+                relax(graph.in_source(e), graph.in_weight(e));
+        }
+    }
+
+    if (stats)
+        stats->settled = settled;
+
+    if (best == INFINITE)
+        return INFINITE;
+
+    // From tgt back to the meeting vertex, then on to src.
+    std::vector<Graph::VertexT> backward;
+
+    for (Index v = meeting; v != tgt; v = ws.parent(1, v))
+        backward.push_back(v);
+
+    backward.push_back(tgt);
+
+    path.insert(path.end(), backward.rbegin(), backward.rend());
+
+    for (Index v = ws.parent(0, meeting); v != src; v = ws.parent(0, v))
+        path.push_back(v);
+
+    if (meeting != src)
+        path.push_back(src);
+
+    return best;
+}
+
+
+void path_search::within(const CsrGraph& graph, Index src, double budget,
+                         std::vector<Graph::VertexT>& vertices, std::vector<double>& distances,
+                         SearchWorkspace* workspace)
+{
+    SearchWorkspace& ws = local_workspace(workspace);
+
+    ws.reset(graph.num_vertices());
+    ws.set(0, src, 0.0, src);
+    ws.push(0, { 0.0, 0.0, src });
+
+    while (!ws.empty(0))
+    {
+        Entry entry = ws.pop(0);
+
+        if (entry.distance > ws.distance(0, entry.vertex))
+            continue;
+
+        vertices.push_back(entry.vertex);
+        distances.push_back(entry.distance);
+
+        for (Index e = graph.edges_begin(entry.vertex); e < graph.edges_end(entry.vertex); ++e)
+        {
+            Index next = graph.target(e);
+            double candidate = entry.distance + graph.weight(e);
+
+            // Vertices beyond the budget are never queued, so the search
+            // ends with the last one within it.
+            if (candidate <= budget && candidate < ws.distance(0, next))
+            {
+                ws.set(0, next, candidate, entry.vertex);
+                ws.push(0, { candidate, candidate, next });
+            }
+        }
+    }
+}
+
+
+path_search::Targets::Targets(const std::vector<Index>& targets)
+{
+    std::vector<std::pair<Index, std::size_t>> sorted;
+    sorted.reserve(targets.size());
+
+    for (std::size_t column = 0; column < targets.size(); ++column)
+        sorted.emplace_back(targets[column], column);
+
+    std::sort(sorted.begin(), sorted.end());
+
+    m_columns.reserve(sorted.size());
+    m_buckets.reserve(sorted.size());
+
+    for (std::size_t i = 0; i < sorted.size(); ++i)
+    {
+        if (i == 0 || sorted[i].first != sorted[i - 1].first)
+            m_buckets.try_emplace(sorted[i].first, { i, i });
+
+        m_columns.push_back(sorted[i].second);
+        m_buckets.find(sorted[i].first)->second = i + 1;
+    }
+}
+
+
+std::pair<const std::size_t*, const std::size_t*>
+path_search::Targets::columns(Index vertex) const
+{
+    const auto* bucket = m_buckets.find(vertex);
+
+    if (!bucket)
+        return { nullptr, nullptr };
+
+    return { m_columns.data() + bucket->first, m_columns.data() + bucket->second };
+}
+
+
+void path_search::one_to_many(const CsrGraph& graph, Index src, const Targets& targets,
+                              double* distances, std::vector<Graph::VertexT>* paths,
+                              SearchWorkspace* workspace)
+{
+    SearchWorkspace& ws = local_workspace(workspace);
+    std::size_t remaining = targets.num_vertices();
+
+    for (std::size_t column = 0; column < targets.num_columns(); ++column)
+        distances[column] = INFINITE;
+
+    ws.reset(graph.num_vertices());
+    ws.set(0, src, 0.0, src);
+    ws.push(0, { 0.0, 0.0, src });
+
+    while (!ws.empty(0) && remaining > 0)
+    {
+        Entry entry = ws.pop(0);
+
+        if (entry.distance > ws.distance(0, entry.vertex))
+            continue;
+
+        // Every column of a target is answered when it is settled.
+        if (auto [begin, end] = targets.columns(entry.vertex); begin != end)
+        {
+            --remaining;
+
+            for (auto column = begin; column != end; ++column)
+            {
+                distances[*column] = entry.distance;
+
+                if (!paths)
+                    continue;
+
+                auto& path = paths[*column];
+
+                for (Index v = entry.vertex; v != src; v = ws.parent(0, v))
+                    path.push_back(v);
+
+                path.push_back(src);
+            }
+        }
+
+        for (Index e = graph.edges_begin(entry.vertex); e < graph.edges_end(entry.vertex); ++e)
+        {
+            Index next = graph.target(e);
+            double candidate = entry.distance + graph.weight(e);
+
+            if (candidate < ws.distance(0, next))
+            {
+                ws.set(0, next, candidate, entry.vertex);
+                ws.push(0, { candidate, candidate, next });
+            }
+        }
+    }
+}
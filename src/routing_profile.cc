@@ -0,0 +1,495 @@
+#include "routing_profile.h"
+
+#include <array>
+#include <cstddef>
+#include <stdexcept>        // for logic_error, only thrown at compile time
+#include <utility>          // for pair
+
+
+using osm_parser::Profile;
+using osm_parser::Word;
+using osm_parser::WayFilter;
+
+
+/* Perfect hash of the recognized words.
+ *
+ * A seed is searched at compile time so that no two words fall in the same
+ * slot of TABLE. Looking a word up is then one hash, one table read and one
+ * string compare to reject words that aren't in the list. If a word is ever
+ * added that makes the search fail, compilation fails.
+ */
+namespace
+{
+    constexpr std::pair<Word, std::string_view> WORD_LIST[] = {
+        { Word::name, "name" },
+        { Word::highway, "highway" },
+        { Word::oneway, "oneway" },
+        { Word::oneway_bicycle, "oneway:bicycle" },
+        { Word::junction, "junction" },
+        { Word::access, "access" },
+        { Word::vehicle, "vehicle" },
+        { Word::motor_vehicle, "motor_vehicle" },
+        { Word::motorcar, "motorcar" },
+        { Word::bicycle, "bicycle" },
+        { Word::foot, "foot" },
+
+        { Word::yes, "yes" },
+        { Word::no, "no" },
+        { Word::true_, "true" },
+        { Word::one, "1" },
+        { Word::minus_one, "-1" },
+        { Word::reversible, "reversible" },
+        { Word::alternating, "alternating" },
+        { Word::roundabout, "roundabout" },
+        { Word::circular, "circular" },
+
+        { Word::private_, "private" },
+        { Word::agricultural, "agricultural" },
+        { Word::forestry, "forestry" },
+        { Word::delivery, "delivery" },
+        { Word::customers, "customers" },
+        { Word::destination, "destination" },
+        { Word::permissive, "permissive" },
+        { Word::designated, "designated" },
+        { Word::use_sidepath, "use_sidepath" },
+        { Word::dismount, "dismount" },
+
+        { Word::motorway, "motorway" },
+        { Word::motorway_link, "motorway_link" },
+        { Word::trunk, "trunk" },
+        { Word::trunk_link, "trunk_link" },
+        { Word::primary, "primary" },
+        { Word::primary_link, "primary_link" },
+        { Word::secondary, "secondary" },
+        { Word::secondary_link, "secondary_link" },
+        { Word::tertiary, "tertiary" },
+        { Word::tertiary_link, "tertiary_link" },
+        { Word::unclassified, "unclassified" },
+        { Word::residential, "residential" },
+        { Word::living_street, "living_street" },
+        { Word::service, "service" },
+        { Word::road, "road" },
+        { Word::track, "track" },
+        { Word::pedestrian, "pedestrian" },
+        { Word::footway, "footway" },
+        { Word::path, "path" },
+        { Word::cycleway, "cycleway" },
+        { Word::bridleway, "bridleway" },
+        { Word::steps, "steps" },
+        { Word::corridor, "corridor" },
+        { Word::busway, "busway" },
+        { Word::construction, "construction" },
+        { Word::proposed, "proposed" },
+        { Word::abandoned, "abandoned" },
+        { Word::platform, "platform" },
+        { Word::raceway, "raceway" },
+    };
+
+    constexpr std::size_t NUM_WORDS = static_cast<std::size_t>(Word::count);
+    constexpr std::size_t TABLE_SIZE = 1024;
+
+    static_assert(std::size(WORD_LIST) == NUM_WORDS - 1,
+                  "every Word but unknown must be in WORD_LIST");
+
+    constexpr std::size_t max_word_size()
+    {
+        std::size_t size = 0;
+
+        for (const auto& [word, text]: WORD_LIST)
+            size = text.size() > size ? text.size() : size;
+
+        return size;
+    }
+
+    constexpr std::size_t MAX_WORD_SIZE = max_word_size();
+
+    // FNV-1a, with a seed mixed in.
+    constexpr std::uint32_t hash(std::uint32_t seed, std::string_view text)
+    {
+        std::uint32_t h = 2166136261u ^ seed;
+
+        for (char c: text)
+        {
+            h ^= static_cast<std::uint8_t>(c);
+            h *= 16777619u;
+        }
+
+        return h;
+    }
+
+    constexpr std::size_t slot(std::uint32_t seed, std::string_view text)
+    {
+        return hash(seed, text) & (TABLE_SIZE - 1);
+    }
+
+    consteval std::uint32_t find_seed()
+    {
+        for (std::uint32_t seed = 1; seed < 100000; ++seed)
+        {
+            std::array<bool, TABLE_SIZE> used{};
+            bool collision = false;
+
+            for (const auto& [word, text]: WORD_LIST)
+            {
+                auto i = slot(seed, text);
+
+                if (used[i])
+                {
+                    collision = true;
+                    break;
+                }
+
+                used[i] = true;
+            }
+
+            if (!collision)
+                return seed;
+        }
+
+        throw std::logic_error("no perfect hash seed for the word list");
+    }
+
+    constexpr std::uint32_t SEED = find_seed();
+
+    consteval std::array<Word, TABLE_SIZE> make_table()
+    {
+        std::array<Word, TABLE_SIZE> table{};
+
+        for (const auto& [word, text]: WORD_LIST)
+            table[slot(SEED, text)] = word;
+
+        return table;
+    }
+
+    consteval std::array<std::string_view, NUM_WORDS> make_texts()
+    {
+        std::array<std::string_view, NUM_WORDS> texts{};
+
+        for (const auto& [word, text]: WORD_LIST)
+        {
+            auto& entry = texts[static_cast<std::size_t>(word)];
+
+            // Two texts for one word would leave the other one unreachable.
+            if (!entry.empty())
+                throw std::logic_error("word listed twice");
+
+            entry = text;
+        }
+
+        return texts;
+    }
+
+    constexpr std::array<Word, TABLE_SIZE> TABLE = make_table();
+    constexpr std::array<std::string_view, NUM_WORDS> TEXTS = make_texts();
+}
+
+
+Word osm_parser::match_word(std::string_view text)
+{
+    // Names and most values are longer than any word, and are rejected
+    // without being hashed.
+    if (text.empty() || text.size() > MAX_WORD_SIZE)
+        return Word::unknown;
+
+    Word word = TABLE[slot(SEED, text)];
+
+    return TEXTS[static_cast<std::size_t>(word)] == text ? word : Word::unknown;
+}
+
+
+std::string_view osm_parser::profile_name(Profile profile)
+{
+    switch (profile)
+    {
+    case Profile::any_highway:
+        return "any";
+    case Profile::car:
+        return "car";
+    case Profile::bike:
+        return "bike";
+    case Profile::foot:
+        return "foot";
+    case Profile::trunk_only:
+        return "trunk";
+    }
+
+    return "any";
+}
+
+
+/* The profile rules.
+ *
+ * Each highway class is either allowed, allowed only when an access tag
+ * explicitly permits it (a footway with bicycle=yes), or never allowed.
+ */
+namespace
+{
+    enum class Allowance { never, if_permitted, always };
+
+    Allowance highway_allowance(Profile profile, Word highway)
+    {
+        switch (profile)
+        {
+        case Profile::any_highway:
+            return Allowance::always;
+
+        case Profile::trunk_only:
+            switch (highway)
+            {
+            case Word::motorway: case Word::motorway_link:
+            case Word::trunk: case Word::trunk_link:
+                return Allowance::always;
+            default:
+                return Allowance::never;
+            }
+
+        case Profile::car:
+            switch (highway)
+            {
+            case Word::motorway: case Word::motorway_link:
+            case Word::trunk: case Word::trunk_link:
+            case Word::primary: case Word::primary_link:
+            case Word::secondary: case Word::secondary_link:
+            case Word::tertiary: case Word::tertiary_link:
+            case Word::unclassified: case Word::residential:
+            case Word::living_street: case Word::service: case Word::road:
+                return Allowance::always;
+            case Word::track:
+                return Allowance::if_permitted;
+            default:
+                return Allowance::never;
+            }
+
+        case Profile::bike:
+            switch (highway)
+            {
+            case Word::primary: case Word::primary_link:
+            case Word::secondary: case Word::secondary_link:
+            case Word::tertiary: case Word::tertiary_link:
+            case Word::unclassified: case Word::residential:
+            case Word::living_street: case Word::service: case Word::road:
+            case Word::track: case Word::cycleway: case Word::path:
+                return Allowance::always;
+            case Word::trunk: case Word::trunk_link:
+            case Word::pedestrian: case Word::footway: case Word::bridleway:
+            case Word::busway:
+                return Allowance::if_permitted;
+            default:
+                return Allowance::never;
+            }
+
+        case Profile::foot:
+            switch (highway)
+            {
+            case Word::primary: case Word::primary_link:
+            case Word::secondary: case Word::secondary_link:
+            case Word::tertiary: case Word::tertiary_link:
+            case Word::unclassified: case Word::residential:
+            case Word::living_street: case Word::service: case Word::road:
+            case Word::track: case Word::pedestrian: case Word::footway:
+            case Word::path: case Word::steps: case Word::corridor:
+            case Word::platform:
+                return Allowance::always;
+            case Word::trunk: case Word::trunk_link:
+            case Word::cycleway: case Word::bridleway:
+                return Allowance::if_permitted;
+            default:
+                return Allowance::never;
+            }
+        }
+
+        return Allowance::never;
+    }
+
+    /* Position of each access key in WayFilter::m_access, from the most
+     * general to the most specific. -1 for other words. */
+    int access_index(Word key)
+    {
+        switch (key)
+        {
+        case Word::access: return 0;
+        case Word::vehicle: return 1;
+        case Word::motor_vehicle: return 2;
+        case Word::motorcar: return 3;
+        case Word::bicycle: return 4;
+        case Word::foot: return 5;
+        default: return -1;
+        }
+    }
+
+    /* Whether the access key at `index` applies to the profile. */
+    bool access_applies(Profile profile, int index)
+    {
+        switch (profile)
+        {
+        case Profile::any_highway:
+            return false;
+        case Profile::car:
+        case Profile::trunk_only:
+            return index <= 3;
+        case Profile::bike:
+            return index <= 1 || index == 4;
+        case Profile::foot:
+            return index == 0 || index == 5;
+        }
+
+        return false;
+    }
+
+    enum class Access { unknown, denied, permitted };
+
+    Access access_value(Word value)
+    {
+        switch (value)
+        {
+        case Word::no: case Word::private_: case Word::agricultural:
+        case Word::forestry: case Word::delivery: case Word::use_sidepath:
+            return Access::denied;
+        case Word::yes: case Word::permissive: case Word::designated:
+        case Word::destination: case Word::customers: case Word::dismount:
+            return Access::permitted;
+        default:
+            return Access::unknown;
+        }
+    }
+
+    bool is_true(Word value)
+    {
+        return value == Word::yes || value == Word::true_ || value == Word::one;
+    }
+}
+
+
+WayFilter::WayFilter(Profile profile)
+    : m_profile(profile)
+{
+    clear();
+}
+
+
+void WayFilter::clear()
+{
+    m_highway = Word::unknown;
+    m_oneway = Word::unknown;
+    m_oneway_bicycle = Word::unknown;
+    m_junction = Word::unknown;
+
+    for (auto& value: m_access)
+        value = Word::unknown;
+}
+
+
+Word WayFilter::add_tag(std::string_view key, std::string_view value)
+{
+    Word key_word = match_word(key);
+
+    switch (key_word)
+    {
+    case Word::unknown:
+    case Word::name:
+        break;
+    case Word::highway:
+        // Classes that aren't in the list still make the way a highway,
+        // which is all any_highway asks for.
+        m_highway = match_word(value);
+        if (m_highway == Word::unknown)
+            m_highway = Word::count;
+        break;
+    case Word::oneway:
+        m_oneway = match_word(value);
+        break;
+    case Word::oneway_bicycle:
+        m_oneway_bicycle = match_word(value);
+        break;
+    case Word::junction:
+        m_junction = match_word(value);
+        break;
+    default:
+        if (int i = access_index(key_word); i >= 0 && access_applies(m_profile, i))
+            m_access[i] = match_word(value);
+        break;
+    }
+
+    return key_word;
+}
+
+
+bool WayFilter::accepted() const
+{
+    // Word::count stands for a highway value that isn't in the list.
+    if (m_highway == Word::unknown)
+        return false;
+
+    if (m_profile == Profile::any_highway)
+        return true;
+
+    auto allowance = highway_allowance(m_profile, m_highway);
+
+    if (allowance == Allowance::never)
+        return false;
+
+    // The most specific access key that is set has the final word.
+    Access access = Access::unknown;
+
+    for (auto value: m_access)
+    {
+        if (auto a = access_value(value); a != Access::unknown)
+            access = a;
+    }
+
+    if (access == Access::denied)
+        return false;
+
+    if (allowance == Allowance::if_permitted && access != Access::permitted)
+        return false;
+
+    // Lanes that change direction during the day can't be routed on
+    // without a timetable.
+    if (m_profile != Profile::foot &&
+        (m_oneway == Word::reversible || m_oneway == Word::alternating))
+    {
+        return false;
+    }
+
+    return true;
+}
+
+
+bool WayFilter::oneway() const
+{
+    switch (m_profile)
+    {
+    case Profile::any_highway:
+        // Only the explicit values, as the parser has always done.
+        return m_oneway == Word::yes || m_oneway == Word::minus_one;
+
+    case Profile::foot:
+        return false;
+
+    case Profile::bike:
+        if (m_oneway_bicycle == Word::no)
+            return false;
+        break;
+
+    default:
+        break;
+    }
+
+    if (is_true(m_oneway) || m_oneway == Word::minus_one)
+        return true;
+
+    if (m_oneway == Word::no)
+        return false;
+
+    // Implied by the OSM conventions.
+    return m_junction == Word::roundabout
+        || m_junction == Word::circular
+        || m_highway == Word::motorway
+        || m_highway == Word::motorway_link;
+}
+
+
+bool WayFilter::reversed() const
+{
+    return oneway() && m_oneway == Word::minus_one;
+}
@@ -0,0 +1,30 @@
+#include "search_workspace.h"
+
+
+void SearchWorkspace::reset(std::size_t num_vertices)
+{
+    for (auto& queue: m_queues)
+        queue.clear();
+
+    if (m_labels[0].size() != num_vertices)
+    {
+        for (auto& labels: m_labels)
+            labels.assign(num_vertices, Label{ INFINITE, 0, 0 });
+
+        m_generation = 1;
+        return;
+    }
+
+    // Once the counter wraps, old labels could pass for new ones.
+    if (++m_generation == 0)
+    {
+        for (auto& labels: m_labels)
+        {
+            for (auto& label: labels)
+                label.generation = 0;
+        }
+
+        m_generation = 1;
+    }
+}
+
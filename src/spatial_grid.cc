@@ -0,0 +1,272 @@
+#include "spatial_grid.h"
+
+#include <algorithm>        // for min(), max(), clamp()
+#include <cmath>            // for floor(), sqrt()
+
+
+namespace
+{
+    /* Cell coordinates stay within this range, so that keys fit in 64 bits
+     * and never reach IdIndex::RESERVED_ID. */
+    constexpr std::int64_t CELL_LIMIT = std::int64_t{ 1 } << 30;
+
+    /* Cells hold about this many vertices each, on average. */
+    constexpr double VERTICES_PER_CELL = 4.0;
+
+    double distance(const Graph::VertexCoords& a, const Graph::VertexCoords& b)
+    {
+        double dx = a.x - b.x;
+        double dy = a.y - b.y;
+
+        return std::sqrt(dx * dx + dy * dy);
+    }
+}
+
+
+SpatialGrid::SpatialGrid(double cell_size)
+    : m_cell_size(cell_size > 0.0 ? cell_size : 1.0)
+{
+}
+
+
+SpatialGrid::SpatialGrid(const Graph& graph)
+    : m_cell_size(1.0)
+{
+    std::size_t n = graph.num_vertices() - graph.num_removed();
+
+    if (n == 0)
+        return;
+
+    double min_x = std::numeric_limits<double>::max();
+    double min_y = std::numeric_limits<double>::max();
+    double max_x = std::numeric_limits<double>::lowest();
+    double max_y = std::numeric_limits<double>::lowest();
+
+    for (auto [vi, vend] = graph.iter_vertices(); vi != vend; ++vi)
+    {
+        if (graph.is_removed(*vi))
+            continue;
+
+        const auto& point = graph.get_vertex_coords(*vi);
+
+        min_x = std::min(min_x, point.x);
+        min_y = std::min(min_y, point.y);
+        max_x = std::max(max_x, point.x);
+        max_y = std::max(max_y, point.y);
+    }
+
+    // Square cells with, on average, VERTICES_PER_CELL vertices each. A
+    // map along a line has no area; its length is used instead.
+    double area = (max_x - min_x) * (max_y - min_y);
+    double cell_size = area > 0.0
+        ? std::sqrt(area * VERTICES_PER_CELL / n)
+        : std::max(max_x - min_x, max_y - min_y) * VERTICES_PER_CELL / n;
+
+    if (cell_size > 0.0)
+        m_cell_size = cell_size;
+
+    m_cell_index.reserve(static_cast<std::size_t>(n / VERTICES_PER_CELL) + 1);
+
+    for (auto [vi, vend] = graph.iter_vertices(); vi != vend; ++vi)
+    {
+        if (!graph.is_removed(*vi))
+            insert(*vi, graph.get_vertex_coords(*vi));
+    }
+}
+
+
+void SpatialGrid::insert(SpatialGrid::VertexT vertex, const SpatialGrid::VertexCoords& coord)
+{
+    std::int64_t cx = cell_of(coord.x);
+    std::int64_t cy = cell_of(coord.y);
+
+    auto [position, inserted] = m_cell_index.try_emplace(key(cx, cy), m_cells.size());
+
+    if (inserted)
+        m_cells.emplace_back();
+
+    m_cells[*position].push_back({ vertex, coord });
+    ++m_size;
+
+    if (m_size == 1)
+    {
+        m_min_cx = m_max_cx = cx;
+        m_min_cy = m_max_cy = cy;
+    }
+    else
+    {
+        m_min_cx = std::min(m_min_cx, cx);
+        m_max_cx = std::max(m_max_cx, cx);
+        m_min_cy = std::min(m_min_cy, cy);
+        m_max_cy = std::max(m_max_cy, cy);
+    }
+}
+
+
+bool SpatialGrid::erase(SpatialGrid::VertexT vertex, const SpatialGrid::VertexCoords& coord)
+{
+    const auto* position = m_cell_index.find(key(cell_of(coord.x), cell_of(coord.y)));
+
+    if (!position)
+        return false;
+
+    auto& entries = m_cells[*position];
+
+    for (auto& entry: entries)
+    {
+        if (entry.vertex == vertex)
+        {
+            entry = entries.back();
+            entries.pop_back();
+            --m_size;
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+void SpatialGrid::move(SpatialGrid::VertexT vertex,
+                       const SpatialGrid::VertexCoords& from,
+                       const SpatialGrid::VertexCoords& to)
+{
+    if (erase(vertex, from))
+        insert(vertex, to);
+}
+
+
+std::optional<SpatialGrid::VertexT>
+SpatialGrid::nearest(const SpatialGrid::VertexCoords& coord, double max_distance) const
+{
+    if (m_size == 0)
+        return {};
+
+    std::int64_t cx = cell_of(coord.x);
+    std::int64_t cy = cell_of(coord.y);
+
+    std::optional<VertexT> best;
+    double best_distance = max_distance;
+
+    auto visit = [&] (std::int64_t x, std::int64_t y) {
+        const auto* entries = cell(x, y);
+
+        if (!entries)
+            return;
+
+        for (const auto& entry: *entries)
+        {
+            double d = distance(coord, entry.coord);
+
+            if (d <= best_distance)
+            {
+                best_distance = d;
+                best = entry.vertex;
+            }
+        }
+    };
+
+    for (std::int64_t r = 0; ; ++r)
+    {
+        // Ring r: the cells at Chebyshev distance r from (cx, cy), only
+        // where there may be vertices.
+        std::int64_t x_begin = std::max(cx - r, m_min_cx);
+        std::int64_t x_end = std::min(cx + r, m_max_cx);
+        std::int64_t y_begin = std::max(cy - r + 1, m_min_cy);
+        std::int64_t y_end = std::min(cy + r - 1, m_max_cy);
+
+        for (std::int64_t x = x_begin; x <= x_end; ++x)
+        {
+            visit(x, cy - r);
+
+            if (r > 0)
+                visit(x, cy + r);
+        }
+
+        for (std::int64_t y = y_begin; y <= y_end; ++y)
+        {
+            if (cx - r >= m_min_cx)
+                visit(cx - r, y);
+
+            if (cx + r <= m_max_cx)
+                visit(cx + r, y);
+        }
+
+        // Every vertex not seen yet lies outside the square of rings 0..r.
+        double left = coord.x - static_cast<double>(cx - r) * m_cell_size;
+        double right = static_cast<double>(cx + r + 1) * m_cell_size - coord.x;
+        double bottom = coord.y - static_cast<double>(cy - r) * m_cell_size;
+        double top = static_cast<double>(cy + r + 1) * m_cell_size - coord.y;
+        double unseen = std::min({ left, right, bottom, top });
+
+        if (unseen > best_distance)
+            break;
+
+        bool covered = cx - r <= m_min_cx && cx + r >= m_max_cx
+            && cy - r <= m_min_cy && cy + r >= m_max_cy;
+
+        if (covered)
+            break;
+    }
+
+    return best;
+}
+
+
+void SpatialGrid::within(const SpatialGrid::VertexCoords& coord, double radius,
+                         std::vector<SpatialGrid::VertexT>& vertices) const
+{
+    if (m_size == 0 || radius < 0.0)
+        return;
+
+    std::int64_t x_begin = std::max(cell_of(coord.x - radius), m_min_cx);
+    std::int64_t x_end = std::min(cell_of(coord.x + radius), m_max_cx);
+    std::int64_t y_begin = std::max(cell_of(coord.y - radius), m_min_cy);
+    std::int64_t y_end = std::min(cell_of(coord.y + radius), m_max_cy);
+
+    for (std::int64_t x = x_begin; x <= x_end; ++x)
+    {
+        for (std::int64_t y = y_begin; y <= y_end; ++y)
+        {
+            const auto* entries = cell(x, y);
+
+            if (!entries)
+                continue;
+
+            for (const auto& entry: *entries)
+            {
+                if (distance(coord, entry.coord) <= radius)
+                    vertices.push_back(entry.vertex);
+            }
+        }
+    }
+}
+
+
+std::int64_t SpatialGrid::cell_of(double value) const
+{
+    double cell = std::floor(value / m_cell_size);
+
+    return static_cast<std::int64_t>(std::clamp(cell,
+                                                static_cast<double>(-CELL_LIMIT),
+                                                static_cast<double>(CELL_LIMIT)));
+}
+
+
+std::size_t SpatialGrid::key(std::int64_t cx, std::int64_t cy)
+{
+    auto x = static_cast<std::uint64_t>(cx + 2 * CELL_LIMIT);
+    auto y = static_cast<std::uint64_t>(cy + 2 * CELL_LIMIT);
+
+    return static_cast<std::size_t>((x << 32) | y);
+}
+
+
+const std::vector<SpatialGrid::Entry>*
+SpatialGrid::cell(std::int64_t cx, std::int64_t cy) const
+{
+    const auto* position = m_cell_index.find(key(cx, cy));
+
+    return position ? &m_cells[*position] : nullptr;
+}
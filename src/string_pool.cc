@@ -0,0 +1,37 @@
+#include "string_pool.h"
+
+#include <limits>           // for numeric_limits<>::max()
+#include <stdexcept>        // for length_error
+
+
+StringPool::StringPool()
+{
+    m_strings.emplace_back();
+    m_ids.emplace(std::string(), EMPTY);
+}
+
+
+StringPool::ID StringPool::intern(std::string_view text)
+{
+    if (auto it = m_ids.find(text); it != m_ids.end())
+        return it->second;
+
+    if (m_strings.size() > std::numeric_limits<ID>::max())
+        throw std::length_error("string pool is full");
+
+    auto id = static_cast<ID>(m_strings.size());
+
+    m_strings.emplace_back(text);
+    m_ids.emplace(m_strings.back(), id);
+
+    return id;
+}
+
+
+std::optional<StringPool::ID> StringPool::find(std::string_view text) const
+{
+    if (auto it = m_ids.find(text); it != m_ids.end())
+        return it->second;
+
+    return std::nullopt;
+}
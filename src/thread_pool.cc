@@ -0,0 +1,59 @@
+#include "thread_pool.h"
+
+#include <algorithm>        // for max()
+
+
+ThreadPool::ThreadPool(unsigned threads)
+{
+    threads = std::max(threads, 1u);
+
+    m_threads.reserve(threads);
+
+    for (unsigned i = 0; i < threads; ++i)
+        m_threads.emplace_back([this] () { run(); });
+}
+
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard lock{ m_mutex };
+        m_stopping = true;
+    }
+
+    m_condition.notify_all();
+
+    for (auto& thread: m_threads)
+        thread.join();
+}
+
+
+unsigned ThreadPool::size() const
+{
+    return static_cast<unsigned>(m_threads.size());
+}
+
+
+void ThreadPool::run()
+{
+    for (;;)
+    {
+        std::function<void()> task;
+
+        {
+            std::unique_lock lock{ m_mutex };
+            m_condition.wait(lock, [this] () {
+                return m_stopping || !m_tasks.empty();
+            });
+
+            // Pending tasks still run after the pool starts stopping.
+            if (m_tasks.empty())
+                return;
+
+            task = std::move(m_tasks.front());
+            m_tasks.pop();
+        }
+
+        task();
+    }
+}